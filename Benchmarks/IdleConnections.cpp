@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#else
+#error "IdleConnections uses /proc and RLIMIT_NOFILE, it's built only on Linux"
+#endif
+
+static constexpr uint16_t serverPort = 8092;
+static constexpr size_t churnConnections = 10'000;
+static constexpr size_t churnBatchSize = 1'000;
+static constexpr size_t registryIterations = 100;
+
+/**
+ * @brief Number of client source addresses. Clients are spread between 127.1.0.x addresses, so each address has its own ephemeral ports and kick(ip) works on small group
+ */
+static constexpr size_t numberOfSourceAddresses = 250;
+
+static std::atomic<size_t> activeHandlers = 0;
+
+/// @brief Server with mostly idle clients. Thread per connection handler blocks in recv, thread pool handler parks connection in server's poller and returns
+class IdleServer : public web::BaseTCPServer
+{
+private:
+	bool pool;
+
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		if (pool)
+		{
+			this->park(clientSocket, cleanup);
+
+			return;
+		}
+
+		activeHandlers++;
+
+		char byte;
+
+		while (recv(clientSocket, &byte, sizeof(byte), 0) > 0);
+
+		activeHandlers--;
+	}
+
+public:
+	IdleServer(bool pool) :
+		BaseTCPServer(std::to_string(serverPort), "127.0.0.1", 0, true),
+		pool(pool)
+	{
+		if (pool)
+		{
+			this->setThreadPool();
+		}
+	}
+
+};
+
+static size_t getProcessValue(std::string_view name)
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+
+	while (std::getline(status, line))
+	{
+		if (line.starts_with(name))
+		{
+			return std::stoull(line.substr(name.size() + 1));
+		}
+	}
+
+	return 0;
+}
+
+static size_t getResidentKilobytes()
+{
+	return getProcessValue("VmRSS");
+}
+
+static size_t getMaxConnections()
+{
+	rlimit limit = {};
+
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	limit.rlim_cur = limit.rlim_max;
+
+	setrlimit(RLIMIT_NOFILE, &limit);
+
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	// Client and server sockets of each connection live in this process, churn batch needs its own descriptors
+	return (limit.rlim_cur - 64 - churnBatchSize) / 2;
+}
+
+static sockaddr_in makeSourceAddress(size_t index)
+{
+	sockaddr_in result = {};
+
+	result.sin_family = AF_INET;
+	result.sin_addr.s_addr = htonl((127U << 24) | (1U << 16) | static_cast<uint32_t>(index % numberOfSourceAddresses + 1));
+
+	return result;
+}
+
+static SOCKET connectClient(size_t index, const sockaddr_in& serverAddress)
+{
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	sockaddr_in source = makeSourceAddress(index);
+
+	if (client == INVALID_SOCKET ||
+		bind(client, reinterpret_cast<sockaddr*>(&source), sizeof(source)) == SOCKET_ERROR ||
+		connect(client, reinterpret_cast<const sockaddr*>(&serverAddress), sizeof(serverAddress)) == SOCKET_ERROR)
+	{
+		THROW_WEB_SERVER_EXCEPTION;
+	}
+
+	return client;
+}
+
+template<typename FunctionT>
+static double measureMicroseconds(FunctionT&& function, size_t iterations = 1)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < iterations; i++)
+	{
+		function();
+	}
+
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+}
+
+template<typename PredicateT>
+static void waitFor(PredicateT&& predicate)
+{
+	while (!predicate())
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	// IdleConnections [connections] [thread|pool] [max RSS bytes per connection]
+	size_t numberOfConnections = argc > 1 ? std::stoull(argv[1]) : 10'000;
+	bool pool = argc > 2 && std::string_view(argv[2]) == "pool";
+	double maxResidentPerConnection = argc > 3 ? std::stod(argv[3]) : 0.0;
+	size_t maxConnections = getMaxConnections();
+
+	if (numberOfConnections > maxConnections)
+	{
+		std::cout << "Open files limit allows " << maxConnections << " connections" << std::endl;
+
+		numberOfConnections = maxConnections;
+	}
+
+	IdleServer server(pool);
+	sockaddr_in serverAddress = {};
+	std::vector<SOCKET> clients;
+
+	serverAddress.sin_family = AF_INET;
+	serverAddress.sin_port = htons(serverPort);
+	inet_pton(AF_INET, "127.0.0.1", &serverAddress.sin_addr);
+
+	server.reserveConnections(numberOfConnections);
+	server.start();
+
+	clients.reserve(numberOfConnections);
+
+	size_t baseResident = getResidentKilobytes();
+
+	double acceptTime = measureMicroseconds
+	(
+		[&]()
+		{
+			for (size_t i = 0; i < numberOfConnections; i++)
+			{
+				clients.push_back(connectClient(i, serverAddress));
+			}
+
+			waitFor([&]() { return pool ? server.getNumberOfParkedConnections() == numberOfConnections : activeHandlers == numberOfConnections; });
+		}
+	);
+
+	size_t resident = getResidentKilobytes();
+	double residentPerConnection = (resident - std::min(resident, baseResident)) * 1024.0 / numberOfConnections;
+
+	std::cout << (pool ? "Thread pool, parked connections" : "Thread per connection") << ", " << numberOfConnections << " idle connections" << std::endl
+		<< "Accept rate:              " << numberOfConnections / (acceptTime / 1'000'000) << " connections/s" << std::endl
+		<< "RSS per connection:       " << residentPerConnection << " bytes" << std::endl
+		<< "Threads:                  " << getProcessValue("Threads") << std::endl;
+
+	double churnTime = measureMicroseconds
+	(
+		[&]()
+		{
+			for (size_t i = 0; i < churnConnections; i += churnBatchSize)
+			{
+				for (size_t j = 0; j < churnBatchSize; j++)
+				{
+					closesocket(connectClient(i + j, serverAddress));
+				}
+
+				// Server sockets of churned connections are closed by handlers or poller before next batch, so descriptors stay within limit
+				waitFor([&]() { return server.getNumberOfConnections() == numberOfConnections; });
+			}
+		}
+	);
+
+	std::cout << "Accept rate under churn:  " << churnConnections / (churnTime / 1'000'000) << " connections/s" << std::endl;
+
+	sockaddr_in source = makeSourceAddress(0);
+	char sourceIp[INET_ADDRSTRLEN] = {};
+
+	inet_ntop(AF_INET, &source.sin_addr, sourceIp, sizeof(sourceIp));
+
+	std::cout << "getNumberOfConnections:   " << measureMicroseconds([&]() { server.getNumberOfConnections(); }, registryIterations) << " us" << std::endl
+		<< "getNumberOfClients:       " << measureMicroseconds([&]() { server.getNumberOfClients(); }, registryIterations) << " us" << std::endl
+		<< "getClients:               " << measureMicroseconds([&]() { server.getClients(); }, registryIterations) << " us" << std::endl
+		<< "kick(ip):                 " << measureMicroseconds([&]() { server.kick(sourceIp); }) << " us" << std::endl;
+
+	double kickAllTime = measureMicroseconds([&]() { server.kickAll(); });
+
+	// Handlers blocked in recv on kicked sockets return when client side is closed, parked connections are unparked by kick
+	double teardownTime = measureMicroseconds
+	(
+		[&]()
+		{
+			for (SOCKET client : clients)
+			{
+				closesocket(client);
+			}
+
+			waitFor([&]() { return !activeHandlers && !server.getNumberOfParkedConnections(); });
+		}
+	);
+
+	std::cout << "kickAll:                  " << kickAllTime / 1000 << " ms (" << numberOfConnections / (kickAllTime / 1'000'000) << " connections/s)" << std::endl
+		<< "Close clients, handlers:  " << teardownTime / 1000 << " ms" << std::endl;
+
+	std::cout << "stop:                     " << measureMicroseconds([&]() { server.stop(); }) / 1000 << " ms" << std::endl;
+
+	if (maxResidentPerConnection && residentPerConnection > maxResidentPerConnection)
+	{
+		std::cerr << "RSS per connection " << residentPerConnection << " bytes is above " << maxResidentPerConnection << " bytes" << std::endl;
+
+		return 1;
+	}
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
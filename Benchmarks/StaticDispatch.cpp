@@ -0,0 +1,148 @@
+#include <chrono>
+#include <iostream>
+
+#include <BaseTCPServer.h>
+#include <StaticTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#endif
+
+static constexpr size_t dispatchIterations = 10'000'000;
+static constexpr size_t connectionIterations = 10'000;
+
+static size_t handled = 0;
+static bool closeSockets = false;
+
+class VirtualServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		handled += ip.size();
+	}
+
+	bool autoCloseSocket() const override
+	{
+		return closeSockets;
+	}
+
+public:
+	VirtualServer(std::string_view port) :
+		BaseTCPServer(port, "127.0.0.1", 0, false)
+	{
+
+	}
+
+	void dispatch(SOCKET clientSocket, sockaddr address)
+	{
+		this->serve(BaseTCPServer::getClientIpV4(address), clientSocket, address);
+	}
+};
+
+class PolicyServer : public web::StaticTCPServer<PolicyServer, web::policies::SingleThread>
+{
+public:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address)
+	{
+		handled += ip.size();
+	}
+
+	bool autoCloseSocket() const
+	{
+		return closeSockets;
+	}
+
+public:
+	PolicyServer(std::string_view port) :
+		StaticTCPServer(port, "127.0.0.1")
+	{
+
+	}
+
+	void dispatch(SOCKET clientSocket, sockaddr address)
+	{
+		this->serve(clientSocket, address);
+	}
+};
+
+template<typename ServerT>
+static double measureDispatch(ServerT& server)
+{
+	sockaddr address = {};
+
+	reinterpret_cast<sockaddr_in&>(address).sin_family = AF_INET;
+	inet_pton(AF_INET, "127.0.0.1", &reinterpret_cast<sockaddr_in&>(address).sin_addr);
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < dispatchIterations; i++)
+	{
+		server.dispatch(INVALID_SOCKET, address);
+	}
+
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / dispatchIterations;
+}
+
+template<typename ServerT>
+static double measureConnections(ServerT& server, uint16_t port)
+{
+	sockaddr_in address = {};
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	server.start();
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < connectionIterations; i++)
+	{
+		SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+		if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		char byte;
+
+		recv(client, &byte, sizeof(byte), 0);
+
+		closesocket(client);
+	}
+
+	double result = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / connectionIterations;
+
+	server.stop();
+
+	return result;
+}
+
+int main(int argc, char** argv) try
+{
+	VirtualServer virtualServer("8090");
+	PolicyServer policyServer("8091");
+
+	double virtualDispatch = measureDispatch(virtualServer);
+	double policyDispatch = measureDispatch(policyServer);
+
+	std::cout << "Dispatch path (ns per connection)" << std::endl
+		<< "BaseTCPServer:   " << virtualDispatch << std::endl
+		<< "StaticTCPServer: " << policyDispatch << std::endl;
+
+	closeSockets = true;
+
+	std::cout << "Loopback connect/accept/close (us per connection)" << std::endl
+		<< "BaseTCPServer:   " << measureConnections(virtualServer, 8090) << std::endl
+		<< "StaticTCPServer: " << measureConnections(policyServer, 8091) << std::endl;
+
+	return handled ? 0 : -1;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
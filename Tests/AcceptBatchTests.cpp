@@ -0,0 +1,277 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#include <filesystem>
+#else
+#include <WS2tcpip.h>
+#endif
+
+static constexpr size_t batchSize = 8;
+static constexpr size_t numberOfQueuedClients = 2 * batchSize;
+
+/**
+ * @brief Answers each connection with one byte. Classification of first connection blocks accept thread, so next connections wait in listen queue
+ */
+class BatchServer : public web::BaseTCPServer
+{
+private:
+	mutable std::atomic<size_t> classified;
+
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char response = 's';
+
+		try
+		{
+			this->sendBytes(clientSocket, &response, sizeof(response));
+		}
+		catch (const std::exception&)
+		{
+
+		}
+
+		served++;
+	}
+
+	uint32_t classifyConnection(const std::string& ip, SOCKET clientSocket, sockaddr address) const override
+	{
+		if (!classified++)
+		{
+			blocked = true;
+			blocked.notify_all();
+
+			gate.wait(false);
+		}
+
+		if (failing && classified % 2)
+		{
+			failed++;
+
+			throw std::runtime_error("Can't classify connection");
+		}
+
+		return 0;
+	}
+
+public:
+	mutable std::atomic<bool> blocked;
+	std::atomic<bool> gate;
+	std::atomic<bool> failing;
+	mutable std::atomic<size_t> failed;
+	std::atomic<size_t> served;
+
+public:
+	BatchServer(bool failing) :
+		BaseTCPServer("0", "127.0.0.1"),
+		classified(0),
+		blocked(false),
+		gate(false),
+		failing(failing),
+		failed(0),
+		served(0)
+	{
+		this->setPriorityClasses({ { "default", 1, 0 } });
+		this->setAcceptBatchSize(batchSize);
+		this->setThreadPool(2);
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static SOCKET connectServer(uint16_t port)
+{
+	sockaddr_in address = {};
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	check(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect");
+
+	return client;
+}
+
+/**
+ * @brief Open descriptors of process. Windows doesn't expose them, so leaks are checked only on Linux
+ */
+static size_t getNumberOfDescriptors()
+{
+	size_t result = 0;
+
+#ifdef __LINUX__
+	for ([[maybe_unused]] const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("/proc/self/fd"))
+	{
+		result++;
+	}
+#endif
+
+	return result;
+}
+
+/**
+ * @brief Connect client, block accept thread in its classification and queue more clients behind it
+ * @return All clients, first is blocked one
+ */
+static std::vector<SOCKET> queueClients(BatchServer& server)
+{
+	std::vector<SOCKET> clients;
+
+	clients.push_back(connectServer(server.getServerPortV4()));
+
+	server.blocked.wait(false);
+
+	for (size_t i = 0; i < numberOfQueuedClients; i++)
+	{
+		clients.push_back(connectServer(server.getServerPortV4()));
+	}
+
+#ifdef __LINUX__
+	web::BaseTCPServer::AcceptStatistics statistics = server.getAcceptStatistics();
+
+	check(statistics.listenQueueLength == numberOfQueuedClients, "Wrong listen queue length");
+	check(statistics.listenQueueCapacity > 0, "Listen queue capacity isn't reported");
+#endif
+
+	server.gate = true;
+	server.gate.notify_all();
+
+	return clients;
+}
+
+/**
+ * @brief Queued connections are accepted in batches of setAcceptBatchSize
+ */
+static void batching()
+{
+	BatchServer server(false);
+
+	server.start();
+
+	std::vector<SOCKET> clients = queueClients(server);
+
+	for (SOCKET client : clients)
+	{
+		char response = 0;
+
+		check(recv(client, &response, sizeof(response), 0) == sizeof(response) && response == 's', "Connection isn't served");
+
+		closesocket(client);
+	}
+
+	web::BaseTCPServer::AcceptStatistics statistics = server.getAcceptStatistics();
+
+	// Blocked connection alone, then two full batches from listen queue
+	check(statistics.accepted == clients.size(), "Wrong number of accepted connections");
+	check(statistics.batches == 1 + numberOfQueuedClients / batchSize, "Wrong number of batches");
+	check(statistics.largestBatch == batchSize, "Wrong largest batch");
+
+#ifdef __LINUX__
+	check(!server.getAcceptStatistics().listenQueueLength, "Listen queue isn't drained");
+#endif
+
+	bool failed = false;
+
+	try
+	{
+		server.setAcceptBatchSize(1);
+	}
+	catch (const std::runtime_error&)
+	{
+		failed = true;
+	}
+
+	check(failed, "Accept batch size is changed while server is running");
+
+	server.stop();
+}
+
+/**
+ * @brief Failed setup closes only its connection, rest of batch is served and accept thread keeps running
+ */
+static void setupFailure()
+{
+	BatchServer server(true);
+
+	server.start();
+
+	size_t descriptors = getNumberOfDescriptors();
+	std::vector<SOCKET> clients = queueClients(server);
+	size_t responses = 0;
+
+	for (SOCKET client : clients)
+	{
+		char response = 0;
+
+		// Failed connection is closed without response
+		if (recv(client, &response, sizeof(response), 0) == sizeof(response))
+		{
+			check(response == 's', "Wrong response");
+
+			responses++;
+		}
+
+		closesocket(client);
+	}
+
+	check(server.failed && server.failed < clients.size(), "Setup failures aren't mixed with successful setups");
+	check(responses == clients.size() - server.failed, "Connections of failed batch aren't served");
+
+	waitFor([&server, &clients]() { return server.served == clients.size() - server.failed && !server.getNumberOfConnections(); });
+
+	check(getNumberOfDescriptors() == descriptors, "Sockets of failed setups are leaked");
+
+	server.failing = false;
+
+	SOCKET client = connectServer(server.getServerPortV4());
+	char response = 0;
+
+	check(recv(client, &response, sizeof(response), 0) == sizeof(response) && response == 's', "Accept thread stopped after setup failure");
+
+	closesocket(client);
+
+	server.stop();
+}
+
+int main(int argc, char** argv) try
+{
+	batching();
+
+	setupFailure();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,190 @@
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#endif
+
+static constexpr size_t warmUpConnections = 1000;
+static constexpr size_t measuredConnections = 10000;
+static constexpr size_t concurrentClients = 8;
+
+static std::atomic<size_t> allocations = 0;
+
+void* operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+
+	if (void* result = std::malloc(size ? size : 1))
+	{
+		return result;
+	}
+
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t size) noexcept
+{
+	std::free(pointer);
+}
+
+class EmptyServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char byte;
+
+		this->receiveBytes(clientSocket, &byte, sizeof(byte));
+	}
+
+public:
+	EmptyServer() :
+		BaseTCPServer("0", "127.0.0.1")
+	{
+
+	}
+};
+
+/**
+ * @brief Connect clients one after another
+ * @param sourceIp Client address, different addresses register different clients in server
+ */
+static void connectClients(uint16_t port, size_t count, const char* sourceIp = "127.0.0.1")
+{
+	sockaddr_in address = {};
+	sockaddr_in source = {};
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	source.sin_family = AF_INET;
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+	inet_pton(AF_INET, sourceIp, &source.sin_addr);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		char byte = 0;
+
+#ifdef __LINUX__
+		bind(client, reinterpret_cast<sockaddr*>(&source), sizeof(source));
+#endif
+
+		if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		send(client, &byte, sizeof(byte), 0);
+
+		// Wait until server closes connection
+		recv(client, &byte, sizeof(byte), 0);
+
+		closesocket(client);
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	EmptyServer server;
+
+	server.setThreadPool(2);
+	server.reserveConnections(64);
+
+	server.start();
+
+	uint16_t port = server.getServerPortV4();
+
+	connectClients(port, warmUpConnections);
+
+	allocations = 0;
+
+	connectClients(port, measuredConnections);
+
+	size_t result = allocations;
+
+	std::cout << "Allocations per " << measuredConnections << " connections: " << result << std::endl;
+
+	// Concurrent connects and disconnects from several IPs reuse slots released by other threads
+	{
+		static constexpr const char* sourceIps[] = { "127.0.0.1", "127.0.0.2", "127.0.0.3", "127.0.0.4" };
+
+		std::atomic<bool> startClients = false;
+		std::vector<std::thread> clients;
+		std::atomic<size_t> failedClients = 0;
+
+		for (size_t i = 0; i < concurrentClients; i++)
+		{
+			clients.emplace_back
+			(
+				[&, i]()
+				{
+					startClients.wait(false);
+
+					try
+					{
+						connectClients(port, measuredConnections / concurrentClients, sourceIps[i % std::size(sourceIps)]);
+					}
+					catch (const std::exception&)
+					{
+						failedClients++;
+					}
+				}
+			);
+		}
+
+		connectClients(port, warmUpConnections);
+
+		allocations = 0;
+
+		startClients = true;
+		startClients.notify_all();
+
+		for (std::thread& client : clients)
+		{
+			client.join();
+		}
+
+		size_t concurrentResult = allocations;
+
+		std::cout << "Allocations per " << measuredConnections << " concurrent connections: " << concurrentResult << std::endl;
+
+		if (failedClients)
+		{
+			std::cerr << "Failed clients: " << failedClients << std::endl;
+
+			return -1;
+		}
+
+		result += concurrentResult;
+	}
+
+	if (server.getNumberOfConnections())
+	{
+		std::cerr << "Connections left after clients disconnected: " << server.getNumberOfConnections() << std::endl;
+
+		return -1;
+	}
+
+	server.stop();
+
+	return result ? -1 : 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
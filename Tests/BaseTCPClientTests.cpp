@@ -0,0 +1,230 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <BaseTCPClient.h>
+#include <InMemoryTransport.h>
+
+class EchoServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char buffer[256];
+
+		try
+		{
+			while (int size = this->receiveBytes(clientSocket, buffer, sizeof(buffer)))
+			{
+				this->sendBytes(clientSocket, buffer, size);
+			}
+		}
+		catch (const std::exception&)
+		{
+
+		}
+	}
+
+public:
+	EchoServer() :
+		BaseTCPServer("0", "127.0.0.1")
+	{
+
+	}
+};
+
+/**
+ * @brief Handler forwards request to upstream echo server with client while Transport is installed for its connection
+ */
+class ProxyServer : public web::BaseTCPServer
+{
+private:
+	web::BaseTCPClient& client;
+	std::string upstreamPort;
+
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		std::string request(4, '\0');
+		std::string response(4, '\0');
+
+		this->receiveBytes(clientSocket, request.data(), static_cast<int>(request.size()));
+
+		try
+		{
+			web::BaseTCPClient::Connection connection = client.acquire("127.0.0.1", upstreamPort);
+
+			connection.sendBytes(request.data(), static_cast<int>(request.size()));
+			connection.receiveBytes(response.data(), static_cast<int>(response.size()));
+		}
+		catch (const std::exception& e)
+		{
+			response = e.what();
+		}
+
+		this->sendBytes(clientSocket, response.data(), static_cast<int>(response.size()));
+	}
+
+public:
+	ProxyServer(web::BaseTCPClient& client, std::string_view upstreamPort) :
+		BaseTCPServer("0", "127.0.0.1"),
+		client(client),
+		upstreamPort(upstreamPort)
+	{
+
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitConnections(EchoServer& server, size_t numberOfConnections)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (server.getNumberOfConnections() != numberOfConnections)
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static void echo(web::BaseTCPClient::Connection& connection)
+{
+	std::string response(4, '\0');
+
+	connection.sendBytes("ping", 4);
+
+	connection.receiveBytes(response.data(), static_cast<int>(response.size()));
+
+	check(response == "ping", "Wrong echo");
+}
+
+int main(int argc, char** argv) try
+{
+	EchoServer server;
+	web::BaseTCPClient client;
+	size_t healthChecks = 0;
+
+	server.setThreadPool(2);
+
+	// Kicked sockets are shut down, so handlers blocked in receive return and peer sees close
+	server.setSocketReaper();
+
+	server.start();
+
+	std::string port = std::to_string(server.getServerPortV4());
+
+	// Health check calls back into client, so it must run without client's lock
+	client.setHealthCheck
+	(
+		[&client, &healthChecks](SOCKET clientSocket)
+		{
+			healthChecks++;
+
+			return client.getStatistics().createdConnections && web::BaseTCPClient::isAlive(clientSocket);
+		}
+	);
+
+	{
+		web::BaseTCPClient::Connection connection = client.acquire("127.0.0.1", port);
+
+		check(!connection.isReused(), "First connection is reused");
+
+		echo(connection);
+	}
+
+	check(client.getNumberOfIdleConnections() == 1, "Connection isn't returned to pool");
+
+	{
+		web::BaseTCPClient::Connection connection = client.acquire("127.0.0.1", port);
+
+		check(connection.isReused(), "Idle connection isn't reused");
+
+		echo(connection);
+	}
+
+	// Server closes idle connection, client reconnects after failed health check
+	waitConnections(server, 1);
+
+	server.kickAll();
+
+	waitConnections(server, 0);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	{
+		web::BaseTCPClient::Connection connection = client.acquire("127.0.0.1", port);
+
+		check(!connection.isReused(), "Closed connection is reused");
+
+		echo(connection);
+
+		// Peer reset is reported with exception instead of SIGPIPE
+		waitConnections(server, 1);
+
+		server.kickAll();
+
+		bool failed = false;
+
+		for (size_t i = 0; i < 100 && !failed; i++)
+		{
+			try
+			{
+				connection.sendBytes("ping", 4);
+
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+			catch (const std::exception&)
+			{
+				failed = true;
+			}
+		}
+
+		check(failed && connection.isBroken(), "Send to closed connection doesn't fail");
+	}
+
+	web::BaseTCPClient::Statistics statistics = client.getStatistics();
+
+	check(statistics.createdConnections == 2, "Wrong number of created connections");
+	check(statistics.reusedConnections == 1, "Wrong number of reused connections");
+	check(statistics.failedHealthChecks == 1, "Wrong number of failed health checks");
+	check(healthChecks == 2, "Wrong number of health checks");
+	check(!client.getNumberOfIdleConnections(), "Broken connection is returned to pool");
+
+	// Upstream connection uses kernel socket while handler's connection is in memory
+	{
+		web::BaseTCPClient proxyClient;
+		ProxyServer proxy(proxyClient, port);
+		web::InMemoryTransport transport;
+		web::InMemoryTransport::Endpoints endpoints = transport.createConnection();
+		std::string response(4, '\0');
+
+		transport.sendBytes(endpoints.client, "pong", 4);
+		transport.finishSending(endpoints.client);
+
+		proxy.serveInMemory(transport, endpoints.server);
+
+		transport.receiveBytes(endpoints.client, response.data(), static_cast<int>(response.size()));
+
+		check(response == "pong", "Client doesn't work inside handler with Transport");
+		check(proxyClient.getNumberOfIdleConnections() == 1, "Upstream connection isn't returned to pool");
+	}
+
+	server.stop();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <BaseTCPServer.h>
+#include <ConnectionTracer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+/**
+ * @brief Handler waits in receive until connection is kicked
+ */
+class BlockingServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char buffer;
+
+		handlers++;
+
+		try
+		{
+			this->receiveBytes(clientSocket, &buffer, sizeof(buffer));
+		}
+		catch (const std::exception&)
+		{
+
+		}
+	}
+
+public:
+	std::atomic<size_t> handlers;
+
+public:
+	BlockingServer() :
+		BaseTCPServer("0", "127.0.0.1"),
+		handlers(0)
+	{
+		// Shutdown of kicked sockets wakes blocked handler
+		this->setSocketReaper();
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/**
+ * @brief Record events from new thread, so its buffer is created with current capacity
+ */
+static void recordInThread(size_t numberOfEvents, SOCKET firstSocket)
+{
+	std::thread
+	(
+		[numberOfEvents, firstSocket]()
+		{
+			for (size_t i = 0; i < numberOfEvents; i++)
+			{
+				web::ConnectionTracer::record(web::ConnectionTracer::EventType::received, static_cast<SOCKET>(firstSocket + i));
+			}
+		}
+	).join();
+}
+
+/**
+ * @brief Full ring keeps only newest events in order, capacity is rounded up to power of two
+ */
+static void wraparound()
+{
+	web::ConnectionTracer::clear();
+	web::ConnectionTracer::enable(5);
+
+	recordInThread(20, 100);
+
+	web::ConnectionTracer::disable();
+
+	std::vector<web::ConnectionTracer::Event> events = web::ConnectionTracer::getEvents();
+
+	check(events.size() == 8, "Wrong number of events after wraparound");
+
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		check(events[i].socket == 112 + i, "Oldest events aren't overwritten first");
+		check(events[i].type == web::ConnectionTracer::EventType::received, "Wrong event type");
+	}
+
+	for (size_t i = 1; i < events.size(); i++)
+	{
+		check(events[i - 1].timestamp <= events[i].timestamp, "Events aren't sorted by timestamp");
+	}
+
+	web::ConnectionTracer::clear();
+
+	check(web::ConnectionTracer::getEvents().empty(), "Events aren't cleared");
+}
+
+/**
+ * @brief Nothing is recorded while tracing is disabled, each thread writes its own buffer
+ */
+static void threads()
+{
+	web::ConnectionTracer::clear();
+
+	check(!web::ConnectionTracer::isEnabled(), "Tracing is enabled");
+
+	recordInThread(10, 200);
+
+	check(web::ConnectionTracer::getEvents().empty(), "Events are recorded while tracing is disabled");
+
+	web::ConnectionTracer::enable(64);
+
+	std::vector<std::thread> writers;
+	std::atomic<size_t> ready = 0;
+
+	for (size_t i = 0; i < 4; i++)
+	{
+		writers.emplace_back
+		(
+			[i, &ready]()
+			{
+				for (size_t j = 0; j < 16; j++)
+				{
+					web::ConnectionTracer::record(web::ConnectionTracer::EventType::received, static_cast<SOCKET>(1000 * (i + 1) + j));
+
+					// Every thread takes its buffer before any thread exits and returns buffer to pool
+					if (!j)
+					{
+						ready++;
+
+						while (ready != 4)
+						{
+							std::this_thread::yield();
+						}
+					}
+				}
+			}
+		);
+	}
+
+	for (std::thread& writer : writers)
+	{
+		writer.join();
+	}
+
+	web::ConnectionTracer::disable();
+
+	std::vector<web::ConnectionTracer::Event> events = web::ConnectionTracer::getEvents();
+
+	check(events.size() == 64, "Events of threads are lost");
+
+	for (const web::ConnectionTracer::Event& event : events)
+	{
+		for (const web::ConnectionTracer::Event& other : events)
+		{
+			check(event.socket / 1000 != other.socket / 1000 || event.thread == other.thread, "Events of one thread are in different buffers");
+			check(event.socket / 1000 == other.socket / 1000 || event.thread != other.thread, "Threads share buffer");
+		}
+	}
+
+	web::ConnectionTracer::clear();
+}
+
+/**
+ * @brief Served and kicked connections end with closed event, dump writes peer address
+ */
+static void lifecycle()
+{
+	BlockingServer server;
+	sockaddr_in address = {};
+	sockaddr_in clientAddress = {};
+#ifdef __LINUX__
+	socklen_t length = sizeof(clientAddress);
+#else
+	int length = sizeof(clientAddress);
+#endif
+
+	web::ConnectionTracer::clear();
+	web::ConnectionTracer::enable();
+
+	server.start();
+
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(server.getServerPortV4());
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	check(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect");
+
+	getsockname(client, reinterpret_cast<sockaddr*>(&clientAddress), &length);
+
+	waitFor([&server]() { return server.handlers == 1; });
+
+	server.kickAll();
+
+	waitFor([&server]() { return !server.getNumberOfConnections(); });
+
+	server.stop();
+
+	web::ConnectionTracer::disable();
+
+	std::vector<web::ConnectionTracer::Event> events = web::ConnectionTracer::getEvents();
+	std::vector<web::ConnectionTracer::EventType> types;
+
+	for (const web::ConnectionTracer::Event& event : events)
+	{
+		types.push_back(event.type);
+	}
+
+	std::vector<web::ConnectionTracer::EventType> expected =
+	{
+		web::ConnectionTracer::EventType::accepted,
+		web::ConnectionTracer::EventType::dispatched,
+		web::ConnectionTracer::EventType::handlerStart,
+		web::ConnectionTracer::EventType::kicked,
+		web::ConnectionTracer::EventType::closed
+	};
+
+	check(types.size() >= expected.size() && std::equal(expected.begin(), expected.end(), types.begin()), "Wrong events of kicked connection");
+	check(std::count(types.begin(), types.end(), web::ConnectionTracer::EventType::closed) == 1, "Kicked connection is closed twice");
+	check(events.front().peerPort == ntohs(clientAddress.sin_port), "Wrong peer port");
+
+	std::ostringstream stream;
+
+	web::ConnectionTracer::dump(stream);
+
+	std::string dump = stream.str();
+
+	check(dump.starts_with("timestamp,thread,event,socket,ip,port\n"), "Wrong dump header");
+	check(dump.find(",accepted,") != std::string::npos && dump.find("127.0.0.1," + std::to_string(ntohs(clientAddress.sin_port))) != std::string::npos, "Peer address isn't dumped");
+
+	web::ConnectionTracer::clear();
+
+	closesocket(client);
+}
+
+int main(int argc, char** argv) try
+{
+	wraparound();
+
+	threads();
+
+	lifecycle();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,157 @@
+#include <cctype>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <BaseTCPServer.h>
+
+static constexpr size_t benchmarkIterations = 100000;
+
+class EchoServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		int length = 0;
+		std::string message;
+
+		this->receiveBytes(clientSocket, &length, sizeof(int));
+
+		message.resize(length);
+
+		this->receiveBytes(clientSocket, message.data(), length);
+
+		message += " from echo server";
+
+		length = static_cast<int>(message.size());
+
+		this->sendBytes(clientSocket, &length, sizeof(int));
+
+		this->sendBytes(clientSocket, message.data(), length);
+	}
+
+public:
+	EchoServer() :
+		BaseTCPServer("8086")
+	{
+
+	}
+};
+
+/// @brief Answers each pipelined byte with its upper case through OutputBuffer
+class PipelineServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		web::OutputBuffer output(clientSocket);
+		char requests[16];
+
+		while (int size = this->receiveBytes(clientSocket, requests, sizeof(requests), output))
+		{
+			for (int i = 0; i < size; i++)
+			{
+				char response = static_cast<char>(std::toupper(requests[i]));
+
+				output.write(&response, sizeof(response));
+			}
+		}
+
+		output.flush();
+	}
+
+public:
+	PipelineServer() :
+		BaseTCPServer("8087")
+	{
+
+	}
+};
+
+/**
+ * @brief Send request from client endpoint, serve it and read response
+ * @return Response message
+ */
+static std::string echo(EchoServer& server, web::InMemoryTransport& transport, std::string_view request)
+{
+	web::InMemoryTransport::Endpoints endpoints = transport.createConnection();
+	int length = static_cast<int>(request.size());
+	std::string response;
+
+	transport.sendBytes(endpoints.client, reinterpret_cast<const char*>(&length), sizeof(int));
+	transport.sendBytes(endpoints.client, request.data(), length);
+	transport.finishSending(endpoints.client);
+
+	server.serveInMemory(transport, endpoints.server);
+
+	transport.receiveBytes(endpoints.client, reinterpret_cast<char*>(&length), sizeof(int));
+
+	response.resize(length);
+
+	transport.receiveBytes(endpoints.client, response.data(), length);
+
+	// Handler finished and cleanup closed server endpoint
+	if (char byte; transport.receiveBytes(endpoints.client, &byte, sizeof(byte)))
+	{
+		throw std::runtime_error("Unexpected data after response");
+	}
+
+	transport.closeEndpoint(endpoints.client);
+
+	return response;
+}
+
+int main(int argc, char** argv) try
+{
+	// Server isn't started, so no port is used
+	EchoServer server;
+	web::InMemoryTransport transport;
+
+	if (std::string response = echo(server, transport, "message"); response != "message from echo server")
+	{
+		std::cerr << "Wrong response: " << response << std::endl;
+
+		return -1;
+	}
+
+	// Coalesced responses must go through transport, not raw socket
+	{
+		PipelineServer pipelineServer;
+		web::InMemoryTransport::Endpoints endpoints = transport.createConnection();
+		std::string response(3, '\0');
+
+		transport.sendBytes(endpoints.client, "abc", 3);
+		transport.finishSending(endpoints.client);
+
+		pipelineServer.serveInMemory(transport, endpoints.server);
+
+		transport.receiveBytes(endpoints.client, response.data(), static_cast<int>(response.size()));
+		transport.closeEndpoint(endpoints.client);
+
+		if (response != "ABC")
+		{
+			std::cerr << "Wrong pipelined response: " << response << std::endl;
+
+			return -1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < benchmarkIterations; i++)
+	{
+		echo(server, transport, "message");
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	std::cout << "In-memory echo connections per second: " << benchmarkIterations / elapsed.count() << std::endl;
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
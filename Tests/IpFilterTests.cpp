@@ -0,0 +1,203 @@
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <IpFilter.h>
+
+struct LookupCase
+{
+	std::vector<std::string> allowed;
+	std::vector<std::string> denied;
+	std::string_view address;
+	web::IpFilter::Action action;
+	bool allowedAddress;
+};
+
+struct ParseCase
+{
+	std::string_view network;
+	bool valid;
+	uint32_t prefix;
+	uint8_t prefixLength;
+};
+
+struct CompressionCase
+{
+	std::vector<std::string> allowed;
+	std::vector<std::string> denied;
+	size_t numberOfNodes;
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static uint32_t parseAddress(std::string_view address)
+{
+	uint32_t prefix;
+	uint8_t prefixLength;
+
+	check(web::IpFilter::parseNetwork(address, prefix, prefixLength) && prefixLength == 32, "Wrong test address");
+
+	return prefix;
+}
+
+static void lookups()
+{
+	using enum web::IpFilter::Action;
+
+	const std::vector<LookupCase> cases =
+	{
+		// Default policy
+		{ {}, {}, "1.2.3.4", none, true },
+		{ {}, { "10.0.0.0/8" }, "1.2.3.4", none, true },
+		{ { "10.0.0.0/8" }, {}, "1.2.3.4", none, false },
+		{ { "10.0.0.0/8" }, {}, "10.200.0.1", allow, true },
+
+		// Longest prefix wins in both directions
+		{ { "10.0.0.0/8" }, { "10.1.0.0/16" }, "10.1.2.3", deny, false },
+		{ { "10.0.0.0/8" }, { "10.1.0.0/16" }, "10.2.2.3", allow, true },
+		{ { "10.1.2.0/24" }, { "10.0.0.0/8" }, "10.1.2.3", allow, true },
+		{ { "10.1.2.0/24" }, { "10.0.0.0/8" }, "10.1.3.3", deny, false },
+		{ { "10.0.0.0/8", "10.1.2.0/24" }, { "10.1.0.0/16" }, "10.1.2.200", allow, true },
+		{ { "10.0.0.0/8", "10.1.2.0/24" }, { "10.1.0.0/16" }, "10.1.9.1", deny, false },
+
+		// Deny wins for same prefix regardless of order
+		{ { "192.168.0.0/16" }, { "192.168.0.0/16" }, "192.168.1.1", deny, false },
+		{ { "192.168.1.1", "192.168.1.1/32" }, { "192.168.1.1/32" }, "192.168.1.1", deny, false },
+
+		// Host bits of rule are ignored
+		{ { "10.1.2.3/8" }, {}, "10.9.9.9", allow, true },
+
+		// /0 matches everything, /32 only one address
+		{ {}, { "0.0.0.0/0" }, "255.255.255.255", deny, false },
+		{ { "0.0.0.0/0" }, {}, "0.0.0.0", allow, true },
+		{ { "0.0.0.0/0" }, { "1.2.3.4/32" }, "1.2.3.4", deny, false },
+		{ { "0.0.0.0/0" }, { "1.2.3.4/32" }, "1.2.3.5", allow, true },
+		{ { "1.2.3.4/32" }, { "0.0.0.0/0" }, "1.2.3.4", allow, true },
+		{ { "1.2.3.4/32" }, { "0.0.0.0/0" }, "1.2.3.5", deny, false },
+		{ { "255.255.255.255" }, {}, "255.255.255.254", none, false },
+		{ { "255.255.255.255" }, {}, "255.255.255.255", allow, true },
+
+		// Sibling networks split by compressed node without rule
+		{ { "10.0.0.0/8", "11.0.0.0/8" }, {}, "11.0.0.1", allow, true },
+		{ { "10.0.0.0/8", "11.0.0.0/8" }, {}, "12.0.0.1", none, false },
+		{ { "10.0.0.0/8", "11.0.0.0/8" }, {}, "10.255.255.255", allow, true }
+	};
+
+	for (size_t i = 0; i < cases.size(); i++)
+	{
+		const LookupCase& current = cases[i];
+		web::IpFilter filter(current.allowed, current.denied);
+		uint32_t address = parseAddress(current.address);
+		std::string name = "Lookup case " + std::to_string(i) + ": ";
+
+		check(filter.find(address) == current.action, name + "wrong action");
+		check(filter.isAllowed(address) == current.allowedAddress, name + "wrong decision");
+		check(filter.getNumberOfRules() == current.allowed.size() + current.denied.size(), name + "wrong number of rules");
+	}
+}
+
+static void parsing()
+{
+	const std::vector<ParseCase> cases =
+	{
+		{ "1.2.3.4", true, 0x01020304, 32 },
+		{ "1.2.3.4/32", true, 0x01020304, 32 },
+		{ "1.2.3.4/24", true, 0x01020300, 24 },
+		{ "255.255.255.255/1", true, 0x80000000, 1 },
+		{ "0.0.0.0/0", true, 0, 0 },
+		{ "10.20.30.40/0", true, 0, 0 },
+		{ "1.2.3", false },
+		{ "1.2.3.", false },
+		{ "1.2.3.4.5", false },
+		{ "1.2.3.4/33", false },
+		{ "1.2.3.4/", false },
+		{ "1.2.3.4/-1", false },
+		{ "1.2.3.4/8x", false },
+		{ "1.2.3.4x", false },
+		{ "1.2.3.4 ", false },
+		{ " 1.2.3.4", false },
+		{ "256.0.0.0", false },
+		{ "1.2.3.1000", false },
+		{ "1..3.4", false },
+		{ "a.b.c.d", false },
+		{ "", false },
+		{ "/8", false }
+	};
+
+	for (const ParseCase& current : cases)
+	{
+		uint32_t prefix = 0;
+		uint8_t prefixLength = 0;
+		std::string name = "Network \"" + std::string(current.network) + "\": ";
+		bool valid = web::IpFilter::parseNetwork(current.network, prefix, prefixLength);
+
+		check(valid == current.valid, name + "wrong validity");
+
+		if (valid)
+		{
+			check(prefix == current.prefix && prefixLength == current.prefixLength, name + "wrong prefix");
+		}
+	}
+
+	bool failed = false;
+
+	try
+	{
+		web::IpFilter({ "10.0.0.0/8", "1.2.3" });
+	}
+	catch (const std::runtime_error&)
+	{
+		failed = true;
+	}
+
+	check(failed, "Wrong network is accepted by filter");
+}
+
+static void compression()
+{
+	const std::vector<CompressionCase> cases =
+	{
+		{ {}, {}, 1 },
+		{ { "0.0.0.0/0" }, {}, 1 },
+		// Chain of 8 single child nodes becomes one node
+		{ { "10.0.0.0/8" }, {}, 1 },
+		{ { "10.0.0.0/8" }, { "10.0.0.0/8" }, 1 },
+		{ { "10.0.0.0/8" }, { "10.1.0.0/16" }, 2 },
+		{ { "10.0.0.0/8" }, { "10.1.0.0/16", "10.1.2.3" }, 3 },
+		// 10 and 11 differ in last bit of first octet, so /7 node without rule splits them
+		{ { "10.0.0.0/8", "11.0.0.0/8" }, {}, 3 },
+		{ { "0.0.0.0/0", "128.0.0.0/1" }, { "1.2.3.4" }, 3 },
+		{ { "1.2.3.4", "1.2.3.5", "1.2.3.6", "1.2.3.7" }, {}, 7 }
+	};
+
+	for (size_t i = 0; i < cases.size(); i++)
+	{
+		const CompressionCase& current = cases[i];
+		web::IpFilter filter(current.allowed, current.denied);
+
+		check(filter.getNumberOfNodes() == current.numberOfNodes, "Compression case " + std::to_string(i) + ": wrong number of nodes " + std::to_string(filter.getNumberOfNodes()));
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	lookups();
+
+	parsing();
+
+	compression();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,196 @@
+#include <iostream>
+#include <string>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#include <sys/un.h>
+#include <unistd.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+static constexpr size_t numberOfRounds = 20;
+
+/**
+ * @brief Answers with index of listener that accepted connection
+ */
+class ListenerServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char response = 'c';
+
+		this->sendBytes(clientSocket, &response, sizeof(response));
+	}
+
+	void onListenerConnection(size_t listenerIndex, const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		if (!overrideListener)
+		{
+			this->BaseTCPServer::onListenerConnection(listenerIndex, ip, clientSocket, address, cleanup);
+
+			return;
+		}
+
+		char response = static_cast<char>('0' + listenerIndex);
+
+		this->sendBytes(clientSocket, &response, sizeof(response));
+	}
+
+public:
+	bool overrideListener;
+
+public:
+	ListenerServer(bool overrideListener) :
+		BaseTCPServer("0", "127.0.0.1"),
+		overrideListener(overrideListener)
+	{
+
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static char request(SOCKET client, const sockaddr* address, int addressLength)
+{
+	char response = 0;
+
+	check(connect(client, address, addressLength) != SOCKET_ERROR, "Can't connect");
+
+	recv(client, &response, sizeof(response), 0);
+
+	closesocket(client);
+
+	return response;
+}
+
+static char requestTcp(uint16_t port)
+{
+	sockaddr_in address = {};
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	return request(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+
+#ifdef __LINUX__
+static char requestUnix(const std::string& path)
+{
+	sockaddr_un address = {};
+
+	address.sun_family = AF_UNIX;
+
+	path.copy(address.sun_path, sizeof(address.sun_path) - 1);
+
+	return request(socket(AF_UNIX, SOCK_STREAM, 0), reinterpret_cast<const sockaddr*>(&address), sizeof(address));
+}
+#endif
+
+static void checkListeners(bool overrideListener, bool threadPool)
+{
+	ListenerServer server(overrideListener);
+#ifdef __LINUX__
+	std::string unixPath = "/tmp/BaseTCPServerListenerTests." + std::to_string(getpid()) + ".sock";
+#endif
+
+	if (threadPool)
+	{
+		server.setThreadPool(2);
+	}
+
+	check(server.addListener("0", "127.0.0.1") == 1, "Wrong index of first listener");
+	check(server.addListener("0", "127.0.0.1") == 2, "Wrong index of second listener");
+#ifdef __LINUX__
+	check(server.addListener("", web::BaseTCPServer::unixSocketPrefix.data() + unixPath) == 3, "Wrong index of Unix listener");
+#endif
+
+	server.start();
+
+	constexpr size_t numberOfTcpListeners = 3;
+
+#ifdef __LINUX__
+	check(server.getNumberOfListeners() == numberOfTcpListeners + 1, "Wrong number of listeners");
+	check(!server.getListenerPort(numberOfTcpListeners), "Unix listener has port");
+#else
+	check(server.getNumberOfListeners() == numberOfTcpListeners, "Wrong number of listeners");
+#endif
+	check(server.getListenerPort(0) == server.getServerPortV4(), "Wrong port of server's own listener");
+
+	for (size_t i = 1; i < numberOfTcpListeners; i++)
+	{
+		check(server.getListenerPort(i) && server.getListenerPort(i) != server.getListenerPort(0), "Listener isn't bound to its own port");
+	}
+
+	for (size_t round = 0; round < numberOfRounds; round++)
+	{
+		for (size_t i = 0; i < numberOfTcpListeners; i++)
+		{
+			char expected = overrideListener ? static_cast<char>('0' + i) : 'c';
+
+			check(requestTcp(server.getListenerPort(i)) == expected, "Connection is passed with wrong listener index");
+		}
+
+#ifdef __LINUX__
+		check(requestUnix(unixPath) == (overrideListener ? '3' : 'c'), "Unix connection is passed with wrong listener index");
+#endif
+	}
+
+	bool failed = false;
+
+	try
+	{
+		server.getListenerPort(server.getNumberOfListeners());
+	}
+	catch (const std::runtime_error&)
+	{
+		failed = true;
+	}
+
+	check(failed, "Wrong listener index is accepted");
+
+	failed = false;
+
+	try
+	{
+		server.addListener("0", "127.0.0.1");
+	}
+	catch (const std::runtime_error&)
+	{
+		failed = true;
+	}
+
+	check(failed, "Listener is added to running server");
+
+	server.stop();
+
+#ifdef __LINUX__
+	check(access(unixPath.data(), F_OK), "Unix socket file isn't removed");
+#endif
+}
+
+int main(int argc, char** argv) try
+{
+	checkListeners(true, false);
+	checkListeners(true, true);
+	checkListeners(false, true);
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
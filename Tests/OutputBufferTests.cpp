@@ -0,0 +1,131 @@
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <OutputBuffer.h>
+
+#ifdef __LINUX__
+#include <sys/socket.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+static constexpr size_t highWatermark = 64 * 1024;
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+/**
+ * @brief Connected pair of kernel sockets
+ */
+static std::pair<SOCKET, SOCKET> createSocketPair()
+{
+#ifdef __LINUX__
+	int sockets[2];
+
+	check(!socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), "Can't create socket pair");
+
+	return { sockets[0], sockets[1] };
+#else
+	// Sockets are created without server or client, which initialize Winsock
+	static WSADATA wsaData;
+	static bool initialized = !WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+	check(initialized, "Can't initialize Winsock");
+
+	sockaddr_in address = {};
+	int length = sizeof(address);
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	SOCKET first = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	listen(listenSocket, 1);
+	getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &length);
+
+	check(connect(first, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect socket pair");
+
+	SOCKET second = accept(listenSocket, nullptr, nullptr);
+
+	closesocket(listenSocket);
+
+	return { first, second };
+#endif
+}
+
+int main(int argc, char** argv) try
+{
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	web::OutputBuffer output(sockets.first);
+	std::string response(100, 'R');
+	size_t written = 0;
+	size_t received = 0;
+
+	std::thread reader
+	(
+		[&sockets, &received]()
+		{
+			char buffer[4096];
+
+			while (int size = recv(sockets.second, buffer, sizeof(buffer), 0))
+			{
+				if (size == SOCKET_ERROR)
+				{
+					break;
+				}
+
+				received += size;
+			}
+		}
+	);
+
+	// Pending request keeps read batch open, like client that keeps pipelining
+	send(sockets.second, "x", 1, 0);
+
+	output.write(response);
+
+	written += response.size();
+
+	check(!output.flushReadBatch() && output.size() == response.size(), "Read batch is flushed while request is pending");
+
+	for (size_t i = 0; i < 10000; i++)
+	{
+		output.write(response);
+
+		written += response.size();
+
+		check(output.size() < highWatermark, "Buffer grows above high watermark");
+		check(!output.flushReadBatch() || output.empty(), "Read batch isn't flushed completely");
+	}
+
+	output.flush();
+
+#ifdef __LINUX__
+	shutdown(sockets.first, SHUT_WR);
+#else
+	shutdown(sockets.first, SD_SEND);
+#endif
+
+	reader.join();
+
+	check(received == written, "Wrong number of received bytes");
+
+	closesocket(sockets.first);
+	closesocket(sockets.second);
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,204 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#endif
+
+/**
+ * @brief Answers each request byte with byte shifted by number of previous requests, parks connection between requests
+ */
+class ParkingServer : public web::BaseTCPServer
+{
+private:
+	void handle(SOCKET clientSocket, std::function<void()>& cleanup, int numberOfRequests)
+	{
+		char request;
+
+		try
+		{
+			if (!this->receiveBytes(clientSocket, &request, sizeof(request)))
+			{
+				return;
+			}
+
+			request += static_cast<char>(numberOfRequests);
+
+			this->sendBytes(clientSocket, &request, sizeof(request));
+
+			if (!numberOfRequests)
+			{
+				cleanup = [this, cleanup = std::move(cleanup)]()
+					{
+						cleanups++;
+
+						cleanup();
+					};
+			}
+
+			this->park(clientSocket, cleanup, numberOfRequests + 1);
+		}
+		catch (const std::exception&)
+		{
+
+		}
+	}
+
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		this->handle(clientSocket, cleanup, 0);
+	}
+
+	void onConnectionResume(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup, std::any& state) override
+	{
+		resumes++;
+
+		this->handle(clientSocket, cleanup, std::any_cast<int>(state));
+	}
+
+public:
+	std::atomic<size_t> resumes;
+	std::atomic<size_t> cleanups;
+
+public:
+	ParkingServer() :
+		BaseTCPServer("0", "127.0.0.1"),
+		resumes(0),
+		cleanups(0)
+	{
+
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static SOCKET connectServer(uint16_t port)
+{
+	sockaddr_in address = {};
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	check(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect");
+
+	return client;
+}
+
+static char request(SOCKET client, char value)
+{
+	char response = 0;
+
+	send(client, &value, sizeof(value), 0);
+
+	check(recv(client, &response, sizeof(response), 0) == sizeof(response), "No response");
+
+	return response;
+}
+
+/**
+ * @brief Parked connection is resumed with its state for each request
+ */
+static void resume(ParkingServer& server, uint16_t port)
+{
+	SOCKET client = connectServer(port);
+
+	for (int i = 0; i < 4; i++)
+	{
+		check(request(client, 'a') == 'a' + i, "Wrong state of resumed connection");
+	}
+
+	waitFor([&server]() { return server.getNumberOfParkedConnections() == 1; });
+
+	check(server.resumes == 3, "Wrong number of resumes");
+
+	// Last request arrives with FIN and is still served
+	char value = 'a';
+
+	send(client, &value, sizeof(value), 0);
+
+#ifdef __LINUX__
+	shutdown(client, SHUT_WR);
+#else
+	shutdown(client, SD_SEND);
+#endif
+
+	check(recv(client, &value, sizeof(value), 0) == sizeof(value) && value == 'a' + 4, "Request sent with FIN isn't served");
+
+	waitFor([&server]() { return !server.getNumberOfConnections(); });
+
+	check(server.resumes == 4 && server.cleanups == 1, "Connection closed after last request isn't cleaned up without dispatch");
+
+	closesocket(client);
+}
+
+/**
+ * @brief Connection closed by peer while parked is cleaned up without dispatch
+ */
+static void peerClose(ParkingServer& server, uint16_t port)
+{
+	SOCKET client = connectServer(port);
+	size_t resumes = server.resumes;
+	size_t cleanups = server.cleanups;
+
+	check(request(client, 'a') == 'a', "No response");
+
+	waitFor([&server]() { return server.getNumberOfParkedConnections() == 1; });
+
+	closesocket(client);
+
+	waitFor([&server]() { return !server.getNumberOfParkedConnections() && !server.getNumberOfConnections(); });
+
+	check(server.cleanups == cleanups + 1, "Cleanup of parked connection isn't called");
+	check(server.resumes == resumes, "Closed connection is dispatched");
+}
+
+int main(int argc, char** argv) try
+{
+	ParkingServer server;
+
+	server.setThreadPool(2);
+
+	server.start();
+
+	uint16_t port = server.getServerPortV4();
+
+	resume(server, port);
+
+	peerClose(server, port);
+
+	server.stop();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,218 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#endif
+
+static constexpr size_t numberOfRounds = 20;
+static constexpr std::string_view marker = "marker";
+
+/**
+ * @brief First byte of request selects what handler does
+ */
+enum Request : char
+{
+	/**
+	 * @brief Queue payload that doesn't fit into socket buffers and return, so connection is closed after flush
+	 */
+	queueAndReturn = 'r',
+	/**
+	 * @brief Queue payload and wait until connection is kicked
+	 */
+	queueAndWait = 'w',
+	/**
+	 * @brief Send marker and close
+	 */
+	sendMarker = 'm'
+};
+
+class QueueServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char request;
+
+		if (!this->receiveBytes(clientSocket, &request, sizeof(request)))
+		{
+			return;
+		}
+
+		if (request == Request::sendMarker)
+		{
+			this->sendBytes(clientSocket, marker.data(), static_cast<int>(marker.size()));
+
+			return;
+		}
+
+		std::shared_ptr<web::SendQueue> queue = this->createSendQueue(clientSocket, 64 * 1024, 16 * 1024);
+
+		queue->enqueue(payload);
+
+		queuedConnections++;
+
+		if (request == Request::queueAndWait)
+		{
+			// Returns or throws when kick shuts socket down
+			try
+			{
+				this->receiveBytes(clientSocket, &request, sizeof(request));
+			}
+			catch (const std::exception&)
+			{
+
+			}
+		}
+	}
+
+public:
+	web::SendQueue::Payload payload;
+	std::atomic<size_t> queuedConnections;
+
+public:
+	QueueServer() :
+		BaseTCPServer("0", "127.0.0.1"),
+		payload(std::make_shared<const std::string>(16 * 1024 * 1024, 'X')),
+		queuedConnections(0)
+	{
+
+	}
+};
+
+static SOCKET connectServer(uint16_t port)
+{
+	sockaddr_in address = {};
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+	{
+		THROW_WEB_SERVER_EXCEPTION;
+	}
+
+	return client;
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		if (std::chrono::steady_clock::now() > deadline)
+		{
+			throw std::runtime_error("Timeout");
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/**
+ * @brief Close client with reset, so server's pending send fails
+ */
+static void resetClient(SOCKET client)
+{
+	linger value = { 1, 0 };
+
+	setsockopt(client, SOL_SOCKET, SO_LINGER, reinterpret_cast<const char*>(&value), sizeof(value));
+
+	closesocket(client);
+}
+
+/**
+ * @brief Connect new client, which gets descriptor of previous connection if server already closed it, then reset previous client, so pending send wakes up, and check that new client receives only its own response
+ */
+static void checkNextConnection(QueueServer& server, SOCKET previousClient)
+{
+	SOCKET client = connectServer(server.getServerPortV4());
+	char request = Request::sendMarker;
+	std::string response;
+	char buffer[4096];
+
+	waitFor([&]() { return server.getNumberOfConnections() == 1; });
+
+	resetClient(previousClient);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+	send(client, &request, sizeof(request), 0);
+
+	while (int size = recv(client, buffer, sizeof(buffer), 0))
+	{
+		if (size == SOCKET_ERROR)
+		{
+			break;
+		}
+
+		response.append(buffer, size);
+	}
+
+	closesocket(client);
+
+	if (response != marker)
+	{
+		throw std::runtime_error("Next connection received " + std::to_string(response.size()) + " bytes instead of marker");
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	QueueServer server;
+
+	server.setThreadPool(2);
+
+	server.start();
+
+	uint16_t port = server.getServerPortV4();
+
+	// Client dies after handler returned and server closes connection after flush
+	for (size_t i = 0; i < numberOfRounds; i++)
+	{
+		SOCKET client = connectServer(port);
+		char request = Request::queueAndReturn;
+		size_t queued = server.queuedConnections + 1;
+
+		send(client, &request, sizeof(request), 0);
+
+		waitFor([&]() { return server.queuedConnections == queued && !server.getNumberOfConnections(); });
+
+		checkNextConnection(server, client);
+	}
+
+	// Connection with queued data is kicked while its handler is running
+	for (size_t i = 0; i < numberOfRounds; i++)
+	{
+		SOCKET client = connectServer(port);
+		char request = Request::queueAndWait;
+		size_t queued = server.queuedConnections + 1;
+
+		send(client, &request, sizeof(request), 0);
+
+		waitFor([&]() { return server.queuedConnections == queued; });
+
+		server.kick("127.0.0.1");
+
+		checkNextConnection(server, client);
+	}
+
+	server.stop();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,141 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <BaseTCPServer.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#endif
+
+static constexpr size_t numberOfClients = 20;
+
+/**
+ * @brief Server that wraps serve, optionally serving connection from its own thread
+ */
+class WrappingServer : public web::BaseTCPServer
+{
+private:
+	bool ownThread;
+
+private:
+	void serve(std::string ip, SOCKET clientSocket, sockaddr address) override
+	{
+		served++;
+
+		if (ownThread)
+		{
+			std::thread([this, ip, clientSocket, address]() { this->BaseTCPServer::serve(ip, clientSocket, address); }).join();
+		}
+		else
+		{
+			this->BaseTCPServer::serve(std::move(ip), clientSocket, address);
+		}
+	}
+
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char response = 'x';
+
+		handled++;
+
+		this->sendBytes(clientSocket, &response, sizeof(response));
+	}
+
+public:
+	std::atomic<size_t> served;
+	std::atomic<size_t> handled;
+
+public:
+	WrappingServer(bool ownThread) :
+		BaseTCPServer("0", "127.0.0.1"),
+		ownThread(ownThread),
+		served(0),
+		handled(0)
+	{
+
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static void request(uint16_t port)
+{
+	sockaddr_in address = {};
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	char response = 0;
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	check(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect");
+
+	recv(client, &response, sizeof(response), 0);
+
+	closesocket(client);
+
+	check(response == 'x', "Handler didn't run");
+}
+
+static void checkServer(bool ownThread, bool threadPool)
+{
+	WrappingServer server(ownThread);
+
+	if (threadPool)
+	{
+		server.setThreadPool(2);
+	}
+
+	server.start();
+
+	for (size_t i = 0; i < numberOfClients; i++)
+	{
+		request(server.getServerPortV4());
+	}
+
+	// Cleanup of base serve releases registration in both cases
+	waitFor([&server]() { return !server.getNumberOfConnections(); });
+
+	check(server.served == numberOfClients, "Overridden serve isn't called");
+	check(server.handled == numberOfClients, "Base serve doesn't call handler");
+
+	server.stop();
+}
+
+int main(int argc, char** argv) try
+{
+	checkServer(false, false);
+	checkServer(false, true);
+	checkServer(true, false);
+	checkServer(true, true);
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,292 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <SocketForwarder.h>
+
+#ifdef __LINUX__
+#include <fcntl.h>
+#include <sys/socket.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+static constexpr size_t bufferSize = 64 * 1024;
+static constexpr size_t payloadSize = 16 * 1024 * 1024;
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+/**
+ * @brief Connected pair of kernel sockets
+ */
+static std::pair<SOCKET, SOCKET> createSocketPair()
+{
+#ifdef __LINUX__
+	int sockets[2];
+
+	check(!socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), "Can't create socket pair");
+
+	return { sockets[0], sockets[1] };
+#else
+	// Sockets are created without server or client, which initialize Winsock
+	static WSADATA wsaData;
+	static bool initialized = !WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+	check(initialized, "Can't initialize Winsock");
+
+	sockaddr_in address = {};
+	int length = sizeof(address);
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	SOCKET first = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	listen(listenSocket, 1);
+	getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &length);
+
+	check(connect(first, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect socket pair");
+
+	SOCKET second = accept(listenSocket, nullptr, nullptr);
+
+	closesocket(listenSocket);
+
+	return { first, second };
+#endif
+}
+
+static void shutdownSend(SOCKET socket)
+{
+#ifdef __LINUX__
+	shutdown(socket, SHUT_WR);
+#else
+	shutdown(socket, SD_SEND);
+#endif
+}
+
+static void setNonBlocking(SOCKET socket, bool nonBlocking)
+{
+#ifdef __LINUX__
+	int flags = fcntl(socket, F_GETFL, 0);
+
+	fcntl(socket, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#else
+	u_long mode = nonBlocking;
+
+	ioctlsocket(socket, FIONBIO, &mode);
+#endif
+}
+
+static char getPayloadByte(size_t offset)
+{
+	return static_cast<char>(offset * 31 % 251);
+}
+
+/**
+ * @brief Send payload from offset
+ * @return New offset, stops early when non blocking socket is full
+ */
+static size_t sendPayload(SOCKET socket, size_t offset, size_t end)
+{
+	char buffer[4096];
+
+	while (offset < end)
+	{
+		size_t size = std::min(sizeof(buffer), end - offset);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			buffer[i] = getPayloadByte(offset + i);
+		}
+
+		int sent = send(socket, buffer, static_cast<int>(size), 0);
+
+		if (sent <= 0)
+		{
+			break;
+		}
+
+		offset += sent;
+	}
+
+	return offset;
+}
+
+/**
+ * @brief Receive until EOF and check bytes
+ * @return Number of received bytes
+ */
+static size_t receivePayload(SOCKET socket)
+{
+	char buffer[4096];
+	size_t received = 0;
+
+	while (true)
+	{
+		int size = recv(socket, buffer, sizeof(buffer), 0);
+
+		check(size != SOCKET_ERROR, "Receive failed");
+
+		if (!size)
+		{
+			return received;
+		}
+
+		for (int i = 0; i < size; i++)
+		{
+			check(buffer[i] == getPayloadByte(received + i), "Forwarded bytes are corrupted");
+		}
+
+		received += size;
+	}
+}
+
+/**
+ * @brief EOF of one side is passed as shutdown, other side still answers and forwarding ends after both directions finish
+ */
+static void halfClose()
+{
+	std::pair<SOCKET, SOCKET> client = createSocketPair();
+	std::pair<SOCKET, SOCKET> upstream = createSocketPair();
+
+	std::future<web::SocketForwarder::Result> forwarding = std::async(std::launch::async, [&client, &upstream]() { return web::SocketForwarder::forward(client.second, upstream.first, std::chrono::milliseconds(0), bufferSize); });
+	std::future<size_t> upstreamReceived = std::async
+	(
+		std::launch::async,
+		[&upstream]()
+		{
+			size_t received = receivePayload(upstream.second);
+			const char response[] = "done";
+
+			// Upstream answers only after request EOF, so half closed connection must stay open for response
+			send(upstream.second, response, sizeof(response) - 1, 0);
+
+			shutdownSend(upstream.second);
+
+			return received;
+		}
+	);
+
+	check(sendPayload(client.first, 0, payloadSize) == payloadSize, "Request isn't sent");
+
+	shutdownSend(client.first);
+
+	std::string response;
+	char buffer[16];
+
+	while (int size = recv(client.first, buffer, sizeof(buffer), 0))
+	{
+		check(size != SOCKET_ERROR, "Response isn't received");
+
+		response.append(buffer, size);
+	}
+
+	check(upstreamReceived.get() == payloadSize, "Request isn't forwarded completely");
+	check(response == "done", "Response after half close isn't forwarded");
+
+	web::SocketForwarder::Result result = forwarding.get();
+
+	check(result.firstToSecondBytes == payloadSize && result.secondToFirstBytes == response.size(), "Wrong number of forwarded bytes");
+	check(!result.failed && !result.timedOut, "Forwarding isn't finished cleanly");
+#ifdef __LINUX__
+	check(result.zeroCopy, "splice isn't used");
+#endif
+
+	for (SOCKET socket : { client.first, client.second, upstream.first, upstream.second })
+	{
+		closesocket(socket);
+	}
+}
+
+/**
+ * @brief Forwarder doesn't read more than it can write, so slow receiver stops sender
+ */
+static void backpressure()
+{
+	std::pair<SOCKET, SOCKET> client = createSocketPair();
+	std::pair<SOCKET, SOCKET> upstream = createSocketPair();
+
+	std::future<web::SocketForwarder::Result> forwarding = std::async(std::launch::async, [&client, &upstream]() { return web::SocketForwarder::forward(client.second, upstream.first, std::chrono::milliseconds(0), bufferSize); });
+
+	setNonBlocking(client.first, true);
+
+	size_t sent = 0;
+
+	// Sender fills socket buffers and forwarder's buffer, then waits for upstream
+	for (size_t i = 0; i < 100; i++)
+	{
+		sent = sendPayload(client.first, sent, payloadSize);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+
+	check(sent < payloadSize, "Sender isn't stopped by receiver that doesn't read");
+
+	setNonBlocking(client.first, false);
+
+	std::future<size_t> upstreamReceived = std::async(std::launch::async, [&upstream]() { return receivePayload(upstream.second); });
+
+	check(sendPayload(client.first, sent, payloadSize) == payloadSize, "Sender isn't resumed");
+
+	shutdownSend(client.first);
+	shutdownSend(upstream.second);
+
+	check(upstreamReceived.get() == payloadSize, "Bytes are lost after backpressure");
+
+	web::SocketForwarder::Result result = forwarding.get();
+
+	check(result.firstToSecondBytes == payloadSize && !result.secondToFirstBytes && !result.failed, "Wrong result after backpressure");
+
+	for (SOCKET socket : { client.first, client.second, upstream.first, upstream.second })
+	{
+		closesocket(socket);
+	}
+}
+
+/**
+ * @brief Forwarding stops without traffic after idle timeout
+ */
+static void idleTimeout()
+{
+	std::pair<SOCKET, SOCKET> client = createSocketPair();
+	std::pair<SOCKET, SOCKET> upstream = createSocketPair();
+
+	web::SocketForwarder::Result result = web::SocketForwarder::forward(client.second, upstream.first, std::chrono::milliseconds(100), bufferSize);
+
+	check(result.timedOut && !result.failed, "Idle forwarding isn't timed out");
+	check(!result.firstToSecondBytes && !result.secondToFirstBytes, "Bytes are forwarded without traffic");
+
+	for (SOCKET socket : { client.first, client.second, upstream.first, upstream.second })
+	{
+		closesocket(socket);
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	halfClose();
+
+	backpressure();
+
+	idleTimeout();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,296 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <BaseTCPServer.h>
+#include <SocketReaper.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#include <fcntl.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+static constexpr size_t numberOfSockets = 10;
+
+/**
+ * @brief Handler waits in receive until connection is kicked
+ */
+class BlockingServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char buffer;
+
+		handlers++;
+
+		try
+		{
+			this->receiveBytes(clientSocket, &buffer, sizeof(buffer));
+		}
+		catch (const std::exception&)
+		{
+
+		}
+
+		handlers--;
+	}
+
+public:
+	std::atomic<size_t> handlers;
+
+public:
+	BlockingServer() :
+		BaseTCPServer("0", "127.0.0.1"),
+		handlers(0)
+	{
+
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/**
+ * @brief Connected pair of kernel sockets
+ */
+static std::pair<SOCKET, SOCKET> createSocketPair()
+{
+#ifdef __LINUX__
+	int sockets[2];
+
+	check(!socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), "Can't create socket pair");
+
+	return { sockets[0], sockets[1] };
+#else
+	// Sockets are created without server or client, which initialize Winsock
+	static WSADATA wsaData;
+	static bool initialized = !WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+	check(initialized, "Can't initialize Winsock");
+
+	sockaddr_in address = {};
+	int length = sizeof(address);
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	SOCKET first = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	listen(listenSocket, 1);
+	getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &length);
+
+	check(connect(first, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect socket pair");
+
+	SOCKET second = accept(listenSocket, nullptr, nullptr);
+
+	closesocket(listenSocket);
+
+	return { first, second };
+#endif
+}
+
+/**
+ * @brief Descriptor is still open. Windows reuses handles differently, so it's checked only on Linux
+ */
+static bool isOpen(SOCKET socket)
+{
+#ifdef __LINUX__
+	return fcntl(socket, F_GETFD) != -1;
+#else
+	return true;
+#endif
+}
+
+/**
+ * @brief Reaped sockets are shut down at once, closed together after delay
+ */
+static void batching()
+{
+	web::SocketReaper reaper(std::chrono::milliseconds(200));
+	std::vector<std::pair<SOCKET, SOCKET>> pairs;
+	std::vector<SOCKET> sockets;
+
+	for (size_t i = 0; i < numberOfSockets; i++)
+	{
+		pairs.push_back(createSocketPair());
+	}
+
+	for (size_t i = 0; i < numberOfSockets / 2; i++)
+	{
+		reaper.reap(pairs[i].first);
+	}
+
+	for (size_t i = numberOfSockets / 2; i < numberOfSockets; i++)
+	{
+		sockets.push_back(pairs[i].first);
+	}
+
+	reaper.reap(sockets);
+
+	check(reaper.getNumberOfPendingSockets() == numberOfSockets && !reaper.getNumberOfClosedSockets(), "Sockets are closed before delay");
+
+	for (const auto& [reaped, peer] : pairs)
+	{
+		char buffer;
+
+		// Shutdown is seen by peer before close
+		check(!recv(peer, &buffer, sizeof(buffer), 0), "Reaped socket isn't shut down");
+		check(isOpen(reaped), "Socket is closed before delay");
+	}
+
+	reaper.waitIdle();
+
+	check(!reaper.getNumberOfPendingSockets() && reaper.getNumberOfClosedSockets() == numberOfSockets, "Batch isn't closed");
+
+	for (const auto& [reaped, peer] : pairs)
+	{
+		check(!isOpen(reaped), "Reaped socket isn't closed");
+
+		closesocket(peer);
+	}
+}
+
+/**
+ * @brief Receive blocked on reaped socket returns immediately
+ */
+static void wakeup()
+{
+	web::SocketReaper reaper(std::chrono::milliseconds(200));
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	std::atomic<bool> returned = false;
+
+	std::thread receiver
+	(
+		[&sockets, &returned]()
+		{
+			char buffer;
+
+			recv(sockets.first, &buffer, sizeof(buffer), 0);
+
+			returned = true;
+		}
+	);
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	reaper.reap(sockets.first);
+
+	waitFor([&returned]() { return returned.load(); });
+
+	check(reaper.getNumberOfPendingSockets() == 1, "Socket is closed while receive may still use it");
+
+	receiver.join();
+
+	reaper.waitIdle();
+
+	closesocket(sockets.second);
+}
+
+/**
+ * @brief Destructor closes queued sockets without waiting for delay
+ */
+static void destruction()
+{
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	{
+		web::SocketReaper reaper(std::chrono::seconds(30));
+
+		reaper.reap(sockets.first);
+	}
+
+	check(std::chrono::steady_clock::now() - start < std::chrono::seconds(10), "Destructor waits for delay");
+	check(!isOpen(sockets.first), "Destructor doesn't close queued socket");
+
+	closesocket(sockets.second);
+}
+
+/**
+ * @brief Kicked connections are closed by server's reaper and counted
+ */
+static void server()
+{
+	BlockingServer server;
+	std::vector<SOCKET> clients;
+
+	server.setSocketReaper();
+
+	server.start();
+
+	for (size_t i = 0; i < numberOfSockets; i++)
+	{
+		sockaddr_in address = {};
+		SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+		address.sin_family = AF_INET;
+		address.sin_port = htons(server.getServerPortV4());
+
+		inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+		check(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect");
+
+		clients.push_back(client);
+	}
+
+	waitFor([&server]() { return server.handlers == numberOfSockets; });
+
+	server.kickAll();
+
+	// Shutdown wakes handlers blocked in receive
+	waitFor([&server]() { return !server.handlers; });
+
+	server.stop();
+
+	check(server.getNumberOfReapedSockets() == numberOfSockets, "Wrong number of reaped sockets");
+	check(server.getLastDrainTime().count() > 0, "Drain time isn't measured");
+
+	for (SOCKET client : clients)
+	{
+		closesocket(client);
+	}
+}
+
+int main(int argc, char** argv) try
+{
+	batching();
+
+	wakeup();
+
+	destruction();
+
+	server();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
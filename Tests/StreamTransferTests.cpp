@@ -0,0 +1,292 @@
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <StreamTransfer.h>
+#include <InMemoryTransport.h>
+
+#ifdef __LINUX__
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+/**
+ * @brief Connected pair of kernel sockets
+ */
+static std::pair<SOCKET, SOCKET> createSocketPair()
+{
+#ifdef __LINUX__
+	int sockets[2];
+
+	check(!socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), "Can't create socket pair");
+
+	return { sockets[0], sockets[1] };
+#else
+	// Sockets are created without server or client, which initialize Winsock
+	static WSADATA wsaData;
+	static bool initialized = !WSAStartup(MAKEWORD(2, 2), &wsaData);
+
+	check(initialized, "Can't initialize Winsock");
+
+	sockaddr_in address = {};
+	int length = sizeof(address);
+	SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	SOCKET first = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	listen(listenSocket, 1);
+	getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &length);
+
+	check(connect(first, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect socket pair");
+
+	SOCKET second = accept(listenSocket, nullptr, nullptr);
+
+	closesocket(listenSocket);
+
+	return { first, second };
+#endif
+}
+
+static void closeSocketPair(const std::pair<SOCKET, SOCKET>& sockets)
+{
+	closesocket(sockets.first);
+	closesocket(sockets.second);
+}
+
+/**
+ * @brief Stop transfer blocked in recv after peer sent part of payload
+ */
+static void receiveCancellation()
+{
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	std::vector<std::byte> destination(1024 * 1024);
+	std::string partial(1000, 'X');
+	std::stop_source stop;
+	web::StreamTransfer::Options options;
+
+	options.stopToken = stop.get_token();
+
+	send(sockets.second, partial.data(), static_cast<int>(partial.size()), 0);
+
+	std::jthread canceller
+	(
+		[&stop]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+			stop.request_stop();
+		}
+	);
+
+	web::StreamTransfer::Result result = web::StreamTransfer::receive(sockets.first, destination, options);
+
+	check(result.cancelled, "Receive isn't cancelled");
+	check(!result.completed && !result.endOfStream, "Cancelled receive is reported as finished");
+	check(result.transferred == partial.size(), "Wrong number of received bytes before cancellation");
+
+	closeSocketPair(sockets);
+}
+
+/**
+ * @brief Stop transfer blocked in send because peer doesn't read
+ */
+static void sendCancellation()
+{
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	std::vector<std::byte> data(64 * 1024 * 1024);
+	std::stop_source stop;
+	web::StreamTransfer::Options options;
+
+	options.stopToken = stop.get_token();
+
+	std::jthread canceller
+	(
+		[&stop]()
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+			stop.request_stop();
+		}
+	);
+
+	web::StreamTransfer::Result result = web::StreamTransfer::send(sockets.first, data, options);
+
+	check(result.cancelled, "Send isn't cancelled");
+	check(!result.completed, "Cancelled send is reported as completed");
+	check(result.transferred < data.size(), "Wrong number of sent bytes before cancellation");
+
+	closeSocketPair(sockets);
+}
+
+/**
+ * @brief Payload is split into chunks of requested size and received as is
+ */
+static void chunks()
+{
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	std::vector<std::byte> data(1024 * 1024 + 123);
+	std::vector<std::byte> destination(data.size());
+	std::vector<uint64_t> progress;
+	web::StreamTransfer::Options options;
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<std::byte>(i * 31);
+	}
+
+	options.chunkSize = 64 * 1024;
+	options.onProgress = [&progress](uint64_t transferred, uint64_t total) { progress.push_back(transferred); };
+
+	std::jthread receiver
+	(
+		[&sockets, &destination]()
+		{
+			web::StreamTransfer::receive(sockets.second, destination);
+		}
+	);
+
+	web::StreamTransfer::Result result = web::StreamTransfer::send(sockets.first, data, options);
+
+	receiver.join();
+
+	check(result.completed && result.transferred == data.size(), "Payload isn't sent");
+	check(progress.size() >= (data.size() + options.chunkSize - 1) / options.chunkSize, "Chunk is larger than chunk size");
+	check(progress.back() == data.size(), "Wrong progress");
+	check(destination == data, "Wrong payload");
+
+	closesocket(sockets.first);
+
+	web::StreamTransfer::Result endOfStream = web::StreamTransfer::receive(sockets.second, destination);
+
+	check(endOfStream.endOfStream && !endOfStream.transferred, "Closed peer isn't reported");
+
+	closesocket(sockets.second);
+}
+
+#ifdef __LINUX__
+/**
+ * @brief Payload above INT_MAX is sent with 64-bit counters
+ */
+static void largePayload()
+{
+	constexpr size_t size = 2ULL * 1024 * 1024 * 1024 + 1024 * 1024;
+
+	std::pair<SOCKET, SOCKET> sockets = createSocketPair();
+	void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	uint64_t received = 0;
+	uint64_t lastProgress = 0;
+	web::StreamTransfer::Options options;
+
+	check(memory != MAP_FAILED, "Can't map payload");
+
+	options.onProgress = [&lastProgress](uint64_t transferred, uint64_t total) { lastProgress = transferred; };
+
+	std::jthread receiver
+	(
+		[&sockets, &received]()
+		{
+			std::vector<char> buffer(1024 * 1024);
+
+			while (ssize_t count = recv(sockets.second, buffer.data(), buffer.size(), 0))
+			{
+				if (count < 0)
+				{
+					break;
+				}
+
+				received += count;
+			}
+		}
+	);
+
+	web::StreamTransfer::Result result = web::StreamTransfer::send(sockets.first, std::span(static_cast<const std::byte*>(memory), size), options);
+
+	shutdown(sockets.first, SHUT_WR);
+
+	receiver.join();
+
+	munmap(memory, size);
+
+	check(result.transferred > INT_MAX, "Large payload is truncated");
+	check(result.completed && result.transferred == size, "Large payload isn't sent");
+	check(lastProgress == size && received == size, "Wrong number of received bytes");
+
+	closeSocketPair(sockets);
+}
+#endif
+
+/**
+ * @brief Transfer goes through installed transport
+ */
+static void transport()
+{
+	web::InMemoryTransport transport;
+	web::InMemoryTransport::Endpoints endpoints = transport.createConnection();
+	web::Transport::Scope scope(transport);
+	std::vector<std::byte> data(300 * 1024);
+	std::vector<std::byte> destination(data.size());
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		data[i] = static_cast<std::byte>(i * 7);
+	}
+
+	web::StreamTransfer::Result sent = web::StreamTransfer::send(endpoints.client, data);
+
+	check(sent.completed && transport.getNumberOfPendingBytes(endpoints.server) == data.size(), "Payload isn't sent through transport");
+
+	web::StreamTransfer::Result received = web::StreamTransfer::receive(endpoints.server, destination);
+
+	check(received.completed && destination == data, "Payload isn't received through transport");
+
+	std::stop_source stop;
+	web::StreamTransfer::Options options;
+
+	options.stopToken = stop.get_token();
+
+	stop.request_stop();
+
+	web::StreamTransfer::Result cancelled = web::StreamTransfer::send(endpoints.client, data, options);
+
+	check(cancelled.cancelled && !cancelled.transferred, "Stop request is ignored with transport");
+}
+
+int main(int argc, char** argv) try
+{
+	receiveCancellation();
+
+	sendCancellation();
+
+	chunks();
+
+#ifdef __LINUX__
+	largePayload();
+#endif
+
+	transport();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
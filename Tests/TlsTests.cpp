@@ -0,0 +1,220 @@
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <BaseTCPServer.h>
+#include <TlsConnection.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#endif
+
+/// @brief Echo server that serves TLS through Transport, so handler uses ordinary sendBytes and receiveBytes
+class TlsEchoServer : public web::BaseTCPServer
+{
+private:
+	const web::TlsContext& context;
+
+public:
+	std::atomic<size_t> failedHandshakes;
+
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		try
+		{
+			web::TlsConnection connection(context, clientSocket);
+			web::Transport::Scope scope(connection);
+			char buffer[4096];
+
+			while (int size = this->receiveBytes(clientSocket, buffer, sizeof(buffer)))
+			{
+				this->sendBytes(clientSocket, buffer, size);
+			}
+		}
+		catch (const std::exception&)
+		{
+			failedHandshakes++;
+		}
+	}
+
+public:
+	TlsEchoServer(const web::TlsContext& context) :
+		BaseTCPServer("0", "127.0.0.1"),
+		context(context),
+		failedHandshakes(0)
+	{
+
+	}
+};
+
+/**
+ * @brief Write self signed certificate and its key into PEM files
+ */
+static void createCertificate(const std::filesystem::path& certificatePath, const std::filesystem::path& privateKeyPath)
+{
+	std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)> key(EVP_EC_gen("P-256"), &EVP_PKEY_free);
+	std::unique_ptr<X509, decltype(&X509_free)> certificate(X509_new(), &X509_free);
+
+	if (!key || !certificate)
+	{
+		throw std::runtime_error("Can't create certificate");
+	}
+
+	X509_set_version(certificate.get(), 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(certificate.get()), 1);
+	X509_gmtime_adj(X509_getm_notBefore(certificate.get()), 0);
+	X509_gmtime_adj(X509_getm_notAfter(certificate.get()), 60 * 60);
+	X509_set_pubkey(certificate.get(), key.get());
+
+	X509_NAME* name = X509_get_subject_name(certificate.get());
+
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+	X509_set_issuer_name(certificate.get(), name);
+
+	if (!X509_sign(certificate.get(), key.get(), EVP_sha256()))
+	{
+		throw std::runtime_error("Can't sign certificate");
+	}
+
+	std::unique_ptr<FILE, decltype(&fclose)> certificateFile(fopen(certificatePath.string().data(), "w"), &fclose);
+	std::unique_ptr<FILE, decltype(&fclose)> privateKeyFile(fopen(privateKeyPath.string().data(), "w"), &fclose);
+
+	if (!certificateFile || !privateKeyFile || !PEM_write_X509(certificateFile.get(), certificate.get()) || !PEM_write_PrivateKey(privateKeyFile.get(), key.get(), nullptr, nullptr, 0, nullptr, nullptr))
+	{
+		throw std::runtime_error("Can't write certificate");
+	}
+}
+
+static SOCKET connectServer(uint16_t port)
+{
+	sockaddr_in address = {};
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	if (connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR)
+	{
+		THROW_WEB_SERVER_EXCEPTION;
+	}
+
+	return client;
+}
+
+/**
+ * @brief Make client handshake, send messages of different sizes and compare echo
+ */
+static void echo(SSL_CTX* clientContext, uint16_t port)
+{
+	SOCKET client = connectServer(port);
+	std::unique_ptr<SSL, decltype(&SSL_free)> ssl(SSL_new(clientContext), &SSL_free);
+
+	SSL_set_fd(ssl.get(), static_cast<int>(client));
+
+	if (SSL_connect(ssl.get()) != 1)
+	{
+		closesocket(client);
+
+		throw std::runtime_error("Client handshake failed");
+	}
+
+	for (size_t size : { 1, 100, 16 * 1024 + 1, 256 * 1024 })
+	{
+		std::string message(size, '\0');
+		std::string response(size, '\0');
+		size_t received = 0;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			message[i] = static_cast<char>('a' + i % 26);
+		}
+
+		if (SSL_write(ssl.get(), message.data(), static_cast<int>(size)) != static_cast<int>(size))
+		{
+			throw std::runtime_error("Can't send message");
+		}
+
+		while (received < size)
+		{
+			int result = SSL_read(ssl.get(), response.data() + received, static_cast<int>(size - received));
+
+			if (result <= 0)
+			{
+				throw std::runtime_error("Can't receive echo");
+			}
+
+			received += result;
+		}
+
+		if (response != message)
+		{
+			throw std::runtime_error("Wrong echo of " + std::to_string(size) + " bytes");
+		}
+	}
+
+	SSL_shutdown(ssl.get());
+
+	closesocket(client);
+}
+
+int main(int argc, char** argv) try
+{
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+	std::filesystem::path certificatePath = directory / "BaseTCPServerTlsTests.crt";
+	std::filesystem::path privateKeyPath = directory / "BaseTCPServerTlsTests.key";
+
+	createCertificate(certificatePath, privateKeyPath);
+
+	web::TlsContext context(certificatePath.string(), privateKeyPath.string());
+	std::unique_ptr<SSL_CTX, decltype(&SSL_CTX_free)> clientContext(SSL_CTX_new(TLS_client_method()), &SSL_CTX_free);
+	TlsEchoServer server(context);
+
+	std::filesystem::remove(certificatePath);
+	std::filesystem::remove(privateKeyPath);
+
+	server.start();
+
+	uint16_t port = server.getServerPortV4();
+
+	echo(clientContext.get(), port);
+
+	// Plain text client fails handshake, server keeps serving
+	{
+		SOCKET client = connectServer(port);
+		char byte;
+
+		send(client, "GET / HTTP/1.1\r\n\r\n", 18, 0);
+
+		recv(client, &byte, sizeof(byte), 0);
+
+		closesocket(client);
+	}
+
+	echo(clientContext.get(), port);
+
+	server.stop();
+
+	if (server.failedHandshakes != 1)
+	{
+		std::cerr << "Wrong number of failed handshakes: " << server.failedHandshakes << std::endl;
+
+		return -1;
+	}
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,231 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <BaseTCPServer.h>
+#include <TransportStatistics.h>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+/**
+ * @brief Handler keeps connection open until client closes it
+ */
+class WaitingServer : public web::BaseTCPServer
+{
+private:
+	void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) override
+	{
+		char buffer[16];
+
+		handlers++;
+
+		try
+		{
+			while (this->receiveBytes(clientSocket, buffer, sizeof(buffer)))
+			{
+
+			}
+		}
+		catch (const std::exception&)
+		{
+
+		}
+	}
+
+public:
+	std::atomic<size_t> handlers;
+
+public:
+	WaitingServer() :
+		BaseTCPServer("0", "127.0.0.1"),
+		handlers(0)
+	{
+
+	}
+};
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate)
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+static web::TransportStatistics::Sample createSample(const std::string& ip, SOCKET clientSocket, uint32_t rtt, uint64_t sentSegments, uint64_t retransmittedSegments, uint32_t sendQueueBytes = 0)
+{
+	web::TransportInfo info = {};
+
+	info.rttMicroseconds = rtt;
+	info.sentSegments = sentSegments;
+	info.retransmittedSegments = retransmittedSegments;
+	info.sendQueueBytes = sendQueueBytes;
+
+	return { ip, clientSocket, info };
+}
+
+/**
+ * @brief Counters of connections are added as deltas between rounds, RTT goes into histogram
+ */
+static void aggregation()
+{
+	web::TransportStatistics statistics;
+
+	statistics.add
+	(
+		{
+			createSample("10.0.0.1", 1, 100, 10, 1, 500),
+			createSample("10.0.0.1", 2, 300, 20, 0, 500),
+			createSample("10.0.0.2", 3, 0, 5, 0)
+		}
+	);
+
+	// Connection 2 is closed, descriptor 3 is reused by new connection with smaller counters
+	statistics.add
+	(
+		{
+			createSample("10.0.0.1", 1, 100, 30, 3, 1000),
+			createSample("10.0.0.2", 3, 0, 2, 0)
+		}
+	);
+
+	std::unordered_map<std::string, web::TransportStatistics::ClientStatistics> clients = statistics.getClients();
+	const web::TransportStatistics::ClientStatistics& first = clients["10.0.0.1"];
+	const web::TransportStatistics::ClientStatistics& second = clients["10.0.0.2"];
+
+	check(clients.size() == 2, "Wrong number of clients");
+	check(first.samples == 3 && first.rttSumMicroseconds == 500 && first.maxRttMicroseconds == 300, "Wrong RTT of client");
+	check(std::abs(first.getAverageRttMicroseconds() - 500.0 / 3) < 1e-9, "Wrong average RTT");
+	check(first.sentSegments == 50 && first.retransmittedSegments == 3, "Counters aren't added as deltas");
+	check(std::abs(first.getRetransmitRate() - 0.06) < 1e-9, "Wrong retransmit rate");
+	check(first.sendQueueBytes == 1000, "Send queue isn't taken from last round");
+	check(second.sentSegments == 7, "Reused descriptor isn't treated as new connection");
+
+	std::array<uint64_t, web::TransportStatistics::numberOfRttBuckets> histogram = statistics.getRttHistogram();
+
+	// bit_width(100) == 7, bit_width(300) == 9
+	check(histogram[0] == 2 && histogram[7] == 2 && histogram[9] == 1, "Wrong RTT histogram");
+	check(statistics.getNumberOfSamples() == 5, "Wrong number of samples");
+	check(!statistics.getRttPercentile(0), "Wrong minimal RTT percentile");
+	check(statistics.getRttPercentile(50) == 127, "Wrong median RTT");
+	check(statistics.getRttPercentile(100) == 511, "Wrong maximal RTT percentile");
+
+	statistics.clear();
+
+	check(!statistics.getNumberOfSamples() && statistics.getClients().empty() && !statistics.getRttPercentile(50), "Statistics aren't cleared");
+}
+
+/**
+ * @brief Clients above limit share other entry, idle clients are forgotten
+ */
+static void clientLimit()
+{
+	web::TransportStatistics statistics(3, 2);
+
+	statistics.add({ createSample("a", 1, 100, 10, 0), createSample("b", 2, 100, 10, 0), createSample("c", 3, 100, 10, 0), createSample("d", 4, 100, 10, 0), createSample("e", 5, 100, 10, 0) });
+
+	std::unordered_map<std::string, web::TransportStatistics::ClientStatistics> clients = statistics.getClients();
+
+	check(clients.size() == 4 && clients[std::string(web::TransportStatistics::otherClients)].samples == 2, "Clients above limit aren't merged");
+
+	statistics.add({ createSample("a", 1, 100, 10, 0) });
+
+	check(statistics.getClients().size() == 4, "Clients are forgotten before idle rounds");
+
+	statistics.add({ createSample("a", 1, 100, 10, 0) });
+
+	clients = statistics.getClients();
+
+	check(clients.size() == 1 && clients.contains("a"), "Idle clients aren't forgotten");
+}
+
+/**
+ * @brief Kernel information of real connection is sampled by server
+ */
+static void sampling()
+{
+	WaitingServer server;
+	sockaddr_in address = {};
+
+	server.start();
+
+	SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+	address.sin_family = AF_INET;
+	address.sin_port = htons(server.getServerPortV4());
+
+	inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+	check(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != SOCKET_ERROR, "Can't connect");
+
+	waitFor([&server]() { return server.handlers == 1; });
+
+	const char data[] = "data";
+
+	send(client, data, sizeof(data), 0);
+
+	web::TransportInfo info;
+
+	check(web::TransportStatistics::sample(client, info), "TCP socket isn't sampled");
+	check(info.congestionWindowBytes > 0, "Congestion window isn't sampled");
+#ifdef __LINUX__
+	check(info.sentSegments > 0, "Sent segments aren't sampled");
+	check(info.minRttMicroseconds <= info.rttMicroseconds, "Minimal RTT is above smoothed RTT");
+#endif
+
+	server.sampleTransport();
+
+	std::unordered_map<std::string, web::TransportStatistics::ClientStatistics> clients = server.getTransportStatistics().getClients();
+
+	check(clients.size() == 1 && clients["127.0.0.1"].samples == 1, "Server connection isn't sampled");
+
+	closesocket(client);
+
+	server.stop();
+
+#ifdef __LINUX__
+	int sockets[2];
+
+	check(!socketpair(AF_UNIX, SOCK_STREAM, 0, sockets), "Can't create socket pair");
+	check(!web::TransportStatistics::sample(sockets[0], info), "Non TCP socket is sampled");
+
+	closesocket(sockets[0]);
+	closesocket(sockets[1]);
+#endif
+}
+
+int main(int argc, char** argv) try
+{
+	aggregation();
+
+	clientLimit();
+
+	sampling();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <string>
+
+#include <WeightedFairQueue.h>
+
+static constexpr size_t interactiveClass = 0;
+static constexpr size_t bulkClass = 1;
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+/**
+ * @brief Push numbered items into class, item encodes class and position
+ */
+static void push(web::WeightedFairQueue<int>& queue, size_t classIndex, int count, int& next)
+{
+	for (int i = 0; i < count; i++)
+	{
+		queue.push(classIndex, static_cast<int>(classIndex) * 10000 + next++);
+	}
+}
+
+/**
+ * @brief Pop items and check FIFO order inside each class
+ * @return Class of each popped item, 'I' for interactive and 'B' for bulk
+ */
+static std::string pop(web::WeightedFairQueue<int>& queue, size_t count, int (&last)[2])
+{
+	std::string result;
+	int item;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		check(queue.pop(item), "Queue is empty");
+
+		size_t classIndex = item / 10000;
+
+		check(item > last[classIndex], "Items of class are popped out of order");
+
+		last[classIndex] = item;
+
+		result += classIndex == interactiveClass ? 'I' : 'B';
+	}
+
+	return result;
+}
+
+static std::string repeat(std::string_view pattern, size_t count)
+{
+	std::string result;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		result += pattern;
+	}
+
+	return result;
+}
+
+int main(int argc, char** argv) try
+{
+	web::WeightedFairQueue<int> queue({ 3, 1 });
+	int nextInteractive = 0;
+	int nextBulk = 0;
+	int last[2] = { -1, bulkClass * 10000 - 1 };
+	int item;
+
+	check(!queue.pop(item), "Empty queue returns item");
+
+	// Under backlog weights 3 and 1 give smooth interleaving with 3 interactive pops per bulk pop
+	push(queue, interactiveClass, 40, nextInteractive);
+	push(queue, bulkClass, 40, nextBulk);
+
+	check(pop(queue, 40, last) == repeat("IIBI", 10), "Wrong interleaving");
+	check(queue.getServed(interactiveClass) == 30 && queue.getServed(bulkClass) == 10, "Wrong served ratio");
+	check(queue.size(interactiveClass) == 10 && queue.size(bulkClass) == 30, "Wrong sizes");
+
+	// Interactive class drains, then bulk class is served alone
+	check(pop(queue, 40, last) == repeat("IIBI", 3) + "IB" + std::string(26, 'B'), "Wrong order after drain");
+	check(!queue.pop(item), "Drained queue returns item");
+	check(queue.getServed(interactiveClass) == 40 && queue.getServed(bulkClass) == 40, "Wrong served counters");
+
+	// Bulk class stays idle while interactive class is served alone
+	push(queue, interactiveClass, 100, nextInteractive);
+
+	check(pop(queue, 100, last) == std::string(100, 'I'), "Wrong single class order");
+
+	// Idle class returns with zero credit: same interleaving as fresh queue, no burst of bulk pops
+	push(queue, interactiveClass, 60, nextInteractive);
+	push(queue, bulkClass, 20, nextBulk);
+
+	check(pop(queue, 80, last) == repeat("IIBI", 20), "Idle class bursts after return");
+
+	// Class that drained with positive credit starts from zero too
+	push(queue, interactiveClass, 2, nextInteractive);
+	push(queue, bulkClass, 2, nextBulk);
+
+	check(pop(queue, 4, last) == "IIBB", "Wrong order of short backlog");
+
+	push(queue, interactiveClass, 12, nextInteractive);
+	push(queue, bulkClass, 4, nextBulk);
+
+	check(pop(queue, 16, last) == repeat("IIBI", 4), "Drained class keeps credit");
+
+	// Removed item is newest equal item of its class, others keep their order
+	queue.push(interactiveClass, 1);
+	queue.push(interactiveClass, 2);
+	queue.push(interactiveClass, 1);
+
+	check(queue.remove(interactiveClass, 1) && queue.size(interactiveClass) == 2, "Item isn't removed");
+	check(!queue.remove(bulkClass, 2) && !queue.remove(interactiveClass, 3) && !queue.remove(2, 1), "Missing item is removed");
+	check(queue.pop(item) && item == 1 && queue.pop(item) && item == 2 && !queue.pop(item), "Wrong order after remove");
+
+	try
+	{
+		queue.push(2, 0);
+
+		check(false, "Wrong class index is accepted");
+	}
+	catch (const std::out_of_range&)
+	{
+
+	}
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
@@ -0,0 +1,201 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <WorkStealingThreadPool.h>
+
+static constexpr int numberOfStolenTasks = 16;
+
+static void check(bool condition, std::string_view message)
+{
+	if (!condition)
+	{
+		throw std::runtime_error(std::string(message));
+	}
+}
+
+static void waitFor(const std::function<bool()>& predicate, std::chrono::seconds timeout = std::chrono::seconds(10))
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+
+	while (!predicate())
+	{
+		check(std::chrono::steady_clock::now() < deadline, "Timeout");
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+/**
+ * @brief Every task runs, remaining tasks are executed by destructor
+ */
+static void execution()
+{
+	constexpr size_t numberOfTasks = 10000;
+
+	std::atomic<size_t> executed = 0;
+
+	{
+		web::WorkStealingThreadPool pool(4);
+
+		check(pool.getNumberOfWorkers() == 4, "Wrong number of workers");
+
+		for (size_t i = 0; i < numberOfTasks; i++)
+		{
+			pool.addTask([&executed]() { executed++; });
+		}
+	}
+
+	check(executed == numberOfTasks, "Not all tasks are executed");
+}
+
+/**
+ * @brief Tasks queued behind blocked worker are stolen oldest first
+ */
+static void stealOrder()
+{
+	web::WorkStealingThreadPool pool(2);
+	std::mutex orderMutex;
+	std::vector<int> order;
+	std::atomic<bool> gate = false;
+	std::atomic<int> finished = 0;
+
+	pool.addTask
+	(
+		[&]()
+		{
+			// Keeps other worker busy until all tasks are queued, so their order doesn't depend on timing
+			pool.addTask([&gate]() { gate.wait(false); });
+
+			for (int i = 0; i < numberOfStolenTasks; i++)
+			{
+				pool.addTask
+				(
+					[&, i]()
+					{
+						std::lock_guard<std::mutex> lock(orderMutex);
+
+						order.push_back(i);
+
+						finished++;
+					}
+				);
+			}
+
+			gate = true;
+			gate.notify_all();
+
+			// Blocked handler, its queue is served only by thief
+			waitFor([&finished]() { return finished == numberOfStolenTasks; });
+		}
+	);
+
+	waitFor([&finished]() { return finished == numberOfStolenTasks; });
+
+	for (int i = 0; i < numberOfStolenTasks; i++)
+	{
+		check(order[i] == i, "Stolen tasks aren't served oldest first");
+	}
+
+	uint64_t stolenTasks = 0;
+
+	for (const web::WorkStealingThreadPool::WorkerStatistics& statistics : pool.getWorkersStatistics())
+	{
+		stolenTasks += statistics.stolenTasks;
+	}
+
+	check(stolenTasks >= numberOfStolenTasks, "Tasks of blocked worker aren't stolen");
+}
+
+/**
+ * @brief Pool grows while tasks wait for blocked workers and shrinks back after idle period
+ */
+static void adaptiveSizing()
+{
+	web::WorkStealingThreadPool::SizingOptions options;
+
+	options.minWorkers = 1;
+	options.maxWorkers = 4;
+	options.interval = std::chrono::milliseconds(10);
+	options.growSamples = 2;
+	options.shrinkSamples = 5;
+
+	web::WorkStealingThreadPool pool(options);
+	std::atomic<bool> release = false;
+	std::atomic<size_t> finished = 0;
+
+	check(pool.getNumberOfWorkers() == 1, "Pool doesn't start with minWorkers");
+
+	for (size_t i = 0; i < 8; i++)
+	{
+		pool.addTask
+		(
+			[&release, &finished]()
+			{
+				release.wait(false);
+
+				finished++;
+			}
+		);
+	}
+
+	waitFor([&pool]() { return pool.getNumberOfWorkers() == 4; });
+
+	release = true;
+	release.notify_all();
+
+	waitFor([&finished]() { return finished == 8; });
+
+	waitFor([&pool]() { return pool.getNumberOfWorkers() == 1; });
+
+	web::WorkStealingThreadPool::SizingStatistics statistics = pool.getSizingStatistics();
+
+	check(statistics.grows >= 1 && statistics.shrinks >= 3, "Resizes aren't counted");
+	check(statistics.minWorkers == 1 && statistics.maxWorkers == 4, "Wrong bounds");
+
+	// Pool keeps working after shrinking
+	std::atomic<size_t> executed = 0;
+
+	for (size_t i = 0; i < 100; i++)
+	{
+		pool.addTask([&executed]() { executed++; });
+	}
+
+	waitFor([&executed]() { return executed == 100; });
+
+	bool failed = false;
+
+	try
+	{
+		options.minWorkers = 5;
+
+		web::WorkStealingThreadPool wrongPool(options);
+	}
+	catch (const std::runtime_error&)
+	{
+		failed = true;
+	}
+
+	check(failed, "Wrong bounds are accepted");
+}
+
+int main(int argc, char** argv) try
+{
+	execution();
+
+	stealOrder();
+
+	adaptiveSizing();
+
+	return 0;
+}
+catch (const std::exception& e)
+{
+	std::cerr << e.what() << std::endl;
+
+	return -1;
+}
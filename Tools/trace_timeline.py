@@ -0,0 +1,102 @@
+"""Reconstruct per connection timelines from ConnectionTracer::dump output.
+
+Usage: python trace_timeline.py trace.csv [--connections]
+"""
+
+import argparse
+import csv
+import statistics
+
+STAGES = [
+    ("accept -> dispatch", "accepted", "dispatched"),
+    ("dispatch -> handler", "dispatched", "handlerStart"),
+    ("handler -> first receive", "handlerStart", "received"),
+    ("handler duration", "handlerStart", "handlerEnd"),
+    ("total", "accepted", "closed"),
+]
+
+FINAL_EVENTS = ("closed",)
+
+
+def read_connections(path):
+    """Group events into connections. Socket descriptors are reused, so connection ends with closed event. Kicked connections are closed after kicked event"""
+    opened = {}
+    connections = []
+
+    with open(path, newline="") as file:
+        for row in csv.DictReader(file):
+            socket = row["socket"]
+            event = row["event"]
+            timestamp = int(row["timestamp"])
+
+            if event == "accepted" or socket not in opened:
+                if socket in opened:
+                    connections.append(opened[socket])
+
+                opened[socket] = {"socket": socket, "ip": row["ip"], "port": row["port"], "events": {}}
+
+            events = opened[socket]["events"]
+
+            if event not in events:
+                events[event] = timestamp
+
+            if event in FINAL_EVENTS:
+                if "closed" not in events:
+                    events["closed"] = timestamp
+
+                connections.append(opened.pop(socket))
+
+    connections.extend(opened.values())
+
+    return connections
+
+
+def microseconds(value):
+    return f"{value / 1000:.1f}"
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Per connection latency breakdown from ConnectionTracer CSV dump")
+    parser.add_argument("trace", help="CSV produced by ConnectionTracer::dump")
+    parser.add_argument("--connections", action="store_true", help="Print timeline of each connection")
+    arguments = parser.parse_args()
+
+    connections = read_connections(arguments.trace)
+
+    if arguments.connections:
+        print("socket,ip,port," + ",".join(name for name, _, _ in STAGES))
+
+        for connection in connections:
+            events = connection["events"]
+            values = [
+                microseconds(events[end] - events[start]) if start in events and end in events else ""
+                for _, start, end in STAGES
+            ]
+
+            print(f"{connection['socket']},{connection['ip']},{connection['port']}," + ",".join(values))
+
+        print()
+
+    print(f"Connections: {len(connections)}")
+    print(f"{'stage':<26}{'count':>8}{'min us':>12}{'median us':>12}{'p99 us':>12}{'max us':>12}")
+
+    for name, start, end in STAGES:
+        durations = sorted(
+            connection["events"][end] - connection["events"][start]
+            for connection in connections
+            if start in connection["events"] and end in connection["events"]
+        )
+
+        if not durations:
+            continue
+
+        p99 = durations[min(len(durations) - 1, int(len(durations) * 0.99))]
+
+        print(
+            f"{name:<26}{len(durations):>8}{microseconds(durations[0]):>12}{microseconds(statistics.median(durations)):>12}"
+            f"{microseconds(p99):>12}{microseconds(durations[-1]):>12}"
+        )
+
+
+if __name__ == "__main__":
+    main()
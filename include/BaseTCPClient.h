@@ -0,0 +1,269 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "BaseTCPServer.h"
+
+namespace web
+{
+	/// @brief Outbound TCP connections with keyed pool of idle connections. Uses the same send/receive primitives and exceptions as BaseTCPServer
+	class BaseTCPClient
+	{
+	public:
+		/// @brief Connection taken from pool. Returned to pool in destructor unless it's broken
+		class Connection
+		{
+		private:
+			BaseTCPClient* client;
+			std::string key;
+			SOCKET clientSocket;
+			bool reused;
+			bool broken;
+
+		public:
+			Connection(BaseTCPClient* client, std::string&& key, SOCKET clientSocket, bool reused);
+
+			Connection(const Connection&) = delete;
+
+			Connection(Connection&& other) noexcept;
+
+			Connection& operator = (const Connection&) = delete;
+
+			Connection& operator = (Connection&& other) noexcept;
+
+			/**
+			 * @brief Send all data. Connection is marked as broken if exception is thrown
+			 * @exception web::exceptions::WebServerException
+			 */
+			template<typename DataT>
+			int sendBytes(const DataT* const data, int size);
+
+			/**
+			 * @brief Receive data. Connection is marked as broken if exception is thrown or peer closed connection
+			 * @exception web::exceptions::WebServerException
+			 */
+			template<typename DataT>
+			int receiveBytes(DataT* const data, int size);
+
+			/**
+			 * @brief Close connection instead of returning it to pool, e.g. when response wasn't read completely
+			 */
+			void markBroken();
+
+			/**
+			 * @brief Return connection to pool or close it if broken. Connection can't be used after release
+			 */
+			void release();
+
+			/**
+			 * @brief Is connection taken from idle connections instead of connecting
+			 * @return
+			 */
+			bool isReused() const;
+
+			bool isBroken() const;
+
+			SOCKET getSocket() const;
+
+			~Connection();
+		};
+
+		struct Statistics
+		{
+			uint64_t createdConnections;
+			uint64_t reusedConnections;
+
+			/**
+			 * @brief Idle connections closed after idle timeout
+			 */
+			uint64_t expiredConnections;
+
+			/**
+			 * @brief Idle connections closed by failed health check
+			 */
+			uint64_t failedHealthChecks;
+		};
+
+	private:
+#ifdef __LINUX__
+		/**
+		 * @brief Peer reset is reported with exception instead of SIGPIPE
+		 */
+		static constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+		static constexpr int sendFlags = 0;
+#endif
+
+	private:
+		struct IdleConnection
+		{
+			SOCKET clientSocket;
+			std::chrono::steady_clock::time_point releaseTime;
+		};
+
+	private:
+		std::unordered_map<std::string, std::vector<IdleConnection>> idleConnections;
+		size_t maxIdleConnectionsPerKey;
+		std::chrono::milliseconds idleTimeout;
+		std::chrono::milliseconds connectTimeout;
+		std::function<bool(SOCKET)> healthCheck;
+		Statistics statistics;
+		mutable std::mutex poolMutex;
+
+	private:
+		static std::string makeKey(std::string_view host, std::string_view port);
+
+	private:
+		void release(const std::string& key, SOCKET clientSocket);
+
+	public:
+		/**
+		 * @brief Connect to host with non blocking connect. Returned socket is in blocking mode
+		 * @param host
+		 * @param port
+		 * @param timeout Maximum connection time
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		static SOCKET connect(std::string_view host, std::string_view port, std::chrono::milliseconds timeout);
+
+		/**
+		 * @brief Default health check. Idle connection is alive if peer didn't close it and didn't send unexpected data
+		 * @param clientSocket
+		 * @return
+		 */
+		static bool isAlive(SOCKET clientSocket);
+
+		template<typename DataT>
+		static int sendBytes(SOCKET clientSocket, const DataT* const data, int size);
+
+		template<typename DataT>
+		static int receiveBytes(SOCKET clientSocket, DataT* const data, int size);
+
+	public:
+		/**
+		 * @param maxIdleConnectionsPerKey Maximum number of idle connections for each host:port
+		 * @param idleTimeout Idle connections older than timeout are closed
+		 * @param connectTimeout Maximum connection time
+		 */
+		BaseTCPClient(size_t maxIdleConnectionsPerKey = 8, std::chrono::milliseconds idleTimeout = std::chrono::seconds(30), std::chrono::milliseconds connectTimeout = std::chrono::seconds(5));
+
+		BaseTCPClient(const BaseTCPClient&) = delete;
+
+		BaseTCPClient& operator = (const BaseTCPClient&) = delete;
+
+		/**
+		 * @brief Get idle connection to host:port or connect. Connection must not outlive client
+		 * @param host
+		 * @param port
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		Connection acquire(std::string_view host, std::string_view port);
+
+		/**
+		 * @brief Replace isAlive check of idle connections. Check is called without client's lock, so it may use client
+		 * @param healthCheck
+		 */
+		void setHealthCheck(const std::function<bool(SOCKET)>& healthCheck);
+
+		/**
+		 * @brief Close idle connections older than idle timeout
+		 */
+		void closeExpired();
+
+		size_t getNumberOfIdleConnections() const;
+
+		Statistics getStatistics() const;
+
+		/**
+		 * @brief Close all idle connections
+		 */
+		void clear();
+
+		~BaseTCPClient();
+	};
+
+	template<typename DataT>
+	int BaseTCPClient::Connection::sendBytes(const DataT* const data, int size)
+	{
+		try
+		{
+			return BaseTCPClient::sendBytes(clientSocket, data, size);
+		}
+		catch (...)
+		{
+			broken = true;
+
+			throw;
+		}
+	}
+
+	template<typename DataT>
+	int BaseTCPClient::Connection::receiveBytes(DataT* const data, int size)
+	{
+		try
+		{
+			int result = BaseTCPClient::receiveBytes(clientSocket, data, size);
+
+			if (!result && size)
+			{
+				broken = true;
+			}
+
+			return result;
+		}
+		catch (...)
+		{
+			broken = true;
+
+			throw;
+		}
+	}
+
+	template<typename DataT>
+	int BaseTCPClient::sendBytes(SOCKET clientSocket, const DataT* const data, int size)
+	{
+		int lastSend = 0;
+		int totalSent = 0;
+
+		do
+		{
+			lastSend = send(clientSocket, reinterpret_cast<const char*>(data) + totalSent, size - totalSent, BaseTCPClient::sendFlags);
+
+			if (lastSend == SOCKET_ERROR)
+			{
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+			else if (!lastSend)
+			{
+				return totalSent;
+			}
+
+			totalSent += lastSend;
+		}
+		while (totalSent < size);
+
+		return totalSent;
+	}
+
+	template<typename DataT>
+	int BaseTCPClient::receiveBytes(SOCKET clientSocket, DataT* const data, int size)
+	{
+		// Upstream socket is always kernel socket, even if handler installed Transport for server's connection
+		int lastReceive = recv(clientSocket, reinterpret_cast<char*>(data), size, 0);
+
+		if (lastReceive == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		return lastReceive;
+	}
+}
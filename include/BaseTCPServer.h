@@ -1,21 +1,36 @@
 #pragma once
 
+#include <any>
 #include <string>
 #include <future>
 #include <unordered_map>
 #include <vector>
+#include <cstdint>
+#include <condition_variable>
 
 #ifdef __LINUX__
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
 #include <unistd.h>
+#include <poll.h>
 #else
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 #endif // __LINUX__
 
 #include "WebServerException.h"
+#include "OutputBuffer.h"
+#include "WorkStealingThreadPool.h"
+#include "ConnectionTracer.h"
+#include "SendQueue.h"
+#include "TransportStatistics.h"
+#include "ConnectionPoller.h"
+#include "WeightedFairQueue.h"
+#include "StreamTransfer.h"
+#include "IpFilter.h"
+#include "InMemoryTransport.h"
+#include "SocketReaper.h"
 
 #ifdef __LINUX__
 #ifndef WINDOWS_STYLE_DEFINITION
@@ -34,36 +49,369 @@ namespace web
 {
 	class BaseTCPServer
 	{
+		friend class BaseTCPClient;
+
 	private:
+		/// @brief Registry of connected sockets. Connections are stored in reusable slots, so registering connection doesn't allocate after warm up
 		class ClientData
 		{
+		public:
+			/// @brief Slot index and its generation. Generation changes when slot is released, so stale handles are ignored
+			struct Handle
+			{
+				uint32_t index;
+				uint32_t generation;
+
+				bool operator ==(const Handle&) const = default;
+			};
+
+			static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+			/// @brief Connection registered by batch add
+			struct Registration
+			{
+				std::string ip;
+				sockaddr address;
+				SOCKET socket;
+				uint32_t priorityClass;
+
+				/**
+				 * @brief Admission limit of priority class, 0 for no limit
+				 */
+				size_t maxConnections;
+				uint32_t listener;
+
+				/**
+				 * @brief Set by add, invalidIndex if priority class already has maxConnections connections
+				 */
+				Handle handle;
+			};
+
 		private:
-			std::unordered_map<std::string, std::vector<SOCKET>> data;
+			struct Connection
+			{
+				std::string ip;
+				sockaddr address;
+				SOCKET socket;
+				uint32_t generation;
+				uint32_t priorityClass;
+				uint32_t listener;
+
+				/**
+				 * @brief Neighbours in list of connections from same IP, invalidIndex at list ends
+				 */
+				uint32_t previousSameIp;
+				uint32_t nextSameIp;
+				bool used;
+				std::shared_ptr<SendQueue> sendQueue;
+			};
+
+		private:
+			std::vector<Connection> connections;
+			std::vector<uint32_t> freeSlots;
+			std::vector<uint32_t> socketIndex;
+
+			/**
+			 * @brief Open addressing table of first connection from each IP
+			 */
+			std::vector<uint32_t> ipIndex;
+			std::vector<size_t> connectionsPerClass;
+			size_t numberOfConnections;
+
+			/**
+			 * @brief Number of different IPs
+			 */
+			size_t numberOfClients;
 			mutable std::mutex dataMutex;
 
+		private:
+			size_t findSocketPosition(SOCKET socket) const;
+
+			void insertSocket(SOCKET socket, uint32_t index);
+
+			void eraseSocket(SOCKET socket);
+
+			void rehash(size_t capacity);
+
+			size_t findIpPosition(std::string_view ip) const;
+
+			void linkIp(uint32_t index);
+
+			void unlinkIp(uint32_t index);
+
+			void rehashIps(size_t capacity);
+
+			/**
+			 * @brief Free slot. Must be called under dataMutex
+			 * @return Send queue of slot, it must be cancelled or closed after unlock
+			 */
+			std::shared_ptr<SendQueue> release(uint32_t index);
+
+			Handle addConnection(const std::string& ip, SOCKET socket, sockaddr address, uint32_t priorityClass, size_t maxConnections, uint32_t listener);
+
 		public:
-			ClientData() = default;
+			ClientData();
+
+			/**
+			 * @brief Preallocate slots
+			 * @param numberOfConnections
+			 */
+			void reserve(size_t numberOfConnections);
+
+			/**
+			 * @brief Register connection
+			 * @param ip
+			 * @param socket
+			 * @param address
+			 * @param priorityClass
+			 * @param maxConnections Admission limit of priority class, 0 for no limit
+			 * @param listener Index of listener that accepted connection
+			 * @return Handle with invalidIndex if priority class already has maxConnections connections
+			 */
+			Handle add(const std::string& ip, SOCKET socket, sockaddr address = {}, uint32_t priorityClass = 0, size_t maxConnections = 0, uint32_t listener = 0);
+
+			/**
+			 * @brief Register connections with one lock acquisition
+			 * @param registrations Handle of each registration is set
+			 */
+			void add(std::vector<Registration>& registrations);
+
+			/**
+			 * @brief Release slot
+			 * @param handle
+			 * @return Socket of released slot or INVALID_SOCKET if handle is stale
+			 */
+			SOCKET remove(Handle handle);
 
-			void add(const std::string& ip, SOCKET socket);
+			/**
+			 * @brief Release slot without cancelling its send queue
+			 * @param handle
+			 * @param sendQueue Send queue of released slot, nullptr if slot has no queue
+			 * @return Socket of released slot or INVALID_SOCKET if handle is stale
+			 */
+			SOCKET remove(Handle handle, std::shared_ptr<SendQueue>& sendQueue);
 
 			void remove(const std::string& ip, SOCKET socket);
 
+			/**
+			 * @brief Find handle of registered socket
+			 * @param socket
+			 * @return Handle with invalidIndex if socket isn't registered
+			 */
+			Handle find(SOCKET socket) const;
+
+			/**
+			 * @brief Get registered connection
+			 * @param listener Index of listener that accepted connection
+			 * @return false if handle is stale
+			 */
+			bool get(Handle handle, std::string& ip, SOCKET& socket, sockaddr& address, uint32_t& listener) const;
+
 			std::vector<SOCKET> extract(const std::string& ip);
 
-			void clear();
+			/**
+			 * @brief Release all slots
+			 * @return Sockets of released slots
+			 */
+			std::vector<SOCKET> clear();
 
 			std::vector<std::pair<std::string, std::vector<SOCKET>>> getClients() const;
 
+			/**
+			 * @brief Store send queue in socket's slot unless slot already has one
+			 * @param socket
+			 * @param queue
+			 * @return Stored queue, queue itself if socket isn't registered
+			 */
+			std::shared_ptr<SendQueue> attachSendQueue(SOCKET socket, std::shared_ptr<SendQueue>&& queue);
+
+			/**
+			 * @brief Get sockets and their send queues without copying IP addresses
+			 * @param sockets Cleared and filled
+			 */
+			void getSockets(std::vector<std::pair<SOCKET, std::shared_ptr<SendQueue>>>& sockets) const;
+
 			size_t getNumberOfClients() const;
 
 			size_t getNumberOfConnections() const;
 
+			size_t getNumberOfConnections(uint32_t priorityClass) const;
+
 			~ClientData() = default;
 		};
 
+		/// @brief Idle connection waiting in ConnectionPoller for next data
+		struct ParkedConnection
+		{
+			std::string ip;
+			sockaddr address;
+			std::function<void()> cleanup;
+			std::any state;
+		};
+
+		/// @brief IPv4 network mapped to priority class
+		struct PriorityRule
+		{
+			uint32_t network;
+			uint32_t mask;
+			uint32_t priorityClass;
+		};
+
+		struct PriorityClassCounters
+		{
+			std::atomic<uint64_t> accepted;
+			std::atomic<uint64_t> rejected;
+		};
+
+		/// @brief Address accepted in same loop as server's own address
+		struct Listener
+		{
+			std::string ip;
+			std::string port;
+			SOCKET socket;
+		};
+
+		/// @brief Registration of connection that dispatching thread passes to serve
+		struct DispatchedConnection
+		{
+			ClientData::Handle handle;
+			uint32_t listener;
+			SOCKET socket;
+		};
+
+		/// @brief Owns sockets of accept batch until they are handed to handlers, closes the rest when exception leaves acceptConnections
+		class AcceptBatchOwner
+		{
+		private:
+			BaseTCPServer& server;
+
+		public:
+			AcceptBatchOwner(BaseTCPServer& server);
+
+			AcceptBatchOwner(const AcceptBatchOwner&) = delete;
+
+			AcceptBatchOwner& operator = (const AcceptBatchOwner&) = delete;
+
+			~AcceptBatchOwner();
+		};
+
+	public:
+		/// @brief Accepting thread counters and state of listen queues
+		struct AcceptStatistics
+		{
+			/**
+			 * @brief Wakeups that accepted at least one connection
+			 */
+			uint64_t batches;
+			uint64_t accepted;
+			size_t largestBatch;
+
+			/**
+			 * @brief Connections waiting in listen queues of TCP listeners
+			 */
+			size_t listenQueueLength;
+
+			/**
+			 * @brief Sum of backlogs of TCP listeners
+			 */
+			size_t listenQueueCapacity;
+
+			/**
+			 * @brief System wide TcpExt ListenOverflows, connections dropped because listen queue was full
+			 */
+			uint64_t listenOverflows;
+
+			/**
+			 * @brief System wide TcpExt ListenDrops, includes overflows
+			 */
+			uint64_t listenDrops;
+		};
+
+		/// @brief Credentials of process connected through Unix domain socket
+		struct PeerCredentials
+		{
+			int64_t processId;
+			uint32_t userId;
+			uint32_t groupId;
+		};
+
+		/// @brief What broadcast does with client whose kernel send buffer is full
+		enum class SlowReceiverPolicy
+		{
+			/**
+			 * @brief Don't send payload to this client. Partially sent payload is always finished through send queue
+			 */
+			skip,
+			/**
+			 * @brief Put payload into client's send queue
+			 */
+			queue,
+			/**
+			 * @brief Shutdown client's socket
+			 */
+			kick
+		};
+
+		/// @brief Group of connections with its own share of thread pool workers and admission limit
+		struct PriorityClass
+		{
+			std::string name;
+
+			/**
+			 * @brief Share of handler work when tasks wait for workers. Class with weight 4 starts 4 handlers for each handler of class with weight 1
+			 */
+			uint32_t weight;
+
+			/**
+			 * @brief Connections above this limit are closed right after accept, 0 for no limit
+			 */
+			size_t maxConnections;
+		};
+
+		struct PriorityClassStatistics
+		{
+			std::string name;
+			size_t connections;
+
+			/**
+			 * @brief Number of accepted connections waiting for thread pool worker
+			 */
+			size_t pendingHandlers;
+
+			uint64_t accepted;
+			uint64_t rejected;
+
+			/**
+			 * @brief Number of handlers started by weighted scheduler
+			 */
+			uint64_t served;
+		};
+
+		struct BroadcastResult
+		{
+			/**
+			 * @brief Number of clients that received whole payload immediately
+			 */
+			size_t sent;
+
+			/**
+			 * @brief Number of clients whose payload is waiting in send queue
+			 */
+			size_t queued;
+
+			size_t skipped;
+			size_t kicked;
+			size_t failed;
+		};
+
 	public:
 		static constexpr size_t ipV4Size = 16;
 
+		/**
+		 * @brief Host prefix for Unix domain socket listener. unix:/path/to/socket for filesystem path, unix:@name for abstract namespace(Linux only)
+		 */
+		static constexpr std::string_view unixSocketPrefix = "unix:";
+
 	protected:
 		ClientData data;
 		std::string ip;
@@ -74,6 +422,41 @@ namespace web
 		bool isRunning;
 		const bool multiThreading;
 		std::future<void> handle;
+		std::unique_ptr<WorkStealingThreadPool> threadPool;
+		bool adoptedListenSocket;
+		bool listenSocketHandedOff;
+		std::unique_ptr<SendQueueFlusher> sendQueueFlusher;
+		std::once_flag sendQueueFlusherFlag;
+		std::unique_ptr<ConnectionPoller> connectionPoller;
+		std::once_flag connectionPollerFlag;
+		std::unordered_map<SOCKET, ParkedConnection> parkedConnections;
+		std::mutex parkedConnectionsMutex;
+		TransportStatistics transportStatistics;
+		std::thread transportSamplingThread;
+		std::mutex transportSamplingMutex;
+		std::condition_variable transportSamplingCondition;
+		bool transportSampling;
+		std::vector<PriorityClass> priorityClasses;
+		std::vector<PriorityRule> priorityRules;
+		std::unique_ptr<PriorityClassCounters[]> priorityClassCounters;
+		std::unique_ptr<WeightedFairQueue<ClientData::Handle>> pendingConnections;
+		std::atomic<std::shared_ptr<const IpFilter>> ipFilter;
+		std::atomic<uint64_t> filteredConnections;
+		std::unique_ptr<SocketReaper> socketReaper;
+		std::vector<Listener> additionalListeners;
+		size_t acceptBatchSize;
+
+		/**
+		 * @brief Connections accepted in current wakeup, used only by accepting thread
+		 */
+		std::vector<ClientData::Registration> acceptBatch;
+		std::atomic<uint64_t> numberOfAcceptBatches;
+		std::atomic<uint64_t> numberOfAcceptedConnections;
+		std::atomic<size_t> largestAcceptBatch;
+		std::atomic<int64_t> drainMicroseconds;
+#ifdef __LINUX__
+		int wakeupDescriptor;
+#endif
 
 		/**
 		 * @brief 0 for blocking, non 0 for non blocking
@@ -85,11 +468,131 @@ namespace web
 		 */
 		u_long listenSocketBlockingMode;
 
+	private:
+		/**
+		 * @brief WSAPoll timeout in milliseconds for server with few listeners
+		 */
+		static constexpr int listenersPollTimeout = 100;
+
+		/**
+		 * @brief Set by dispatch and taken by serve, so registration reaches handler through serve's signature
+		 */
+		static thread_local DispatchedConnection dispatchedConnection;
+
+	private:
+		SOCKET createUnixListenSocket(std::string_view ip);
+
+		void applyListenSocketBlockingMode(SOCKET listenSocket);
+
+		/**
+		 * @brief Create bound and listening socket
+		 * @param ip IP address or unix:<path>
+		 * @param port
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		SOCKET openListenSocket(std::string_view ip, std::string_view port);
+
+		/**
+		 * @brief Wait for incoming connection on any listener or stop
+		 * @param descriptors Listen sockets in listener order, on Linux followed by wakeup descriptor
+		 * @return true if accept must be called for ready listeners
+		 */
+		bool waitConnection(std::vector<pollfd>& descriptors);
+
+		/**
+		 * @brief Accept up to acceptBatchSize pending connections, then set up, register and dispatch them together
+		 * @param listenerIndex
+		 * @param listenSocket
+		 * @param unixSocket
+		 */
+		void acceptConnections(size_t listenerIndex, SOCKET listenSocket, bool unixSocket);
+
+		/**
+		 * @brief Set timeouts, blocking mode, IP and priority class of accepted socket
+		 * @param connection
+		 * @param unixSocket
+		 * @exception web::exceptions::WebServerException
+		 */
+		void setupAcceptedConnection(ClientData::Registration& connection, bool unixSocket);
+
+		/**
+		 * @brief Close connection of accept batch that wasn't handed to handler, registered connection is removed from clients first. Socket of connection becomes INVALID_SOCKET
+		 * @param connection
+		 */
+		void dropAcceptedConnection(ClientData::Registration& connection);
+
+		void serveConnection(ClientData::Handle handle);
+
+		/**
+		 * @brief Pass registered connection to serve on current thread
+		 * @param handle
+		 * @param listener Index of listener that accepted connection
+		 * @param ip
+		 * @param clientSocket
+		 * @param address
+		 */
+		void dispatch(ClientData::Handle handle, uint32_t listener, std::string ip, SOCKET clientSocket, sockaddr address);
+
+		/**
+		 * @brief Call handler of connection and release its slot after handler
+		 * @param handle Handle returned by registration, invalidIndex for socket that isn't registered
+		 * @param listener Index of listener that accepted connection
+		 * @param ip
+		 * @param clientSocket
+		 * @param address
+		 */
+		void serveRegistered(ClientData::Handle handle, uint32_t listener, std::string ip, SOCKET clientSocket, sockaddr address);
+
+		/**
+		 * @brief Thread pool task that serves next pending connection in weighted order
+		 */
+		void servePendingConnection();
+
+		/**
+		 * @brief Called by ConnectionPoller when parked socket is ready
+		 */
+		void onParkedConnectionEvent(SOCKET clientSocket, ConnectionPoller::Event event);
+
+		void resume(SOCKET clientSocket, ParkedConnection& connection);
+
+		/**
+		 * @brief Take parked connection out of parked connections
+		 * @param clientSocket
+		 * @param connection
+		 * @return false if socket isn't parked
+		 */
+		bool takeParkedConnection(SOCKET clientSocket, ParkedConnection& connection);
+
+		/**
+		 * @brief Stop waiting for parked connection and call its cleanup. Socket is closed by cleanup only if it's still registered
+		 * @param clientSocket
+		 */
+		void unpark(SOCKET clientSocket);
+
+		/**
+		 * @brief Close socket now or hand it to socket reaper
+		 * @param clientSocket
+		 */
+		void closeClientSocket(SOCKET clientSocket);
+
+		/**
+		 * @brief Close sockets now or hand them to socket reaper as one batch
+		 * @param clientSockets
+		 */
+		void closeClientSockets(const std::vector<SOCKET>& clientSockets);
+
 	protected:
 		void createListenSocket();
 
 		virtual void receiveConnections(const std::function<void()>& onStartServer, std::exception** outException);
 
+		/**
+		 * @brief Serve accepted connection, called on thread that serves it. Overrides call BaseTCPServer::serve to run handler and cleanup
+		 * @param ip Client IP address
+		 * @param clientSocket Client socket
+		 * @param address Structure used to store most addresses.
+		 */
 		virtual void serve(std::string ip, SOCKET clientSocket, sockaddr address);
 
 		/**
@@ -101,10 +604,46 @@ namespace web
 		 */
 		virtual void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup) = 0;
 
+		/**
+		 * @brief Serve parked connection after new data arrived. Calls clientConnection by default
+		 * @param ip Client IP address
+		 * @param clientSocket Client socket
+		 * @param address Structure used to store most addresses.
+		 * @param cleanup Move this function if you want made cleanup by yourself
+		 * @param state State passed to park
+		 */
+		virtual void onConnectionResume(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup, std::any& state);
+
+		/**
+		 * @brief Serve new connection of specific listener. Calls clientConnection by default
+		 * @param listenerIndex 0 for server's own address, index returned by addListener for others
+		 * @param ip Client IP address
+		 * @param clientSocket Client socket
+		 * @param address Structure used to store most addresses.
+		 * @param cleanup Move this function if you want made cleanup by yourself
+		 */
+		virtual void onListenerConnection(size_t listenerIndex, const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup);
+
 		virtual void onConnectionReceive(SOCKET clientSocket, sockaddr address);
 
 		virtual void onInvalidConnectionReceive();
 
+		/**
+		 * @brief Choose priority class of accepted connection. By default uses rules from addPriorityRule, longest prefix wins
+		 * @param ip Client IP address
+		 * @param clientSocket Client socket, local address of listener can be taken with getsockname
+		 * @param address Structure used to store most addresses.
+		 * @return Index in setPriorityClasses list, out of range index means class 0
+		 */
+		virtual uint32_t classifyConnection(const std::string& ip, SOCKET clientSocket, sockaddr address) const;
+
+		/**
+		 * @brief Called before closing connection rejected by IP filter or admission limit
+		 * @param clientSocket
+		 * @param address
+		 */
+		virtual void onConnectionRejected(SOCKET clientSocket, sockaddr address);
+
 		/**
 		 * @brief Automatically close socket after clientConnection in cleanup function
 		 * @return
@@ -118,6 +657,57 @@ namespace web
 		template<typename DataT>
 		static int receiveBytes(SOCKET clientSocket, DataT* const data, int size);
 
+		/**
+		 * @brief Receive next part of pipelined requests. Responses accumulated in output are flushed first if previous read batch is processed, so receive never waits with unsent responses
+		 * @param clientSocket
+		 * @param data
+		 * @param size
+		 * @param output Output buffer of clientSocket
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		template<typename DataT>
+		static int receiveBytes(SOCKET clientSocket, DataT* const data, int size, OutputBuffer& output);
+
+		/**
+		 * @brief Send payload of any size in chunks with progress and cancellation
+		 * @param clientSocket
+		 * @param data
+		 * @param options
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		static StreamTransfer::Result sendStream(SOCKET clientSocket, std::span<const std::byte> data, const StreamTransfer::Options& options = {});
+
+		/**
+		 * @brief Receive payload of any size directly into caller's buffer or MappedFile
+		 * @param clientSocket
+		 * @param destination
+		 * @param options
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		static StreamTransfer::Result receiveStream(SOCKET clientSocket, std::span<std::byte> destination, const StreamTransfer::Options& options = {});
+
+		/**
+		 * @brief Return idle connection to server instead of blocking in recv. Socket waits in server's poller and is dispatched to onConnectionResume when data arrives.
+		 * Connections that peer closed while parked are cleaned up without dispatch
+		 * @param clientSocket
+		 * @param cleanup Cleanup passed to clientConnection or onConnectionResume, moved into server
+		 * @param state Per connection state passed to onConnectionResume
+		 * @exception web::exceptions::WebServerException
+		 */
+		void park(SOCKET clientSocket, std::function<void()>& cleanup, std::any state = {});
+
+		/**
+		 * @brief Create output queue for client socket or get existing one. Enqueue never blocks, data is sent by server's flusher thread when socket becomes writable
+		 * @param clientSocket
+		 * @param highWatermark Number of queued bytes after which enqueue reports backpressure
+		 * @param lowWatermark Number of queued bytes below which producer may continue
+		 * @return
+		 */
+		std::shared_ptr<SendQueue> createSendQueue(SOCKET clientSocket, size_t highWatermark = 1024 * 1024, size_t lowWatermark = 256 * 1024);
+
 	public:
 		/**
 		 * @brief Get client IP address
@@ -133,6 +723,29 @@ namespace web
 		 */
 		static uint16_t getClientPortV4(sockaddr address);
 
+		/**
+		 * @brief Get process id, user id and group id of Unix domain socket peer. User id and group id are 0 on Windows
+		 * @param clientSocket
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		static PeerCredentials getPeerCredentials(SOCKET clientSocket);
+
+		/**
+		 * @brief Get listen socket passed by service manager with socket activation (LISTEN_PID and LISTEN_FDS environment variables)
+		 * @param index Index of passed socket
+		 * @return INVALID_SOCKET if there is no such socket
+		 */
+		static SOCKET getActivatedListenSocket(size_t index = 0);
+
+		/**
+		 * @brief Wait for predecessor's handOffListenSocket call and receive its listen socket. Linux only
+		 * @param unixSocketPath Path of Unix domain socket used for handoff, @ prefix for abstract namespace
+		 * @return Listen socket for adoptListenSocket
+		 * @exception web::exceptions::WebServerException
+		 */
+		static SOCKET receiveListenSocket(std::string_view unixSocketPath);
+
 		/**
 		 * @brief Get BaseTCPServer version
 		 * @return
@@ -141,8 +754,8 @@ namespace web
 
 	public:
 		/// @brief 
-		/// @param port Server's port
-		/// @param host Server's host
+		/// @param port Server's port, ignored for Unix domain socket
+		/// @param host Server's host or unixSocketPrefix followed by Unix domain socket path
 		/// @param timeout recv function timeout in milliseconds, 0 wait for upcoming data
 		/// @param multiThreading Each client in separate thread
 		/// @param listenSocketBlockingMode Blocking mode for listen socket (0 - blocking, non 0 - non blocking)
@@ -161,6 +774,15 @@ namespace web
 		 */
 		uint16_t getServerPortV4() const;
 
+		/**
+		 * @brief Run handler for in-memory connection in calling thread without listen socket. sendBytes and receiveBytes of this thread use transport until handler and cleanup return.
+		 * Connection isn't registered, so it isn't kicked and isn't counted
+		 * @param transport
+		 * @param serverSocket Server endpoint from transport's createConnection
+		 * @param ip Client IP address passed to handler
+		 */
+		void serveInMemory(InMemoryTransport& transport, SOCKET serverSocket, const std::string& ip = "127.0.0.1");
+
 		/**
 		 * @brief Start server in separate thread
 		 * @param wait Wait server serving in current thread
@@ -174,6 +796,36 @@ namespace web
 		 */
 		virtual void stop(bool wait = true);
 
+		/**
+		 * @brief Use already bound and listening socket instead of creating new one in start
+		 * @param socket Inherited, activated or received from predecessor socket
+		 */
+		void adoptListenSocket(SOCKET socket);
+
+		/**
+		 * @brief Send listen socket to successor waiting in receiveListenSocket and stop accepting new connections. Connected clients aren't kicked. Linux only
+		 * @param unixSocketPath Path of Unix domain socket used for handoff, @ prefix for abstract namespace
+		 * @exception web::exceptions::WebServerException
+		 */
+		void handOffListenSocket(std::string_view unixSocketPath);
+
+		/**
+		 * @brief Send same payload to all connected clients with non blocking writes. Work is split between thread pool workers if thread pool is used.
+		 * Clients with pending send queue data get payload through their queue, so order of messages is kept.
+		 * On Windows socket is switched to non blocking mode for the write and back to mode set by setAcceptedSocketsBlockingMode
+		 * @param payload Immutable payload shared by all clients
+		 * @param policy What to do with clients that can't receive payload without blocking
+		 * @return
+		 */
+		BroadcastResult broadcast(const SendQueue::Payload& payload, SlowReceiverPolicy policy = SlowReceiverPolicy::queue);
+
+		/**
+		 * @brief Wait until all clients disconnect
+		 * @param timeout Maximum waiting time
+		 * @return true if all clients disconnected
+		 */
+		bool drain(std::chrono::milliseconds timeout);
+
 		/**
 		 * @brief Kick specific client
 		 * @param ip
@@ -185,6 +837,12 @@ namespace web
 		 */
 		virtual void kickAll();
 
+		/**
+		 * @brief Is server listen on Unix domain socket. Clients of Unix domain socket are identified by unix:<process id> instead of IP address
+		 * @return
+		 */
+		bool isUnixSocket() const;
+
 		/**
 		 * @brief Is server accept new connections
 		 * @return
@@ -209,6 +867,164 @@ namespace web
 		 */
 		void setAcceptedSocketsBlockingMode(bool block);
 
+		/**
+		 * @brief Serve clients in work stealing thread pool instead of separate thread for each client. Must be called before start
+		 * @param numberOfWorkers Number of worker threads, 0 for std::thread::hardware_concurrency
+		 */
+		void setThreadPool(size_t numberOfWorkers = 0);
+
+		/**
+		 * @brief Serve clients in thread pool that grows and shrinks between bounds by queue depth, handler latency and CPU utilization. Must be called before start
+		 * @param options
+		 * @exception std::runtime_error
+		 */
+		void setThreadPool(const WorkStealingThreadPool::SizingOptions& options);
+
+		/**
+		 * @brief Close client sockets in background thread. Kicked sockets are shut down immediately, so blocked handlers wake up, and closed in batches,
+		 * so kicking, rejecting and stopping don't stall accepts or handlers. Must be called before start
+		 * @param closeDelay Time collecting batch before closing
+		 * @exception std::runtime_error
+		 */
+		void setSocketReaper(std::chrono::milliseconds closeDelay = std::chrono::milliseconds(10));
+
+		/**
+		 * @brief Accept connections on one more address in same accepting thread. Connections of all listeners share clients registry, filters and thread pool.
+		 * Only server's own listen socket is handed off by handOffListenSocket, other listeners are closed. Must be called before start
+		 * @param port
+		 * @param host IP address or unix:<path>
+		 * @return Listener index passed to onListenerConnection
+		 * @exception std::runtime_error
+		 */
+		size_t addListener(std::string_view port, std::string_view host = "0.0.0.0");
+
+		/**
+		 * @brief Maximum number of connections accepted per wakeup of accepting thread. Accepted connections are set up, registered with one lock and dispatched together.
+		 * Must be called before start
+		 * @param batchSize 1 for accept, set up and dispatch of each connection before next accept
+		 * @exception std::runtime_error
+		 */
+		void setAcceptBatchSize(size_t batchSize);
+
+		/**
+		 * @brief Number of listeners including server's own address
+		 * @return
+		 */
+		size_t getNumberOfListeners() const;
+
+		/**
+		 * @brief Port listener is bound to, useful with port 0
+		 * @param listenerIndex
+		 * @return 0 for Unix domain sockets and not started server
+		 * @exception std::runtime_error
+		 */
+		uint16_t getListenerPort(size_t listenerIndex) const;
+
+		/**
+		 * @brief Replace allow/deny list checked right after accept. Can be called while server is running, accepts aren't paused and next accepted connection uses new filter.
+		 * Denied connections are closed without registration and never reach workers. Unix domain socket connections aren't filtered
+		 * @param filter Compiled rules, nullptr to accept all
+		 */
+		void setIpFilter(std::shared_ptr<const IpFilter> filter);
+
+		/**
+		 * @brief Get current IP filter
+		 * @return nullptr if filter isn't set
+		 */
+		std::shared_ptr<const IpFilter> getIpFilter() const;
+
+		/**
+		 * @brief Number of connections closed by IP filter
+		 * @return
+		 */
+		uint64_t getNumberOfFilteredConnections() const;
+
+		/**
+		 * @brief Time last stop(true) took from closing listen socket until accepting thread exited, clients were kicked and socket reaper closed their sockets. Handlers still running after kick and tasks left in thread pool aren't included
+		 * @return
+		 */
+		std::chrono::microseconds getLastDrainTime() const;
+
+		/**
+		 * @brief Number of sockets closed by socket reaper
+		 * @return 0 if socket reaper isn't used
+		 */
+		uint64_t getNumberOfReapedSockets() const;
+
+		/**
+		 * @brief Get accept batch counters, current listen queue length(TCP_INFO of listeners) and backlog overflow counters(/proc/net/netstat). Kernel values are 0 on Windows
+		 * @return
+		 */
+		AcceptStatistics getAcceptStatistics() const;
+
+		/**
+		 * @brief Classify connections into priority classes. With thread pool pending handlers are started in weighted order, without it only admission limits apply.
+		 * Must be called before start
+		 * @param classes First class is default for unclassified connections
+		 * @exception std::runtime_error
+		 */
+		void setPriorityClasses(const std::vector<PriorityClass>& classes);
+
+		/**
+		 * @brief Map IPv4 network to priority class for default classifyConnection. Must be called before start
+		 * @param network Address with optional prefix length, e.g. 10.0.0.0/8
+		 * @param priorityClass Index in setPriorityClasses list
+		 * @exception std::runtime_error
+		 */
+		void addPriorityRule(std::string_view network, uint32_t priorityClass);
+
+		/**
+		 * @brief Get connections, pending handlers and admission counters of each priority class
+		 * @return Empty if priority classes aren't set
+		 */
+		std::vector<PriorityClassStatistics> getPriorityClassesStatistics() const;
+
+		/**
+		 * @brief Preallocate connection slots, so accepting up to numberOfConnections clients doesn't allocate
+		 * @param numberOfConnections
+		 */
+		void reserveConnections(size_t numberOfConnections);
+
+		/**
+		 * @brief Sample TCP_INFO of all connections once and add samples into transport statistics
+		 */
+		void sampleTransport();
+
+		/**
+		 * @brief Call sampleTransport periodically in separate thread
+		 * @param interval
+		 */
+		void startTransportSampling(std::chrono::milliseconds interval = std::chrono::seconds(1));
+
+		/**
+		 * @brief Stop sampling thread
+		 */
+		void stopTransportSampling();
+
+		/**
+		 * @brief RTT distribution and retransmit rate per client IP collected by sampleTransport
+		 * @return
+		 */
+		const TransportStatistics& getTransportStatistics() const;
+
+		/**
+		 * @brief Get queue depth, executed and stolen tasks for each thread pool worker
+		 * @return Empty if thread pool isn't used
+		 */
+		std::vector<WorkStealingThreadPool::WorkerStatistics> getWorkersStatistics() const;
+
+		/**
+		 * @brief Get current number of workers, bounds, number of resizes and last load sample
+		 * @return Zeroed statistics if thread pool isn't used
+		 */
+		WorkStealingThreadPool::SizingStatistics getThreadPoolSizingStatistics() const;
+
+		/**
+		 * @brief Number of connections waiting in poller
+		 * @return
+		 */
+		size_t getNumberOfParkedConnections();
+
 		/**
 		 * @brief Number of IP addresses
 		 * @return
@@ -245,6 +1061,11 @@ namespace web
 	template<typename DataT>
 	int BaseTCPServer::sendBytes(SOCKET clientSocket, const DataT* const data, int size)
 	{
+		if (Transport* transport = Transport::getCurrent()) [[unlikely]]
+		{
+			return transport->sendBytes(clientSocket, reinterpret_cast<const char*>(data), size);
+		}
+
 		int lastSend = 0;
 		int totalSent = 0;
 
@@ -272,6 +1093,11 @@ namespace web
 	template<typename DataT>
 	int BaseTCPServer::receiveBytes(SOCKET clientSocket, DataT* const data, int size)
 	{
+		if (Transport* transport = Transport::getCurrent()) [[unlikely]]
+		{
+			return transport->receiveBytes(clientSocket, reinterpret_cast<char*>(data), size);
+		}
+
 		int lastReceive = recv(clientSocket, reinterpret_cast<char*>(data), size, NULL);
 
 		if (lastReceive == SOCKET_ERROR)
@@ -279,6 +1105,16 @@ namespace web
 			THROW_WEB_SERVER_EXCEPTION;
 		}
 
+		ConnectionTracer::record(ConnectionTracer::EventType::received, clientSocket);
+
 		return lastReceive;
 	}
+
+	template<typename DataT>
+	int BaseTCPServer::receiveBytes(SOCKET clientSocket, DataT* const data, int size, OutputBuffer& output)
+	{
+		output.flushReadBatch();
+
+		return BaseTCPServer::receiveBytes(clientSocket, data, size);
+	}
 }
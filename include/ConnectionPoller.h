@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Thread that waits for readability of idle sockets. Each added socket is reported once (epoll one shot on Linux, WSAPoll on Windows)
+	class ConnectionPoller
+	{
+	public:
+		enum class Event
+		{
+			/**
+			 * @brief Socket has data
+			 */
+			readable,
+			/**
+			 * @brief Peer closed connection or socket error without pending data
+			 */
+			closed
+		};
+
+		using Callback = std::function<void(SOCKET clientSocket, Event event)>;
+
+	private:
+		Callback callback;
+		std::atomic<bool> isRunning;
+#ifdef __LINUX__
+		int epollDescriptor;
+		int wakeupDescriptor;
+#else
+		std::vector<SOCKET> sockets;
+		std::mutex socketsMutex;
+#endif
+		std::thread thread;
+
+	private:
+		void pollThread();
+
+	public:
+		/**
+		 * @brief Start poller thread
+		 * @param callback Called from poller thread for each ready socket
+		 * @exception web::exceptions::WebServerException
+		 */
+		ConnectionPoller(Callback&& callback);
+
+		ConnectionPoller(const ConnectionPoller&) = delete;
+
+		ConnectionPoller& operator = (const ConnectionPoller&) = delete;
+
+		/**
+		 * @brief Wait for readability of socket. Socket is reported once, add it again to wait for next data
+		 * @param clientSocket
+		 * @exception web::exceptions::WebServerException
+		 */
+		void add(SOCKET clientSocket);
+
+		/**
+		 * @brief Stop waiting for socket
+		 * @param clientSocket
+		 */
+		void remove(SOCKET clientSocket);
+
+		/**
+		 * @brief Stop poller thread
+		 */
+		~ConnectionPoller();
+	};
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Records timestamped connection lifecycle events into per thread lock free ring buffers. Disabled tracing costs one branch per event
+	class ConnectionTracer
+	{
+	public:
+		enum class EventType : uint8_t
+		{
+			accepted,
+			dispatched,
+			handlerStart,
+			handlerEnd,
+			received,
+			closed,
+			kicked,
+			parked,
+			resumed
+		};
+
+		struct Event
+		{
+			/**
+			 * @brief std::chrono::steady_clock time in nanoseconds
+			 */
+			int64_t timestamp;
+			uint64_t socket;
+
+			/**
+			 * @brief IPv4 address in network byte order, 0 if unknown
+			 */
+			uint32_t peerAddress;
+			uint16_t peerPort;
+			EventType type;
+
+			/**
+			 * @brief Index of thread buffer that recorded event
+			 */
+			uint32_t thread;
+		};
+
+	private:
+		struct ThreadBuffer
+		{
+			std::unique_ptr<Event[]> events;
+			uint64_t mask;
+			std::atomic<uint64_t> writeIndex;
+			std::atomic<bool> used;
+			uint32_t index;
+
+			ThreadBuffer(size_t capacity, uint32_t index);
+		};
+
+	private:
+		static inline std::atomic<bool> enabled = false;
+		static std::mutex buffersMutex;
+		static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		static size_t eventsPerThread;
+
+	private:
+		static ThreadBuffer& getThreadBuffer();
+
+		static void write(EventType type, SOCKET socket, const sockaddr* address);
+
+	public:
+		/**
+		 * @brief Start recording events
+		 * @param eventsPerThread Ring buffer capacity for each thread, rounded up to power of two. Applies to buffers created after call
+		 */
+		static void enable(size_t eventsPerThread = 4096);
+
+		/**
+		 * @brief Stop recording events. Recorded events are kept for dump
+		 */
+		static void disable();
+
+		static bool isEnabled();
+
+		/**
+		 * @brief Remove recorded events. Must be called while tracing is disabled
+		 */
+		static void clear();
+
+		/**
+		 * @brief Record event if tracing is enabled
+		 * @param type
+		 * @param socket
+		 * @param address Peer address
+		 */
+		static void record(EventType type, SOCKET socket, const sockaddr& address);
+
+		/**
+		 * @brief Record event if tracing is enabled
+		 * @param type
+		 * @param socket
+		 */
+		static void record(EventType type, SOCKET socket);
+
+		/**
+		 * @brief Get recorded events of all threads sorted by timestamp. Events overwritten during call may be inconsistent
+		 * @return
+		 */
+		static std::vector<Event> getEvents();
+
+		/**
+		 * @brief Write recorded events as CSV (timestamp,thread,event,socket,ip,port) for Tools/trace_timeline.py
+		 * @param stream
+		 */
+		static void dump(std::ostream& stream);
+
+		static const char* getEventName(EventType type);
+	};
+
+	inline void ConnectionTracer::record(EventType type, SOCKET socket, const sockaddr& address)
+	{
+		if (enabled.load(std::memory_order_relaxed)) [[unlikely]]
+		{
+			ConnectionTracer::write(type, socket, &address);
+		}
+	}
+
+	inline void ConnectionTracer::record(EventType type, SOCKET socket)
+	{
+		if (enabled.load(std::memory_order_relaxed)) [[unlikely]]
+		{
+			ConnectionTracer::write(type, socket, nullptr);
+		}
+	}
+}
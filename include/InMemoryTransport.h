@@ -0,0 +1,116 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Transport.h"
+
+namespace web
+{
+	/// @brief Connections made of two in-process byte buffers. Handlers are driven at memory speed without ports, syscalls or scheduling noise of kernel sockets
+	class InMemoryTransport : public Transport
+	{
+	public:
+		/// @brief Both ends of connection
+		struct Endpoints
+		{
+			SOCKET client;
+			SOCKET server;
+		};
+
+	private:
+		/// @brief Bytes sent by one end and not yet received by other end
+		struct Stream
+		{
+			std::string data;
+			size_t offset;
+
+			/**
+			 * @brief Sender finished sending
+			 */
+			bool finished;
+
+			/**
+			 * @brief Receiver closed its end, sending fails
+			 */
+			bool receiverClosed;
+
+			std::condition_variable condition;
+		};
+
+		struct Connection
+		{
+			/**
+			 * @brief Client to server and server to client streams
+			 */
+			Stream streams[2];
+
+			/**
+			 * @brief closeEndpoint was called for client and server ends
+			 */
+			bool closed[2];
+		};
+
+	private:
+		/**
+		 * @brief First endpoint value, far from descriptors of real sockets
+		 */
+		static constexpr SOCKET firstSocket = 0x40000000;
+
+	private:
+		std::vector<std::unique_ptr<Connection>> connections;
+
+		/**
+		 * @brief Connections with both ends closed, their endpoint values are reused like descriptors of closed sockets
+		 */
+		std::vector<size_t> freeConnections;
+		mutable std::mutex transportMutex;
+
+	private:
+		/**
+		 * @brief Find stream written by socket or read by socket
+		 * @exception web::exceptions::WebServerException Unknown socket
+		 */
+		Stream& getStream(SOCKET socket, bool outgoing) const;
+
+	public:
+		InMemoryTransport() = default;
+
+		/**
+		 * @brief Create connected pair of endpoints
+		 * @return
+		 */
+		Endpoints createConnection();
+
+		/**
+		 * @brief Peer receives remaining data and then end of stream, like shutdown of sending side
+		 * @param socket
+		 * @exception web::exceptions::WebServerException
+		 */
+		void finishSending(SOCKET socket);
+
+		/**
+		 * @brief Finish sending and drop unread data, further peer's sends fail. Endpoint values are reused after both ends are closed
+		 * @param socket
+		 * @exception web::exceptions::WebServerException
+		 */
+		void closeEndpoint(SOCKET socket);
+
+		/**
+		 * @brief Number of bytes waiting to be received by socket
+		 * @param socket
+		 * @return
+		 * @exception web::exceptions::WebServerException
+		 */
+		size_t getNumberOfPendingBytes(SOCKET socket) const;
+
+		int sendBytes(SOCKET socket, const char* data, int size) override;
+
+		int receiveBytes(SOCKET socket, char* data, int size) override;
+
+		~InMemoryTransport() = default;
+	};
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace web
+{
+	/// @brief Immutable IPv4 allow/deny list. Rules are compiled into path compressed binary trie stored in one array, lookup visits at most one node per distinct prefix length on address path
+	class IpFilter
+	{
+	public:
+		enum class Action : uint8_t
+		{
+			none,
+			allow,
+			deny
+		};
+
+	private:
+		/// @brief Node with its full prefix, so chains of single child nodes without rule are skipped
+		struct Node
+		{
+			uint32_t prefix;
+			uint32_t children[2];
+			uint8_t prefixLength;
+			Action action;
+		};
+
+		static constexpr uint32_t noChild = 0;
+
+	private:
+		std::vector<Node> nodes;
+		size_t numberOfRules;
+		bool defaultAllow;
+
+	public:
+		/**
+		 * @brief Parse IPv4 network
+		 * @param network Address with optional prefix length, e.g. 10.0.0.0/8. Address without prefix length is /32
+		 * @param prefix Network address in host byte order with host bits cleared
+		 * @param prefixLength
+		 * @return false if network has wrong format
+		 */
+		static bool parseNetwork(std::string_view network, uint32_t& prefix, uint8_t& prefixLength);
+
+	public:
+		/**
+		 * @brief Compile rules. Longest matching prefix decides, deny wins for same prefix in both lists.
+		 * Address without matching rule is allowed only if allow list is empty
+		 * @param allowed Networks like 10.0.0.0/8
+		 * @param denied Networks like 10.1.2.3
+		 * @exception std::runtime_error Wrong network format
+		 */
+		IpFilter(const std::vector<std::string>& allowed, const std::vector<std::string>& denied = {});
+
+		/**
+		 * @brief Check IPv4 address
+		 * @param address Address in host byte order
+		 * @return
+		 */
+		bool isAllowed(uint32_t address) const;
+
+		/**
+		 * @brief Get action of longest matching rule
+		 * @param address Address in host byte order
+		 * @return Action::none if no rule matches
+		 */
+		Action find(uint32_t address) const;
+
+		size_t getNumberOfRules() const;
+
+		/**
+		 * @brief Number of trie nodes after path compression
+		 * @return
+		 */
+		size_t getNumberOfNodes() const;
+
+		~IpFilter() = default;
+	};
+}
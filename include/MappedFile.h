@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace web
+{
+	/// @brief File mapped into memory. Used as StreamTransfer destination, so received bytes go into page cache without intermediate buffer
+	class MappedFile
+	{
+	public:
+		enum class Mode
+		{
+			read,
+			/**
+			 * @brief Create file or open existing one and set its size
+			 */
+			readWrite
+		};
+
+	private:
+		std::byte* data;
+		uint64_t size;
+#ifdef __LINUX__
+		int file;
+#else
+		void* file;
+		void* mapping;
+#endif
+
+	private:
+		void unmap();
+
+	public:
+		/**
+		 * @brief Map whole file
+		 * @param path
+		 * @param mode
+		 * @param size Size of file in readWrite mode, ignored in read mode
+		 * @exception web::exceptions::WebServerException
+		 */
+		MappedFile(const std::filesystem::path& path, Mode mode = Mode::read, uint64_t size = 0);
+
+		MappedFile(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept;
+
+		MappedFile& operator = (const MappedFile&) = delete;
+
+		MappedFile& operator = (MappedFile&& other) noexcept;
+
+		/**
+		 * @brief Write dirty pages to file
+		 * @exception web::exceptions::WebServerException
+		 */
+		void flush();
+
+		std::span<std::byte> getData();
+
+		std::span<const std::byte> getData() const;
+
+		uint64_t getSize() const;
+
+		~MappedFile();
+	};
+}
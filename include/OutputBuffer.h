@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Per connection buffer that accumulates responses of pipelined requests and sends them with one call. Data is sent through Transport of current thread if it's installed
+	class OutputBuffer
+	{
+	private:
+		std::string buffer;
+		SOCKET clientSocket;
+		size_t highWatermark;
+		bool corked;
+
+	public:
+		/**
+		 * @brief Enable or disable TCP_CORK on socket. Does nothing on platforms without TCP_CORK
+		 * @param clientSocket
+		 * @param cork
+		 */
+		static void setCork(SOCKET clientSocket, bool cork);
+
+	public:
+		/**
+		 * @param clientSocket Socket used for flush
+		 * @param initialCapacity Reserved size of buffer
+		 * @param highWatermark Buffer is flushed by write and flushReadBatch when it reaches this size, even if more received data is waiting
+		 */
+		OutputBuffer(SOCKET clientSocket, size_t initialCapacity = 4096, size_t highWatermark = 64 * 1024);
+
+		OutputBuffer(const OutputBuffer&) = delete;
+
+		OutputBuffer& operator = (const OutputBuffer&) = delete;
+
+		/**
+		 * @brief Append data to buffer, buffer is flushed if it reached high watermark
+		 * @param data
+		 * @param size
+		 * @exception web::exceptions::WebServerException
+		 */
+		template<typename DataT>
+		void write(const DataT* const data, int size);
+
+		/**
+		 * @brief Append data to buffer, buffer is flushed if it reached high watermark
+		 * @param data
+		 * @exception web::exceptions::WebServerException
+		 */
+		void write(std::string_view data);
+
+		/**
+		 * @brief Send all accumulated data and clear buffer
+		 * @param more Tell kernel that more data follows (MSG_MORE), useful when flushing in the middle of read batch
+		 * @return Number of sent bytes, INT_MAX if more were sent
+		 * @exception web::exceptions::WebServerException
+		 */
+		int flush(bool more = false);
+
+		/**
+		 * @brief Flush if all received data is processed or buffer reached high watermark, so responses of all pipelined requests of read batch are sent with one call. Call before next receive.
+		 * Transport doesn't report received data, so with installed Transport buffer is always flushed
+		 * @return Number of sent bytes, 0 if more received data is waiting
+		 * @exception web::exceptions::WebServerException
+		 */
+		int flushReadBatch();
+
+		/**
+		 * @brief Hold partial frames in kernel until uncork
+		 */
+		void cork();
+
+		/**
+		 * @brief Flush buffer and release kernel held frames
+		 */
+		void uncork();
+
+		/**
+		 * @brief Is TCP_CORK enabled by this buffer
+		 * @return
+		 */
+		bool isCorked() const;
+
+		/**
+		 * @brief Number of accumulated bytes
+		 * @return
+		 */
+		size_t size() const;
+
+		bool empty() const;
+
+		/**
+		 * @brief Discard accumulated data
+		 */
+		void clear();
+
+		~OutputBuffer() = default;
+	};
+
+	template<typename DataT>
+	void OutputBuffer::write(const DataT* const data, int size)
+	{
+		this->write(std::string_view(reinterpret_cast<const char*>(data), size));
+	}
+}
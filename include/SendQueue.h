@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	class SendQueueFlusher;
+
+	/// @brief Per connection output queue. Enqueue never blocks, data that doesn't fit into kernel send buffer is sent by SendQueueFlusher when socket becomes writable
+	class SendQueue : public std::enable_shared_from_this<SendQueue>
+	{
+	public:
+		/**
+		 * @brief Immutable data that may be shared between many queues without copying
+		 */
+		using Payload = std::shared_ptr<const std::string>;
+
+	private:
+		struct Chunk
+		{
+			std::string data;
+			Payload payload;
+			size_t offset;
+
+			std::string_view view() const;
+		};
+
+	private:
+		std::deque<Chunk> chunks;
+		SOCKET clientSocket;
+		SendQueueFlusher* flusher;
+		size_t queuedBytes;
+		size_t highWatermark;
+		size_t lowWatermark;
+		bool scheduled;
+		bool aboveHighWatermark;
+		bool failed;
+		std::function<void()> onHighWatermark;
+		std::function<void()> onLowWatermark;
+		std::function<void()> onDrained;
+		mutable std::mutex queueMutex;
+		std::condition_variable queueCondition;
+
+	private:
+		/**
+		 * @brief Send queued chunks until kernel buffer is full. Must be called under queueMutex
+		 */
+		void sendQueued();
+
+		/**
+		 * @brief Update watermark state and schedule flush. Must be called under queueMutex
+		 * @return Callbacks to call after unlock
+		 */
+		std::vector<std::function<void()>> afterSend();
+
+		bool enqueue(Chunk&& chunk);
+
+	public:
+		/**
+		 * @param clientSocket Connected socket. On Windows socket must be in non blocking mode
+		 * @param flusher Flusher that waits for socket writability, nullptr for manual flush calls
+		 * @param highWatermark Number of queued bytes after which enqueue reports backpressure
+		 * @param lowWatermark Number of queued bytes below which producer may continue
+		 */
+		SendQueue(SOCKET clientSocket, SendQueueFlusher* flusher, size_t highWatermark = 1024 * 1024, size_t lowWatermark = 256 * 1024);
+
+		SendQueue(const SendQueue&) = delete;
+
+		SendQueue& operator = (const SendQueue&) = delete;
+
+		/**
+		 * @brief Copy data into queue and send as much as possible without blocking
+		 * @param data
+		 * @return false if queue is above high watermark or failed, producer should wait for low watermark
+		 */
+		bool enqueue(std::string_view data);
+
+		/**
+		 * @brief Add shared payload into queue without copying and send as much as possible without blocking
+		 * @param payload
+		 * @param offset Number of payload bytes already sent
+		 * @return false if queue is above high watermark or failed, producer should wait for low watermark
+		 */
+		bool enqueue(const Payload& payload, size_t offset = 0);
+
+		/**
+		 * @brief Send queued data without blocking. Called by SendQueueFlusher when socket becomes writable
+		 * @return true if queue is empty or failed and doesn't need more flushes
+		 */
+		bool flush();
+
+		/**
+		 * @brief Wait until number of queued bytes drops below low watermark
+		 * @param timeout
+		 * @return false on timeout or if queue failed
+		 */
+		bool waitLowWatermark(std::chrono::milliseconds timeout);
+
+		/**
+		 * @brief Wait until all queued data is sent
+		 * @param timeout
+		 * @return false on timeout or if queue failed
+		 */
+		bool waitDrained(std::chrono::milliseconds timeout);
+
+		/**
+		 * @brief Called when queued bytes reach high watermark
+		 * @param callback
+		 */
+		void setOnHighWatermark(const std::function<void()>& callback);
+
+		/**
+		 * @brief Called from flusher thread when queued bytes drop below low watermark after reaching high watermark
+		 * @param callback
+		 */
+		void setOnLowWatermark(const std::function<void()>& callback);
+
+		/**
+		 * @brief Call cleanup once queue is drained or failed, e.g. move cleanup from clientConnection here to close socket after all data is sent
+		 * @param cleanup
+		 */
+		void closeAfterFlush(std::function<void()>&& cleanup);
+
+		/**
+		 * @brief Discard queued data, fail queue and remove it from flusher, so nothing is written into socket after return. Call before socket is closed, cleanup set by closeAfterFlush is called
+		 */
+		void cancel();
+
+		/**
+		 * @brief Number of bytes waiting in queue
+		 * @return
+		 */
+		size_t getQueuedBytes() const;
+
+		bool isAboveHighWatermark() const;
+
+		/**
+		 * @brief Is send failed with error other than would block or queue cancelled. Queued data is discarded
+		 * @return
+		 */
+		bool isFailed() const;
+
+		SOCKET getSocket() const;
+
+		~SendQueue() = default;
+	};
+
+	/// @brief Thread that waits for writability of sockets with pending SendQueue data and flushes them
+	class SendQueueFlusher
+	{
+	private:
+		std::vector<std::shared_ptr<SendQueue>> scheduledQueues;
+
+		/**
+		 * @brief Queues waiting for writability, used only by flusher thread and by destructor after thread is stopped
+		 */
+		std::vector<std::shared_ptr<SendQueue>> queues;
+
+		/**
+		 * @brief Some queue was cancelled, flusher thread drops failed queues
+		 */
+		bool hasCancelledQueues;
+		std::mutex scheduleMutex;
+		std::atomic<bool> isRunning;
+#ifdef __LINUX__
+		int wakeupDescriptor;
+#endif
+		std::thread thread;
+
+	private:
+		void flushThread();
+
+	public:
+		/**
+		 * @brief Start flusher thread
+		 */
+		SendQueueFlusher();
+
+		SendQueueFlusher(const SendQueueFlusher&) = delete;
+
+		SendQueueFlusher& operator = (const SendQueueFlusher&) = delete;
+
+		/**
+		 * @brief Flush queue when its socket becomes writable
+		 * @param queue
+		 */
+		void schedule(std::shared_ptr<SendQueue>&& queue);
+
+		/**
+		 * @brief Remove queue from scheduled queues and make flusher thread drop it. Called by SendQueue::cancel
+		 * @param queue
+		 */
+		void unschedule(const SendQueue* queue);
+
+		/**
+		 * @brief Stop flusher thread. Pending data is discarded and remaining queues are cancelled, so their close after flush cleanups are called
+		 */
+		~SendQueueFlusher();
+	};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Bidirectional relay between two connected sockets. On Linux bytes are moved through kernel pipes with splice without copying to user space
+	class SocketForwarder
+	{
+	public:
+		struct Result
+		{
+			uint64_t firstToSecondBytes;
+			uint64_t secondToFirstBytes;
+
+			/**
+			 * @brief No data moved in any direction during idle timeout
+			 */
+			bool timedOut;
+
+			/**
+			 * @brief Forwarding stopped because of socket error, e.g. connection reset
+			 */
+			bool failed;
+
+			/**
+			 * @brief splice was used
+			 */
+			bool zeroCopy;
+		};
+
+	public:
+		/**
+		 * @brief Forward data in both directions until both sides finish sending. EOF in one direction is passed as shutdown of sending side of other socket (half close).
+		 * Sockets may be in blocking or non blocking mode, mode is restored before return (on Windows sockets are returned in blocking mode). Sockets aren't closed
+		 * @param first
+		 * @param second
+		 * @param idleTimeout Stop if no data moved during this time, 0 for no timeout
+		 * @param bufferSize Maximum number of bytes in flight for each direction (pipe size or user space buffer size)
+		 * @return
+		 */
+		static Result forward(SOCKET first, SOCKET second, std::chrono::milliseconds idleTimeout = std::chrono::milliseconds(0), size_t bufferSize = 64 * 1024);
+	};
+}
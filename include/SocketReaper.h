@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Thread that closes sockets in batches. Sockets are shut down in calling thread, so handlers blocked in recv or send wake immediately, and closed later off hot path
+	class SocketReaper
+	{
+	private:
+		std::vector<SOCKET> pendingSockets;
+		std::chrono::milliseconds closeDelay;
+		std::atomic<uint64_t> closedSockets;
+		bool isRunning;
+
+		/**
+		 * @brief Batch is taken from pendingSockets and being closed
+		 */
+		bool closing;
+
+		mutable std::mutex reaperMutex;
+		std::condition_variable reaperCondition;
+		std::condition_variable idleCondition;
+		std::thread thread;
+
+	private:
+		static void shutdownSocket(SOCKET socket);
+
+	private:
+		void reaperThread();
+
+	public:
+		/**
+		 * @brief Start reaper thread
+		 * @param closeDelay Time between first queued socket and closing of batch. Handlers woken by shutdown return before descriptor numbers are reused
+		 */
+		SocketReaper(std::chrono::milliseconds closeDelay = std::chrono::milliseconds(10));
+
+		SocketReaper(const SocketReaper&) = delete;
+
+		SocketReaper& operator = (const SocketReaper&) = delete;
+
+		/**
+		 * @brief Shutdown socket in both directions and queue it for closing
+		 * @param socket
+		 */
+		void reap(SOCKET socket);
+
+		/**
+		 * @brief Shutdown sockets and queue them with one lock
+		 * @param sockets
+		 */
+		void reap(const std::vector<SOCKET>& sockets);
+
+		/**
+		 * @brief Wait until all queued sockets are closed
+		 */
+		void waitIdle();
+
+		size_t getNumberOfPendingSockets() const;
+
+		uint64_t getNumberOfClosedSockets() const;
+
+		/**
+		 * @brief Close remaining sockets and stop reaper thread
+		 */
+		~SocketReaper();
+	};
+}
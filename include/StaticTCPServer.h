@@ -0,0 +1,406 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "BaseTCPServer.h"
+
+namespace web
+{
+	namespace policies
+	{
+		/// @brief Serve each client in separate detached thread
+		class ThreadPerConnection
+		{
+		public:
+			template<typename FunctionT>
+			void dispatch(FunctionT&& function);
+		};
+
+		/// @brief Serve clients in accepting thread
+		class SingleThread
+		{
+		public:
+			template<typename FunctionT>
+			void dispatch(FunctionT&& function);
+		};
+
+		/// @brief Serve clients in WorkStealingThreadPool
+		class ThreadPool
+		{
+		private:
+			WorkStealingThreadPool threadPool;
+
+		public:
+			/**
+			 * @param numberOfWorkers Number of worker threads, 0 for std::thread::hardware_concurrency
+			 */
+			ThreadPool(size_t numberOfWorkers = 0);
+
+			template<typename FunctionT>
+			void dispatch(FunctionT&& function);
+
+			const WorkStealingThreadPool& getThreadPool() const;
+		};
+
+		/// @brief Blocking TCP sockets
+		class SocketIO
+		{
+		public:
+			/**
+			 * @brief Load Ws2_32.dll on Windows
+			 */
+			static void initialize();
+
+			/**
+			 * @brief Unload Ws2_32.dll on Windows
+			 */
+			static void cleanup();
+
+			static SOCKET createListenSocket(std::string_view ip, std::string_view port);
+
+			/**
+			 * @brief Wait for next connection
+			 * @param listenSocket
+			 * @param address Client address
+			 * @return INVALID_SOCKET if accept failed or listen socket was closed
+			 */
+			static SOCKET accept(SOCKET listenSocket, sockaddr& address);
+
+			/**
+			 * @brief Set send and receive timeouts for accepted socket
+			 * @param clientSocket
+			 * @param timeout Timeout in milliseconds, 0 wait for upcoming data
+			 */
+			static void configure(SOCKET clientSocket, DWORD timeout);
+
+			/**
+			 * @brief Close listen socket and wake up thread blocked in accept
+			 * @param listenSocket
+			 */
+			static void closeListenSocket(SOCKET listenSocket);
+
+			static void closeSocket(SOCKET clientSocket);
+
+			template<typename DataT>
+			static int sendBytes(SOCKET clientSocket, const DataT* const data, int size);
+
+			template<typename DataT>
+			static int receiveBytes(SOCKET clientSocket, DataT* const data, int size);
+		};
+	}
+
+	/**
+	 * @brief Compile time alternative of BaseTCPServer without virtual calls and type erased cleanup
+	 * @tparam HandlerT Derived class (CRTP). Must define void clientConnection(const std::string& ip, SOCKET clientSocket, sockaddr address).
+	 * May hide onConnectionReceive, onInvalidConnectionReceive and autoCloseSocket
+	 * @tparam ThreadingPolicyT Class with template dispatch(FunctionT&&) method: policies::ThreadPerConnection, policies::SingleThread, policies::ThreadPool
+	 * @tparam IOPolicyT Class with static socket functions like policies::SocketIO
+	 */
+	template<typename HandlerT, typename ThreadingPolicyT = policies::ThreadPerConnection, typename IOPolicyT = policies::SocketIO>
+	class StaticTCPServer
+	{
+	protected:
+		ThreadingPolicyT threading;
+		std::string ip;
+		std::string port;
+		SOCKET listenSocket;
+		DWORD timeout;
+		std::atomic<bool> isRunning;
+		std::future<void> handle;
+
+	protected:
+		void receiveConnections(const std::function<void()>& onStartServer, std::exception** outException);
+
+		void serve(SOCKET clientSocket, sockaddr address);
+
+		void onConnectionReceive(SOCKET clientSocket, sockaddr address);
+
+		void onInvalidConnectionReceive();
+
+		/**
+		 * @brief Automatically close socket after clientConnection
+		 * @return
+		 */
+		bool autoCloseSocket() const;
+
+	protected:
+		template<typename DataT>
+		static int sendBytes(SOCKET clientSocket, const DataT* const data, int size);
+
+		template<typename DataT>
+		static int receiveBytes(SOCKET clientSocket, DataT* const data, int size);
+
+	public:
+		/// @brief
+		/// @param port Server's port
+		/// @param host Server's host
+		/// @param timeout recv function timeout in milliseconds, 0 wait for upcoming data
+		/// @param threadingArguments Arguments for ThreadingPolicyT constructor
+		template<typename... Args>
+		StaticTCPServer(std::string_view port, std::string_view host = "0.0.0.0", DWORD timeout = 0, Args&&... threadingArguments);
+
+		StaticTCPServer(const StaticTCPServer&) = delete;
+
+		StaticTCPServer& operator = (const StaticTCPServer&) = delete;
+
+		/**
+		 * @brief Start server in separate thread
+		 * @param wait Wait server serving in current thread
+		 * @param onStartServer Call function before accept first connection
+		 */
+		void start(bool wait = false, const std::function<void()>& onStartServer = []() {}, std::exception** outException = nullptr);
+
+		/**
+		 * @brief Stop receiving new connections
+		 * @param wait Wait accepting thread
+		 */
+		void stop(bool wait = true);
+
+		/**
+		 * @brief Is server accept new connections
+		 * @return
+		 */
+		bool isServerRunning() const;
+
+		uint16_t getServerPortV4() const;
+
+		const ThreadingPolicyT& getThreadingPolicy() const;
+
+		~StaticTCPServer();
+	};
+
+	namespace policies
+	{
+		template<typename FunctionT>
+		void ThreadPerConnection::dispatch(FunctionT&& function)
+		{
+			std::thread(std::forward<FunctionT>(function)).detach();
+		}
+
+		template<typename FunctionT>
+		void SingleThread::dispatch(FunctionT&& function)
+		{
+			function();
+		}
+
+		template<typename FunctionT>
+		void ThreadPool::dispatch(FunctionT&& function)
+		{
+			threadPool.addTask(std::forward<FunctionT>(function));
+		}
+
+		template<typename DataT>
+		int SocketIO::sendBytes(SOCKET clientSocket, const DataT* const data, int size)
+		{
+			int lastSend = 0;
+			int totalSent = 0;
+
+			do
+			{
+				lastSend = send(clientSocket, reinterpret_cast<const char*>(data) + totalSent, size - totalSent, 0);
+
+				if (lastSend == SOCKET_ERROR)
+				{
+					THROW_WEB_SERVER_EXCEPTION;
+				}
+				else if (!lastSend)
+				{
+					return totalSent;
+				}
+
+				totalSent += lastSend;
+			} while (totalSent < size);
+
+			return totalSent;
+		}
+
+		template<typename DataT>
+		int SocketIO::receiveBytes(SOCKET clientSocket, DataT* const data, int size)
+		{
+			int lastReceive = recv(clientSocket, reinterpret_cast<char*>(data), size, 0);
+
+			if (lastReceive == SOCKET_ERROR)
+			{
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+
+			return lastReceive;
+		}
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	void StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::receiveConnections(const std::function<void()>& onStartServer, std::exception** outException)
+	{
+		try
+		{
+			if (onStartServer)
+			{
+				onStartServer();
+			}
+
+			while (isRunning)
+			{
+				sockaddr address = {};
+				SOCKET clientSocket = IOPolicyT::accept(listenSocket, address);
+
+				if (isRunning && clientSocket != INVALID_SOCKET)
+				{
+					IOPolicyT::configure(clientSocket, timeout);
+
+					threading.dispatch([this, clientSocket, address]() { this->serve(clientSocket, address); });
+				}
+				else
+				{
+					static_cast<HandlerT*>(this)->onInvalidConnectionReceive();
+				}
+			}
+		}
+		catch (const std::exception& e)
+		{
+			if (outException)
+			{
+				*outException = new std::runtime_error(e.what());
+			}
+			else
+			{
+				std::cerr << __func__ << " throws exception: " << e.what() << std::endl;
+			}
+		}
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	void StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::serve(SOCKET clientSocket, sockaddr address)
+	{
+		HandlerT& handler = *static_cast<HandlerT*>(this);
+
+		handler.onConnectionReceive(clientSocket, address);
+
+		handler.clientConnection(BaseTCPServer::getClientIpV4(address), clientSocket, address);
+
+		if (handler.autoCloseSocket())
+		{
+			IOPolicyT::closeSocket(clientSocket);
+		}
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	void StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::onConnectionReceive(SOCKET clientSocket, sockaddr address)
+	{
+
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	void StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::onInvalidConnectionReceive()
+	{
+
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	bool StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::autoCloseSocket() const
+	{
+		return true;
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	template<typename DataT>
+	int StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::sendBytes(SOCKET clientSocket, const DataT* const data, int size)
+	{
+		return IOPolicyT::sendBytes(clientSocket, data, size);
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	template<typename DataT>
+	int StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::receiveBytes(SOCKET clientSocket, DataT* const data, int size)
+	{
+		return IOPolicyT::receiveBytes(clientSocket, data, size);
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	template<typename... Args>
+	StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::StaticTCPServer(std::string_view port, std::string_view host, DWORD timeout, Args&&... threadingArguments) :
+		threading(std::forward<Args>(threadingArguments)...),
+		ip(host),
+		port(port),
+		listenSocket(INVALID_SOCKET),
+		timeout(timeout),
+		isRunning(false)
+	{
+		IOPolicyT::initialize();
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	void StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::start(bool wait, const std::function<void()>& onStartServer, std::exception** outException)
+	{
+		listenSocket = IOPolicyT::createListenSocket(ip, port);
+
+		isRunning = true;
+
+		handle = std::async(std::launch::async, &StaticTCPServer::receiveConnections, this, onStartServer, outException);
+
+		if (wait)
+		{
+			handle.wait();
+		}
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	void StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::stop(bool wait)
+	{
+		isRunning = false;
+
+		IOPolicyT::closeListenSocket(listenSocket);
+
+		if (wait && handle.valid())
+		{
+			handle.wait();
+		}
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	bool StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::isServerRunning() const
+	{
+		return isRunning;
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	uint16_t StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::getServerPortV4() const
+	{
+		sockaddr address = {};
+#ifdef __LINUX__
+		socklen_t length = sizeof(address);
+#else
+		int length = sizeof(address);
+#endif
+
+		getsockname(listenSocket, &address, &length);
+
+		return BaseTCPServer::getClientPortV4(address);
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	const ThreadingPolicyT& StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::getThreadingPolicy() const
+	{
+		return threading;
+	}
+
+	template<typename HandlerT, typename ThreadingPolicyT, typename IOPolicyT>
+	StaticTCPServer<HandlerT, ThreadingPolicyT, IOPolicyT>::~StaticTCPServer()
+	{
+		if (isRunning)
+		{
+			this->stop();
+		}
+
+		if (handle.valid())
+		{
+			handle.wait();
+		}
+
+		IOPolicyT::cleanup();
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <stop_token>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Send and receive payloads of any size with 64-bit counters. Payload is moved in chunks, progress is reported after each chunk. Chunks go through Transport installed for current thread, kernel socket is used directly otherwise
+	class StreamTransfer
+	{
+	public:
+		/**
+		 * @brief Called after each chunk
+		 * @param transferred Bytes transferred so far
+		 * @param total Size of payload
+		 */
+		using ProgressCallback = std::function<void(uint64_t transferred, uint64_t total)>;
+
+		struct Options
+		{
+			/**
+			 * @brief Maximum number of bytes per send or recv call, 0 for socket buffer size clamped to [64 KiB, 16 MiB]
+			 */
+			size_t chunkSize = 0;
+
+			ProgressCallback onProgress;
+
+			/**
+			 * @brief Stop request shuts down socket in both directions, so blocked send or recv returns immediately. Connection can't be used after cancellation. With Transport stop request is checked between chunks and socket isn't shut down
+			 */
+			std::stop_token stopToken;
+		};
+
+		struct Result
+		{
+			uint64_t transferred;
+
+			/**
+			 * @brief Whole payload transferred
+			 */
+			bool completed;
+
+			/**
+			 * @brief Stopped by stopToken
+			 */
+			bool cancelled;
+
+			/**
+			 * @brief Peer closed connection before whole payload was received
+			 */
+			bool endOfStream;
+		};
+
+	private:
+		static size_t getChunkSize(SOCKET socket, int bufferOption, const Options& options);
+
+	public:
+		/**
+		 * @brief Send whole payload. Non blocking sockets are waited with poll
+		 * @param socket
+		 * @param data
+		 * @param options
+		 * @return
+		 * @exception web::exceptions::WebServerException Socket error, transferred bytes are reported through onProgress
+		 */
+		static Result send(SOCKET socket, std::span<const std::byte> data, const Options& options);
+
+		static Result send(SOCKET socket, std::span<const std::byte> data);
+
+		/**
+		 * @brief Receive until destination is full, peer closes connection or transfer is cancelled. Non blocking sockets are waited with poll
+		 * @param socket
+		 * @param destination Caller's buffer or MappedFile data
+		 * @param options
+		 * @return
+		 * @exception web::exceptions::WebServerException Socket error, transferred bytes are reported through onProgress
+		 */
+		static Result receive(SOCKET socket, std::span<std::byte> destination, const Options& options);
+
+		static Result receive(SOCKET socket, std::span<std::byte> destination);
+	};
+}
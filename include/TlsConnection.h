@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#include <openssl/ssl.h>
+
+#include "Transport.h"
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Server side TLS settings shared between connections
+	class TlsContext
+	{
+	private:
+		SSL_CTX* context;
+
+	public:
+		/**
+		 * @param certificatePath Path to PEM certificate chain
+		 * @param privateKeyPath Path to PEM private key
+		 * @param kernelTls Switch connections to kernel TLS after handshake when kernel and OpenSSL support it
+		 * @exception std::runtime_error
+		 */
+		TlsContext(std::string_view certificatePath, std::string_view privateKeyPath, bool kernelTls = true);
+
+		TlsContext(const TlsContext&) = delete;
+
+		TlsContext& operator = (const TlsContext&) = delete;
+
+		SSL_CTX* getContext() const;
+
+		~TlsContext();
+	};
+
+	/// @brief TLS session over accepted socket. Handshake is made by OpenSSL, records are encrypted by kernel if kernel TLS is available.
+	/// Install it with Transport::Scope, so BaseTCPServer::sendBytes, receiveBytes and OutputBuffer of handler's thread go through TLS
+	class TlsConnection : public Transport
+	{
+	private:
+		std::unique_ptr<SSL, decltype(&SSL_free)> ssl;
+		SOCKET clientSocket;
+		bool kernelSend;
+		bool kernelReceive;
+
+	private:
+		static void waitSocket(SOCKET clientSocket, int error);
+
+		static void throwTlsError(int error);
+
+	private:
+		int send(const char* data, int size);
+
+		int receive(char* data, int size);
+
+	public:
+		/**
+		 * @brief Make server side handshake
+		 * @param context
+		 * @param clientSocket Accepted socket in blocking or non blocking mode
+		 * @exception std::runtime_error
+		 */
+		TlsConnection(const TlsContext& context, SOCKET clientSocket);
+
+		TlsConnection(const TlsConnection&) = delete;
+
+		TlsConnection& operator = (const TlsConnection&) = delete;
+
+		/**
+		 * @brief Send all data
+		 * @param data
+		 * @param size
+		 * @return Number of sent bytes
+		 */
+		template<typename DataT>
+		int sendBytes(const DataT* const data, int size);
+
+		/**
+		 * @brief Receive up to size bytes
+		 * @param data
+		 * @param size
+		 * @return Number of received bytes, 0 if peer closed connection
+		 */
+		template<typename DataT>
+		int receiveBytes(DataT* const data, int size);
+
+		/**
+		 * @brief Send through TLS if socket is connection's socket, other sockets of thread are used without TLS
+		 * @param socket
+		 * @param data
+		 * @param size
+		 * @return Number of sent bytes
+		 * @exception web::exceptions::WebServerException
+		 * @exception std::runtime_error
+		 */
+		int sendBytes(SOCKET socket, const char* data, int size) override;
+
+		/**
+		 * @brief Receive through TLS if socket is connection's socket, other sockets of thread are used without TLS
+		 * @param socket
+		 * @param data
+		 * @param size
+		 * @return Number of received bytes, 0 if peer closed connection
+		 * @exception web::exceptions::WebServerException
+		 * @exception std::runtime_error
+		 */
+		int receiveBytes(SOCKET socket, char* data, int size) override;
+
+		/**
+		 * @brief Send part of file. Uses sendfile when kernel TLS is enabled for sending
+		 * @param fileDescriptor
+		 * @param offset Offset in file
+		 * @param size Number of bytes to send
+		 * @return Number of sent bytes
+		 */
+		int64_t sendFile(int fileDescriptor, int64_t offset, size_t size);
+
+		/**
+		 * @brief Is sending encrypted by kernel
+		 * @return
+		 */
+		bool isKernelTlsSend() const;
+
+		/**
+		 * @brief Is receiving decrypted by kernel
+		 * @return
+		 */
+		bool isKernelTlsReceive() const;
+
+		SSL* getSSL() const;
+
+		SOCKET getSocket() const;
+
+		/**
+		 * @brief Send close_notify and free session. Socket isn't closed
+		 */
+		~TlsConnection();
+	};
+
+	template<typename DataT>
+	int TlsConnection::sendBytes(const DataT* const data, int size)
+	{
+		return this->send(reinterpret_cast<const char*>(data), size);
+	}
+
+	template<typename DataT>
+	int TlsConnection::receiveBytes(DataT* const data, int size)
+	{
+		return this->receive(reinterpret_cast<char*>(data), size);
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Byte stream under BaseTCPServer::sendBytes and receiveBytes. Kernel sockets are used unless transport is installed for current thread with Transport::Scope
+	class Transport
+	{
+	public:
+		/// @brief Install transport for current thread until destruction, previous transport is restored
+		class Scope
+		{
+		private:
+			Transport* previous;
+
+		public:
+			Scope(Transport& transport);
+
+			Scope(const Scope&) = delete;
+
+			Scope& operator = (const Scope&) = delete;
+
+			~Scope();
+		};
+
+	private:
+		static thread_local Transport* current;
+
+	public:
+		/**
+		 * @brief Get transport of current thread
+		 * @return nullptr if sockets are used
+		 */
+		static Transport* getCurrent();
+
+	public:
+		Transport() = default;
+
+		/**
+		 * @brief Send whole data
+		 * @param socket
+		 * @param data
+		 * @param size
+		 * @return Number of sent bytes
+		 * @exception web::exceptions::WebServerException
+		 */
+		virtual int sendBytes(SOCKET socket, const char* data, int size) = 0;
+
+		/**
+		 * @brief Receive available data, wait if there is no data
+		 * @param socket
+		 * @param data
+		 * @param size
+		 * @return Number of received bytes, 0 if peer finished sending
+		 * @exception web::exceptions::WebServerException
+		 */
+		virtual int receiveBytes(SOCKET socket, char* data, int size) = 0;
+
+		virtual ~Transport() = default;
+	};
+
+	inline Transport* Transport::getCurrent()
+	{
+		return current;
+	}
+}
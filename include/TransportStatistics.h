@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __LINUX__
+#include <sys/types.h>
+#include <sys/socket.h>
+#else
+#include <WinSock2.h>
+#endif // __LINUX__
+
+#ifdef __LINUX__
+#ifndef WINDOWS_STYLE_DEFINITION
+#define WINDOWS_STYLE_DEFINITION
+
+#define closesocket close
+#define SOCKET int
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define DWORD uint32_t
+
+#endif // WINDOWS_STYLE_DEFINITION
+#endif // __LINUX__
+
+namespace web
+{
+	/// @brief Kernel view of TCP connection (TCP_INFO on Linux, SIO_TCP_INFO on Windows)
+	struct TransportInfo
+	{
+		uint32_t rttMicroseconds;
+
+		/**
+		 * @brief 0 on Windows
+		 */
+		uint32_t rttVarianceMicroseconds;
+
+		uint32_t minRttMicroseconds;
+
+		uint32_t congestionWindowBytes;
+
+		/**
+		 * @brief Total number of retransmitted segments since connection start. Estimated from retransmitted bytes on Windows
+		 */
+		uint64_t retransmittedSegments;
+
+		/**
+		 * @brief Total number of sent segments since connection start. Estimated from sent bytes on Windows
+		 */
+		uint64_t sentSegments;
+
+		/**
+		 * @brief Bytes in kernel send buffer not yet acknowledged by peer
+		 */
+		uint32_t sendQueueBytes;
+	};
+
+	/// @brief Aggregated TCP_INFO samples: RTT distribution and retransmit rate per client IP
+	class TransportStatistics
+	{
+	public:
+		struct Sample
+		{
+			std::string ip;
+			SOCKET clientSocket;
+			TransportInfo info;
+		};
+
+		struct ClientStatistics
+		{
+			uint64_t samples;
+			uint64_t rttSumMicroseconds;
+			uint32_t maxRttMicroseconds;
+
+			/**
+			 * @brief Segments retransmitted by sampled connections
+			 */
+			uint64_t retransmittedSegments;
+
+			/**
+			 * @brief Segments sent by sampled connections
+			 */
+			uint64_t sentSegments;
+
+			/**
+			 * @brief Sum of sendQueueBytes of client's connections in last sample
+			 */
+			uint64_t sendQueueBytes;
+
+			/**
+			 * @brief Number of add call that last sampled client's connection
+			 */
+			uint64_t lastRound;
+
+			double getAverageRttMicroseconds() const;
+
+			/**
+			 * @brief Retransmitted segments / sent segments
+			 * @return
+			 */
+			double getRetransmitRate() const;
+		};
+
+		/**
+		 * @brief Bucket i counts RTT samples in [2^(i - 1), 2^i) microseconds, bucket 0 counts 0 microseconds
+		 */
+		static constexpr size_t numberOfRttBuckets = 32;
+
+		/**
+		 * @brief Key of clients that appeared while number of clients was at limit
+		 */
+		static constexpr std::string_view otherClients = "other";
+
+	private:
+		struct ConnectionState
+		{
+			uint64_t retransmittedSegments;
+			uint64_t sentSegments;
+			uint64_t round;
+		};
+
+	private:
+		std::array<uint64_t, numberOfRttBuckets> rttHistogram;
+		std::unordered_map<std::string, ClientStatistics> clients;
+		std::unordered_map<SOCKET, ConnectionState> connections;
+		size_t maxClients;
+		uint64_t idleRounds;
+		uint64_t round;
+		mutable std::mutex statisticsMutex;
+
+	public:
+		/**
+		 * @brief Get TCP_INFO of socket
+		 * @param clientSocket
+		 * @param info
+		 * @return false if socket isn't TCP socket or kernel doesn't provide information
+		 */
+		static bool sample(SOCKET clientSocket, TransportInfo& info);
+
+	public:
+		/**
+		 * @param maxClients Number of IPs with own statistics, samples of other IPs are added into otherClients entry
+		 * @param idleRounds Client is forgotten when its connections aren't sampled in this number of add calls
+		 */
+		TransportStatistics(size_t maxClients = 4096, uint64_t idleRounds = 60);
+
+		/**
+		 * @brief Add samples of all connections taken at the same time. Counters of connections that are missing in samples are forgotten
+		 * @param samples
+		 */
+		void add(const std::vector<Sample>& samples);
+
+		std::array<uint64_t, numberOfRttBuckets> getRttHistogram() const;
+
+		/**
+		 * @brief Estimate RTT percentile from histogram
+		 * @param percentile Value in [0, 100]
+		 * @return Upper bound of histogram bucket in microseconds
+		 */
+		uint32_t getRttPercentile(double percentile) const;
+
+		/**
+		 * @brief Get statistics per IP
+		 * @return At most maxClients IPs and otherClients entry
+		 */
+		std::unordered_map<std::string, ClientStatistics> getClients() const;
+
+		uint64_t getNumberOfSamples() const;
+
+		void clear();
+
+		~TransportStatistics() = default;
+	};
+}
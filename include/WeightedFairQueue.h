@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace web
+{
+	/// @brief FIFO queue per class. Classes are served by smooth weighted round robin, so under backlog each class gets share of pops proportional to its weight and no class waits behind long run of other class
+	template<typename T>
+	class WeightedFairQueue
+	{
+	private:
+		struct Class
+		{
+			std::deque<T> items;
+			uint32_t weight;
+
+			/**
+			 * @brief Smooth weighted round robin counter, reset while class is empty so idle class doesn't accumulate burst
+			 */
+			int64_t credit;
+
+			uint64_t served;
+		};
+
+	private:
+		std::vector<Class> classes;
+		mutable std::mutex queueMutex;
+
+	public:
+		/**
+		 * @param weights Weight of each class, 0 is treated as 1
+		 */
+		WeightedFairQueue(const std::vector<uint32_t>& weights);
+
+		/**
+		 * @brief Add item to end of class queue
+		 * @param classIndex
+		 * @param item
+		 * @exception std::out_of_range
+		 */
+		void push(size_t classIndex, T&& item);
+
+		/**
+		 * @brief Take oldest item of next class in weighted order
+		 * @param item
+		 * @return false if all classes are empty
+		 */
+		bool pop(T& item);
+
+		/**
+		 * @brief Remove newest item of class equal to item, e.g. when item was pushed but its consumer wasn't started
+		 * @param classIndex
+		 * @param item
+		 * @return false if item was already taken
+		 */
+		bool remove(size_t classIndex, const T& item);
+
+		/**
+		 * @brief Number of waiting items of class
+		 * @param classIndex
+		 * @return
+		 */
+		size_t size(size_t classIndex) const;
+
+		/**
+		 * @brief Number of items taken from class
+		 * @param classIndex
+		 * @return
+		 */
+		uint64_t getServed(size_t classIndex) const;
+
+		size_t getNumberOfClasses() const;
+
+		~WeightedFairQueue() = default;
+	};
+
+	template<typename T>
+	WeightedFairQueue<T>::WeightedFairQueue(const std::vector<uint32_t>& weights) :
+		classes(weights.size())
+	{
+		for (size_t i = 0; i < weights.size(); i++)
+		{
+			classes[i].weight = weights[i] ? weights[i] : 1;
+			classes[i].credit = 0;
+			classes[i].served = 0;
+		}
+	}
+
+	template<typename T>
+	void WeightedFairQueue<T>::push(size_t classIndex, T&& item)
+	{
+		if (classIndex >= classes.size())
+		{
+			throw std::out_of_range("Wrong class index");
+		}
+
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		classes[classIndex].items.push_back(std::move(item));
+	}
+
+	template<typename T>
+	bool WeightedFairQueue<T>::pop(T& item)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		Class* next = nullptr;
+		int64_t totalWeight = 0;
+
+		for (Class& current : classes)
+		{
+			if (current.items.empty())
+			{
+				current.credit = 0;
+
+				continue;
+			}
+
+			current.credit += current.weight;
+			totalWeight += current.weight;
+
+			if (!next || current.credit > next->credit)
+			{
+				next = &current;
+			}
+		}
+
+		if (!next)
+		{
+			return false;
+		}
+
+		next->credit -= totalWeight;
+		next->served++;
+
+		item = std::move(next->items.front());
+
+		next->items.pop_front();
+
+		// Class that goes idle starts from zero when it's active again
+		if (next->items.empty())
+		{
+			next->credit = 0;
+		}
+
+		return true;
+	}
+
+	template<typename T>
+	bool WeightedFairQueue<T>::remove(size_t classIndex, const T& item)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		if (classIndex >= classes.size())
+		{
+			return false;
+		}
+
+		std::deque<T>& items = classes[classIndex].items;
+
+		for (auto it = items.rbegin(); it != items.rend(); ++it)
+		{
+			if (*it == item)
+			{
+				items.erase(std::next(it).base());
+
+				if (items.empty())
+				{
+					classes[classIndex].credit = 0;
+				}
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	template<typename T>
+	size_t WeightedFairQueue<T>::size(size_t classIndex) const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		return classIndex < classes.size() ? classes[classIndex].items.size() : 0;
+	}
+
+	template<typename T>
+	uint64_t WeightedFairQueue<T>::getServed(size_t classIndex) const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		return classIndex < classes.size() ? classes[classIndex].served : 0;
+	}
+
+	template<typename T>
+	size_t WeightedFairQueue<T>::getNumberOfClasses() const
+	{
+		return classes.size();
+	}
+}
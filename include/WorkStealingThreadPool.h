@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace web
+{
+	/// @brief Thread pool with per worker task queues. Idle workers steal tasks from other workers queues
+	class WorkStealingThreadPool
+	{
+	public:
+		using Task = std::function<void()>;
+
+		struct WorkerStatistics
+		{
+			/**
+			 * @brief Number of tasks waiting in worker's queue
+			 */
+			size_t queueDepth;
+
+			/**
+			 * @brief Number of tasks executed by worker
+			 */
+			uint64_t executedTasks;
+
+			/**
+			 * @brief Number of tasks worker took from other workers queues
+			 */
+			uint64_t stolenTasks;
+		};
+
+		/// @brief Bounds and thresholds of adaptive pool. Pool grows when tasks wait or saturated workers run long handlers and CPU isn't saturated, shrinks after long idle period
+		struct SizingOptions
+		{
+			size_t minWorkers = 1;
+			size_t maxWorkers = 64;
+
+			/**
+			 * @brief Period of load sampling
+			 */
+			std::chrono::milliseconds interval = std::chrono::milliseconds(100);
+
+			/**
+			 * @brief Number of consecutive overloaded samples before growing
+			 */
+			size_t growSamples = 3;
+
+			/**
+			 * @brief Number of consecutive idle samples before shrinking by one worker
+			 */
+			size_t shrinkSamples = 50;
+
+			/**
+			 * @brief Average handler time above which busy pool is considered blocked in IO and grows without queued tasks
+			 */
+			std::chrono::microseconds latencyThreshold = std::chrono::milliseconds(1);
+
+			/**
+			 * @brief Process CPU utilization (0 - 1 of all cores) above which pool doesn't grow, more threads only add contention
+			 */
+			double maxCpuUtilization = 0.85;
+		};
+
+		struct SizingStatistics
+		{
+			size_t numberOfWorkers;
+			size_t minWorkers;
+			size_t maxWorkers;
+			uint64_t grows;
+			uint64_t shrinks;
+
+			/**
+			 * @brief Last sample, 0 - 1 of all cores
+			 */
+			double cpuUtilization;
+
+			/**
+			 * @brief Last sample, fraction of time workers ran tasks
+			 */
+			double workerUtilization;
+
+			/**
+			 * @brief Last sample
+			 */
+			std::chrono::microseconds averageTaskLatency;
+		};
+
+	private:
+		/// @brief Ring buffer of tasks guarded by its own mutex. Owner and thieves take oldest tasks
+		class TaskQueue
+		{
+		private:
+			std::vector<Task> tasks;
+			size_t head;
+			size_t count;
+			mutable std::mutex queueMutex;
+
+		private:
+			void grow();
+
+		public:
+			TaskQueue();
+
+			void push(Task&& task);
+
+			bool pop(Task& task);
+
+			bool steal(Task& task);
+
+			size_t size() const;
+
+			~TaskQueue() = default;
+		};
+
+		struct Worker
+		{
+			TaskQueue queue;
+			std::thread thread;
+			std::atomic<uint64_t> executedTasks;
+			std::atomic<uint64_t> stolenTasks;
+
+			/**
+			 * @brief Worker thread is started and didn't retire
+			 */
+			std::atomic<bool> running;
+
+			Worker();
+		};
+
+	private:
+		/**
+		 * @brief maxWorkers slots allocated once, so workers are never moved while other threads use them
+		 */
+		std::vector<std::unique_ptr<Worker>> workers;
+
+		/**
+		 * @brief Current size. Workers with index above it retire after draining their queues
+		 */
+		std::atomic<size_t> numberOfWorkers;
+
+		/**
+		 * @brief Number of slots that ever had thread, tasks added by retiring worker are stolen from these slots
+		 */
+		std::atomic<size_t> numberOfUsedSlots;
+
+		std::atomic<size_t> nextWorker;
+		std::atomic<uint32_t> epoch;
+		std::atomic<bool> isRunning;
+		SizingOptions sizingOptions;
+		bool adaptive;
+		std::atomic<size_t> busyWorkers;
+		std::atomic<uint64_t> taskNanoseconds;
+		std::thread sizingThread;
+		mutable std::mutex sizingMutex;
+		std::condition_variable sizingCondition;
+		SizingStatistics sizingStatistics;
+
+	private:
+		void workerThread(size_t index);
+
+		bool findTask(size_t index, Task& task);
+
+		void startWorker(size_t index);
+
+		/**
+		 * @brief Sample load every interval and change number of workers
+		 */
+		void sizingLoop();
+
+		void resize(size_t size);
+
+	public:
+		/**
+		 * @brief Start worker threads
+		 * @param numberOfWorkers Number of worker threads, 0 for std::thread::hardware_concurrency
+		 */
+		WorkStealingThreadPool(size_t numberOfWorkers = 0);
+
+		/**
+		 * @brief Start minWorkers worker threads and sizing thread that keeps number of workers between minWorkers and maxWorkers
+		 * @param options
+		 * @exception std::runtime_error Wrong bounds
+		 */
+		WorkStealingThreadPool(const SizingOptions& options);
+
+		WorkStealingThreadPool(const WorkStealingThreadPool&) = delete;
+
+		WorkStealingThreadPool& operator = (const WorkStealingThreadPool&) = delete;
+
+		/**
+		 * @brief Add task to the calling worker's queue or distribute it between workers if called outside of the pool
+		 * @param task
+		 */
+		void addTask(Task&& task);
+
+		/**
+		 * @brief Current number of worker threads
+		 * @return
+		 */
+		size_t getNumberOfWorkers() const;
+
+		/**
+		 * @brief Number of tasks waiting in all queues
+		 * @return
+		 */
+		size_t getNumberOfPendingTasks() const;
+
+		/**
+		 * @brief Get queue depth, executed and stolen tasks for each worker
+		 * @return
+		 */
+		std::vector<WorkerStatistics> getWorkersStatistics() const;
+
+		/**
+		 * @brief Get current size, bounds, number of resizes and last load sample. Fixed size pool reports only size and bounds
+		 * @return
+		 */
+		SizingStatistics getSizingStatistics() const;
+
+		/**
+		 * @brief Execute remaining tasks and join workers
+		 */
+		~WorkStealingThreadPool();
+	};
+}
@@ -0,0 +1,487 @@
+#include "BaseTCPClient.h"
+
+#include <algorithm>
+
+#ifdef __LINUX__
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#endif
+
+static int getLastError()
+{
+#ifdef __LINUX__
+	return errno;
+#else
+	return WSAGetLastError();
+#endif
+}
+
+static void setLastError(int error)
+{
+#ifdef __LINUX__
+	errno = error;
+#else
+	WSASetLastError(error);
+#endif
+}
+
+static bool setBlocking(SOCKET clientSocket, bool block)
+{
+#ifdef __LINUX__
+	int flags = fcntl(clientSocket, F_GETFL);
+
+	return flags != SOCKET_ERROR && fcntl(clientSocket, F_SETFL, block ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) != SOCKET_ERROR;
+#else
+	u_long mode = !block;
+
+	return ioctlsocket(clientSocket, FIONBIO, &mode) != SOCKET_ERROR;
+#endif
+}
+
+static bool connectBefore(SOCKET clientSocket, const addrinfo* address, std::chrono::steady_clock::time_point deadline)
+{
+	if (!setBlocking(clientSocket, false))
+	{
+		return false;
+	}
+
+	if (connect(clientSocket, address->ai_addr, static_cast<int>(address->ai_addrlen)) == SOCKET_ERROR)
+	{
+#ifdef __LINUX__
+		if (errno != EINPROGRESS)
+		{
+			return false;
+		}
+
+		pollfd descriptor = { clientSocket, POLLOUT, 0 };
+#else
+		if (WSAGetLastError() != WSAEWOULDBLOCK)
+		{
+			return false;
+		}
+
+		WSAPOLLFD descriptor = { clientSocket, POLLWRNORM, 0 };
+#endif
+		int result;
+
+		do
+		{
+			int timeout = static_cast<int>(std::max<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count(), 0));
+
+#ifdef __LINUX__
+			result = poll(&descriptor, 1, timeout);
+		} while (result == SOCKET_ERROR && errno == EINTR);
+#else
+			result = WSAPoll(&descriptor, 1, timeout);
+		} while (false);
+#endif
+
+		if (result == SOCKET_ERROR)
+		{
+			return false;
+		}
+		else if (!result)
+		{
+#ifdef __LINUX__
+			setLastError(ETIMEDOUT);
+#else
+			setLastError(WSAETIMEDOUT);
+#endif
+
+			return false;
+		}
+
+		int error = 0;
+#ifdef __LINUX__
+		socklen_t length = sizeof(error);
+#else
+		int length = sizeof(error);
+#endif
+
+		if (getsockopt(clientSocket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length) == SOCKET_ERROR)
+		{
+			return false;
+		}
+
+		if (error)
+		{
+			setLastError(error);
+
+			return false;
+		}
+	}
+
+	int yes = 1;
+
+	setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&yes), sizeof(yes));
+
+	return setBlocking(clientSocket, true);
+}
+
+namespace web
+{
+	BaseTCPClient::Connection::Connection(BaseTCPClient* client, std::string&& key, SOCKET clientSocket, bool reused) :
+		client(client),
+		key(std::move(key)),
+		clientSocket(clientSocket),
+		reused(reused),
+		broken(false)
+	{
+
+	}
+
+	BaseTCPClient::Connection::Connection(Connection&& other) noexcept :
+		client(other.client),
+		key(std::move(other.key)),
+		clientSocket(other.clientSocket),
+		reused(other.reused),
+		broken(other.broken)
+	{
+		other.clientSocket = INVALID_SOCKET;
+	}
+
+	BaseTCPClient::Connection& BaseTCPClient::Connection::operator = (Connection&& other) noexcept
+	{
+		if (this != &other)
+		{
+			this->release();
+
+			client = other.client;
+			key = std::move(other.key);
+			clientSocket = other.clientSocket;
+			reused = other.reused;
+			broken = other.broken;
+
+			other.clientSocket = INVALID_SOCKET;
+		}
+
+		return *this;
+	}
+
+	void BaseTCPClient::Connection::markBroken()
+	{
+		broken = true;
+	}
+
+	void BaseTCPClient::Connection::release()
+	{
+		if (clientSocket == INVALID_SOCKET)
+		{
+			return;
+		}
+
+		if (broken)
+		{
+			closesocket(clientSocket);
+		}
+		else
+		{
+			client->release(key, clientSocket);
+		}
+
+		clientSocket = INVALID_SOCKET;
+	}
+
+	bool BaseTCPClient::Connection::isReused() const
+	{
+		return reused;
+	}
+
+	bool BaseTCPClient::Connection::isBroken() const
+	{
+		return broken;
+	}
+
+	SOCKET BaseTCPClient::Connection::getSocket() const
+	{
+		return clientSocket;
+	}
+
+	BaseTCPClient::Connection::~Connection()
+	{
+		this->release();
+	}
+
+	std::string BaseTCPClient::makeKey(std::string_view host, std::string_view port)
+	{
+		std::string result;
+
+		result.reserve(host.size() + port.size() + 1);
+
+		result.append(host).append(":").append(port);
+
+		return result;
+	}
+
+	void BaseTCPClient::release(const std::string& key, SOCKET clientSocket)
+	{
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			std::vector<IdleConnection>& connections = idleConnections[key];
+
+			if (connections.size() < maxIdleConnectionsPerKey)
+			{
+				connections.push_back({ clientSocket, std::chrono::steady_clock::now() });
+
+				return;
+			}
+		}
+
+		closesocket(clientSocket);
+	}
+
+	SOCKET BaseTCPClient::connect(std::string_view host, std::string_view port, std::chrono::milliseconds timeout)
+	{
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+		std::string hostName(host);
+		std::string portName(port);
+		addrinfo* info = nullptr;
+		addrinfo hints = {};
+		SOCKET result = INVALID_SOCKET;
+		int error = 0;
+
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_protocol = IPPROTO_TCP;
+		hints.ai_socktype = SOCK_STREAM;
+
+		if (getaddrinfo(hostName.data(), portName.data(), &hints, &info))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		for (addrinfo* current = info; current && result == INVALID_SOCKET; current = current->ai_next)
+		{
+			SOCKET clientSocket = socket(current->ai_family, current->ai_socktype, current->ai_protocol);
+
+			if (clientSocket == INVALID_SOCKET)
+			{
+				error = getLastError();
+
+				continue;
+			}
+
+			if (connectBefore(clientSocket, current, deadline))
+			{
+				result = clientSocket;
+			}
+			else
+			{
+				error = getLastError();
+
+				closesocket(clientSocket);
+			}
+		}
+
+		freeaddrinfo(info);
+
+		if (result == INVALID_SOCKET)
+		{
+			setLastError(error);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		return result;
+	}
+
+	bool BaseTCPClient::isAlive(SOCKET clientSocket)
+	{
+		// Idle connection must not be readable: readable means peer closed connection or sent unexpected data
+#ifdef __LINUX__
+		pollfd descriptor = { clientSocket, POLLIN, 0 };
+
+		return !poll(&descriptor, 1, 0);
+#else
+		WSAPOLLFD descriptor = { clientSocket, POLLRDNORM, 0 };
+
+		return !WSAPoll(&descriptor, 1, 0);
+#endif
+	}
+
+	BaseTCPClient::BaseTCPClient(size_t maxIdleConnectionsPerKey, std::chrono::milliseconds idleTimeout, std::chrono::milliseconds connectTimeout) :
+		maxIdleConnectionsPerKey(maxIdleConnectionsPerKey),
+		idleTimeout(idleTimeout),
+		connectTimeout(connectTimeout),
+		healthCheck(&BaseTCPClient::isAlive),
+		statistics()
+	{
+#ifndef __LINUX__
+		WSADATA wsaData;
+
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+	}
+
+	BaseTCPClient::Connection BaseTCPClient::acquire(std::string_view host, std::string_view port)
+	{
+		std::string key = BaseTCPClient::makeKey(host, port);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::function<bool(SOCKET)> check;
+		SOCKET clientSocket = INVALID_SOCKET;
+
+		// Most recently released connection is the most likely to be alive. Connection is taken under lock and checked without it
+		while (true)
+		{
+			IdleConnection connection;
+			bool expired;
+
+			{
+				std::lock_guard<std::mutex> lock(poolMutex);
+				auto it = idleConnections.find(key);
+
+				if (it == idleConnections.end() || it->second.empty())
+				{
+					break;
+				}
+
+				connection = it->second.back();
+
+				it->second.pop_back();
+
+				expired = now - connection.releaseTime > idleTimeout;
+
+				if (expired)
+				{
+					statistics.expiredConnections++;
+				}
+				else
+				{
+					check = healthCheck;
+				}
+			}
+
+			if (expired)
+			{
+				closesocket(connection.clientSocket);
+
+				continue;
+			}
+
+			if (check && !check(connection.clientSocket))
+			{
+				closesocket(connection.clientSocket);
+
+				std::lock_guard<std::mutex> lock(poolMutex);
+
+				statistics.failedHealthChecks++;
+
+				continue;
+			}
+
+			clientSocket = connection.clientSocket;
+
+			std::lock_guard<std::mutex> lock(poolMutex);
+
+			statistics.reusedConnections++;
+
+			break;
+		}
+
+		if (clientSocket != INVALID_SOCKET)
+		{
+			return Connection(this, std::move(key), clientSocket, true);
+		}
+
+		clientSocket = BaseTCPClient::connect(host, port, connectTimeout);
+
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+
+			statistics.createdConnections++;
+		}
+
+		return Connection(this, std::move(key), clientSocket, false);
+	}
+
+	void BaseTCPClient::setHealthCheck(const std::function<bool(SOCKET)>& healthCheck)
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+
+		this->healthCheck = healthCheck;
+	}
+
+	void BaseTCPClient::closeExpired()
+	{
+		std::vector<SOCKET> closeSockets;
+
+		{
+			std::lock_guard<std::mutex> lock(poolMutex);
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+			for (auto& [key, connections] : idleConnections)
+			{
+				std::erase_if
+				(
+					connections,
+					[this, now, &closeSockets](const IdleConnection& connection)
+					{
+						if (now - connection.releaseTime > idleTimeout)
+						{
+							closeSockets.push_back(connection.clientSocket);
+
+							return true;
+						}
+
+						return false;
+					}
+				);
+			}
+
+			statistics.expiredConnections += closeSockets.size();
+		}
+
+		for (SOCKET socket : closeSockets)
+		{
+			closesocket(socket);
+		}
+	}
+
+	size_t BaseTCPClient::getNumberOfIdleConnections() const
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		size_t result = 0;
+
+		for (const auto& [key, connections] : idleConnections)
+		{
+			result += connections.size();
+		}
+
+		return result;
+	}
+
+	BaseTCPClient::Statistics BaseTCPClient::getStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+
+		return statistics;
+	}
+
+	void BaseTCPClient::clear()
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+
+		for (const auto& [key, connections] : idleConnections)
+		{
+			for (const IdleConnection& connection : connections)
+			{
+				closesocket(connection.clientSocket);
+			}
+		}
+
+		idleConnections.clear();
+	}
+
+	BaseTCPClient::~BaseTCPClient()
+	{
+		this->clear();
+
+#ifndef __LINUX__
+		WSACleanup();
+#endif
+	}
+}
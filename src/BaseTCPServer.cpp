@@ -1,471 +1,2606 @@
 #include "BaseTCPServer.h"
 
 #include <iostream>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <sstream>
+#include <utility>
 
 #ifdef __LINUX__
 #include <fcntl.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <cstring>
+#include <netinet/tcp.h>
+#else
+#include <afunix.h>
 #endif
 
 #ifndef __LINUX__
 #pragma comment (lib, "ws2_32.lib")
 #endif
 
-namespace web
+/**
+ * @brief Number of clients processed by one broadcast task
+ */
+static constexpr size_t broadcastBatchSize = 512;
+
+static bool isWouldBlock()
+{
+#ifdef __LINUX__
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
+
+/**
+ * @brief Send without blocking regardless of socket mode. Windows has no per call flag, so socket is switched to non blocking mode for this send
+ * @param clientSocket
+ * @param data
+ * @param size
+ * @param blockingMode Mode restored after send on Windows, 0 for blocking
+ * @return Result of send, error is kept for isWouldBlock
+ */
+static int sendNonBlocking(SOCKET clientSocket, const char* data, int size, [[maybe_unused]] u_long blockingMode)
 {
-	void BaseTCPServer::ClientData::add(const std::string& ip, SOCKET socket)
+#ifdef __LINUX__
+	return send(clientSocket, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+	u_long nonBlockingMode = 1;
+
+	if (ioctlsocket(clientSocket, FIONBIO, &nonBlockingMode) == SOCKET_ERROR)
 	{
-		std::lock_guard<std::mutex> lock(dataMutex);
+		return SOCKET_ERROR;
+	}
+
+	int result = send(clientSocket, data, size, 0);
+	int error = WSAGetLastError();
+
+	if (!blockingMode)
+	{
+		ioctlsocket(clientSocket, FIONBIO, &blockingMode);
+	}
+
+	WSASetLastError(error);
+
+	return result;
+#endif
+}
 
-		data[ip].push_back(socket);
+static int makeUnixAddress(std::string_view path, sockaddr_un& address)
+{
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+	{
+		throw std::runtime_error("Wrong Unix domain socket path");
 	}
 
-	void BaseTCPServer::ClientData::remove(const std::string& ip, SOCKET socket)
+	address.sun_family = AF_UNIX;
+
+	std::copy(path.begin(), path.end(), address.sun_path);
+
+	if (path.front() == '@')
 	{
-		std::lock_guard<std::mutex> lock(dataMutex);
+		address.sun_path[0] = '\0';
+
+		return static_cast<int>(offsetof(sockaddr_un, sun_path) + path.size());
+	}
+
+	return static_cast<int>(offsetof(sockaddr_un, sun_path) + path.size() + 1);
+}
 
-		if (!data.contains(ip))
+#ifdef __LINUX__
+/**
+ * @brief Read listen queue counters from TcpExt lines of /proc/net/netstat, line with names is followed by line with values
+ */
+static void readListenCounters(uint64_t& overflows, uint64_t& drops)
+{
+	std::ifstream netstat("/proc/net/netstat");
+	std::string names;
+	std::string values;
+
+	while (std::getline(netstat, names) && std::getline(netstat, values))
+	{
+		if (!names.starts_with("TcpExt:"))
 		{
-			return;
+			continue;
+		}
+
+		std::istringstream nameStream(names);
+		std::istringstream valueStream(values);
+		std::string name;
+		std::string prefix;
+		uint64_t value;
+
+		nameStream >> name;
+		valueStream >> prefix;
+
+		while (nameStream >> name && valueStream >> value)
+		{
+			if (name == "ListenOverflows")
+			{
+				overflows = value;
+			}
+			else if (name == "ListenDrops")
+			{
+				drops = value;
+			}
 		}
 
-		std::erase(data[ip], socket);
+		break;
 	}
+}
+#endif
 
-	std::vector<SOCKET> BaseTCPServer::ClientData::extract(const std::string& ip)
+/**
+ * @brief Close socket of failed listen socket creation, error code of failed call is kept for exception
+ */
+static void closeFailedSocket(SOCKET socket)
+{
+#ifdef __LINUX__
+	int error = errno;
+
+	closesocket(socket);
+
+	errno = error;
+#else
+	int error = WSAGetLastError();
+
+	closesocket(socket);
+
+	WSASetLastError(error);
+#endif
+}
+
+/**
+ * @brief Delete socket file of unix:<path> listener, abstract namespace has no file
+ */
+static void removeUnixSocketFile(std::string_view ip, std::string_view prefix)
+{
+	if (!ip.starts_with(prefix) || ip.size() <= prefix.size() || ip[prefix.size()] == '@')
 	{
-		std::lock_guard<std::mutex> lock(dataMutex);
-		std::vector<SOCKET> result;
+		return;
+	}
+
+	std::string path(ip.substr(prefix.size()));
 
-		if (auto node = data.extract(ip))
+#ifdef __LINUX__
+	unlink(path.data());
+#else
+	DeleteFileA(path.data());
+#endif
+}
+
+namespace web
+{
+	thread_local BaseTCPServer::DispatchedConnection BaseTCPServer::dispatchedConnection = { { BaseTCPServer::ClientData::invalidIndex, 0 }, 0, INVALID_SOCKET };
+
+	size_t BaseTCPServer::ClientData::findSocketPosition(SOCKET socket) const
+	{
+		size_t mask = socketIndex.size() - 1;
+		size_t position = (static_cast<uint64_t>(socket) * 0x9E3779B97F4A7C15ULL >> 32) & mask;
+
+		while (socketIndex[position] && connections[socketIndex[position] - 1].socket != socket)
 		{
-			result = move(node.mapped());
+			position = (position + 1) & mask;
 		}
 
-		return result;
+		return position;
 	}
 
-	void BaseTCPServer::ClientData::clear()
+	void BaseTCPServer::ClientData::insertSocket(SOCKET socket, uint32_t index)
 	{
-		std::lock_guard<std::mutex> lock(dataMutex);
+		if ((numberOfConnections + 1) * 2 > socketIndex.size())
+		{
+			this->rehash(socketIndex.size() * 2);
+		}
 
-		data.clear();
+		socketIndex[this->findSocketPosition(socket)] = index + 1;
 	}
 
-	std::vector<std::pair<std::string, std::vector<SOCKET>>> BaseTCPServer::ClientData::getClients() const
+	void BaseTCPServer::ClientData::eraseSocket(SOCKET socket)
 	{
-		std::vector<std::pair<std::string, std::vector<SOCKET>>> result;
-		std::lock_guard<std::mutex> lock(dataMutex);
+		size_t mask = socketIndex.size() - 1;
+		size_t position = this->findSocketPosition(socket);
+
+		if (!socketIndex[position])
+		{
+			return;
+		}
 
-		result.reserve(data.size());
+		socketIndex[position] = 0;
 
-		for (const auto& [ip, sockets] : data)
+		// Backward shift deletion keeps probe sequences without tombstones
+		for (size_t next = (position + 1) & mask; socketIndex[next]; next = (next + 1) & mask)
 		{
-			result.emplace_back(ip, sockets);
+			uint32_t index = socketIndex[next];
+
+			socketIndex[next] = 0;
+			socketIndex[this->findSocketPosition(connections[index - 1].socket)] = index;
 		}
+	}
 
-		return result;
+	void BaseTCPServer::ClientData::rehash(size_t capacity)
+	{
+		std::vector<uint32_t> temp(capacity, 0);
+
+		std::swap(socketIndex, temp);
+
+		for (uint32_t index : temp)
+		{
+			if (index)
+			{
+				socketIndex[this->findSocketPosition(connections[index - 1].socket)] = index;
+			}
+		}
 	}
 
-	size_t BaseTCPServer::ClientData::getNumberOfClients() const
+	size_t BaseTCPServer::ClientData::findIpPosition(std::string_view ip) const
 	{
-		std::lock_guard<std::mutex> lock(dataMutex);
+		size_t mask = ipIndex.size() - 1;
+		size_t position = std::hash<std::string_view>()(ip) & mask;
+
+		while (ipIndex[position] && connections[ipIndex[position] - 1].ip != ip)
+		{
+			position = (position + 1) & mask;
+		}
 
-		return data.size();
+		return position;
 	}
 
-	size_t BaseTCPServer::ClientData::getNumberOfConnections() const
+	void BaseTCPServer::ClientData::linkIp(uint32_t index)
 	{
-		size_t result = 0;
+		Connection& connection = connections[index];
+		size_t position = this->findIpPosition(connection.ip);
 
-		std::lock_guard<std::mutex> lock(dataMutex);
+		connection.previousSameIp = ClientData::invalidIndex;
+		connection.nextSameIp = ClientData::invalidIndex;
+
+		if (uint32_t head = ipIndex[position])
+		{
+			connection.nextSameIp = head - 1;
+			connections[head - 1].previousSameIp = index;
+			ipIndex[position] = index + 1;
 
-		for (const auto& [key, value] : data)
+			return;
+		}
+
+		if ((numberOfClients + 1) * 2 > ipIndex.size())
 		{
-			result += value.size();
+			this->rehashIps(ipIndex.size() * 2);
+
+			position = this->findIpPosition(connection.ip);
 		}
 
-		return result;
+		ipIndex[position] = index + 1;
+
+		numberOfClients++;
 	}
 
-	void BaseTCPServer::createListenSocket()
+	void BaseTCPServer::ClientData::unlinkIp(uint32_t index)
 	{
-		addrinfo* info = nullptr;
-		addrinfo hints = {};
+		Connection& connection = connections[index];
 
-		hints.ai_family = AF_INET;
-		hints.ai_flags = AI_PASSIVE;
-		hints.ai_protocol = IPPROTO_TCP;
-		hints.ai_socktype = SOCK_STREAM;
+		if (connection.nextSameIp != ClientData::invalidIndex)
+		{
+			connections[connection.nextSameIp].previousSameIp = connection.previousSameIp;
+		}
 
-		if (getaddrinfo(ip.data(), port.data(), &hints, &info))
+		if (connection.previousSameIp != ClientData::invalidIndex)
 		{
-			THROW_WEB_SERVER_EXCEPTION;
+			connections[connection.previousSameIp].nextSameIp = connection.nextSameIp;
+
+			return;
 		}
 
-		if ((listenSocket = socket(info->ai_family, info->ai_socktype, info->ai_protocol)) == INVALID_SOCKET)
+		size_t position = this->findIpPosition(connection.ip);
+
+		if (connection.nextSameIp != ClientData::invalidIndex)
 		{
-			freeaddrinfo(info);
+			ipIndex[position] = connection.nextSameIp + 1;
 
-			freeDLL = true;
+			return;
+		}
 
-			THROW_WEB_SERVER_EXCEPTION;
+		size_t mask = ipIndex.size() - 1;
+
+		ipIndex[position] = 0;
+
+		for (size_t next = (position + 1) & mask; ipIndex[next]; next = (next + 1) & mask)
+		{
+			uint32_t head = ipIndex[next];
+
+			ipIndex[next] = 0;
+			ipIndex[this->findIpPosition(connections[head - 1].ip)] = head;
 		}
 
-		int yes = 1;
+		numberOfClients--;
+	}
 
-		if (setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes)) == SOCKET_ERROR)
+	void BaseTCPServer::ClientData::rehashIps(size_t capacity)
+	{
+		std::vector<uint32_t> temp(capacity, 0);
+
+		std::swap(ipIndex, temp);
+
+		for (uint32_t head : temp)
 		{
-			freeaddrinfo(info);
+			if (head)
+			{
+				ipIndex[this->findIpPosition(connections[head - 1].ip)] = head;
+			}
+		}
+	}
 
-			freeDLL = true;
+	std::shared_ptr<SendQueue> BaseTCPServer::ClientData::release(uint32_t index)
+	{
+		Connection& connection = connections[index];
 
-			THROW_WEB_SERVER_EXCEPTION;
+		this->eraseSocket(connection.socket);
+		this->unlinkIp(index);
+
+		connection.used = false;
+		connection.socket = INVALID_SOCKET;
+		connection.generation++;
+
+		if (connection.priorityClass < connectionsPerClass.size())
+		{
+			connectionsPerClass[connection.priorityClass]--;
 		}
 
-#ifdef __LINUX__
-		int flags = fcntl(listenSocket, F_GETFL, 0);
+		freeSlots.push_back(index);
 
-		if (flags == -1)
+		numberOfConnections--;
+
+		return std::move(connection.sendQueue);
+	}
+
+	BaseTCPServer::ClientData::ClientData() :
+		socketIndex(64, 0),
+		ipIndex(64, 0),
+		numberOfConnections(0),
+		numberOfClients(0)
+	{
+
+	}
+
+	void BaseTCPServer::ClientData::reserve(size_t numberOfConnections)
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		while (connections.size() < numberOfConnections)
 		{
-			std::cerr << "Can't F_GETFL on listen socket" << std::endl;
+			connections.push_back({ {}, {}, INVALID_SOCKET, 0, 0, 0, ClientData::invalidIndex, ClientData::invalidIndex, false, nullptr });
 
-			flags = 0;
+			freeSlots.push_back(static_cast<uint32_t>(connections.size() - 1));
 		}
 
-		flags = this->isListenSocketInBlockingMode() ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+		freeSlots.reserve(connections.size());
 
-		if (fcntl(listenSocket, F_SETFL, flags) == SOCKET_ERROR)
+		for (Connection& connection : connections)
 		{
-			freeaddrinfo(info);
+			connection.ip.reserve(BaseTCPServer::ipV4Size);
+		}
 
-			freeDLL = true;
+		size_t capacity = socketIndex.size();
 
-			THROW_WEB_SERVER_EXCEPTION;
+		while (capacity < numberOfConnections * 2)
+		{
+			capacity *= 2;
 		}
-#else
-		if (ioctlsocket(listenSocket, FIONBIO, &listenSocketBlockingMode) == SOCKET_ERROR)
+
+		if (capacity != socketIndex.size())
 		{
-			freeaddrinfo(info);
+			this->rehash(capacity);
+		}
 
-			freeDLL = true;
+		if (capacity > ipIndex.size())
+		{
+			this->rehashIps(capacity);
+		}
+	}
 
-			THROW_WEB_SERVER_EXCEPTION;
+	BaseTCPServer::ClientData::Handle BaseTCPServer::ClientData::addConnection(const std::string& ip, SOCKET socket, sockaddr address, uint32_t priorityClass, size_t maxConnections, uint32_t listener)
+	{
+		uint32_t index;
+
+		if (priorityClass >= connectionsPerClass.size())
+		{
+			connectionsPerClass.resize(priorityClass + 1, 0);
 		}
-#endif
 
-		if (bind(listenSocket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == SOCKET_ERROR)
+		if (maxConnections && connectionsPerClass[priorityClass] >= maxConnections)
 		{
-			freeaddrinfo(info);
+			return { ClientData::invalidIndex, 0 };
+		}
 
-			freeDLL = true;
+		if (freeSlots.empty())
+		{
+			connections.push_back({ {}, {}, INVALID_SOCKET, 0, 0, 0, ClientData::invalidIndex, ClientData::invalidIndex, false, nullptr });
 
-			THROW_WEB_SERVER_EXCEPTION;
+			index = static_cast<uint32_t>(connections.size() - 1);
+
+			freeSlots.reserve(connections.capacity());
+		}
+		else
+		{
+			index = freeSlots.back();
+
+			freeSlots.pop_back();
 		}
 
-		if (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR)
+		Connection& connection = connections[index];
+
+		connection.ip = ip;
+		connection.address = address;
+		connection.socket = socket;
+		connection.priorityClass = priorityClass;
+		connection.listener = listener;
+		connection.used = true;
+
+		this->insertSocket(socket, index);
+		this->linkIp(index);
+
+		connectionsPerClass[priorityClass]++;
+		numberOfConnections++;
+
+		return { index, connection.generation };
+	}
+
+	BaseTCPServer::ClientData::Handle BaseTCPServer::ClientData::add(const std::string& ip, SOCKET socket, sockaddr address, uint32_t priorityClass, size_t maxConnections, uint32_t listener)
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		return this->addConnection(ip, socket, address, priorityClass, maxConnections, listener);
+	}
+
+	void BaseTCPServer::ClientData::add(std::vector<Registration>& registrations)
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		for (Registration& registration : registrations)
 		{
-			freeaddrinfo(info);
+			registration.handle = this->addConnection(registration.ip, registration.socket, registration.address, registration.priorityClass, registration.maxConnections, registration.listener);
+		}
+	}
 
-			freeDLL = true;
+	SOCKET BaseTCPServer::ClientData::remove(Handle handle)
+	{
+		std::shared_ptr<SendQueue> sendQueue;
+		SOCKET result = this->remove(handle, sendQueue);
 
-			THROW_WEB_SERVER_EXCEPTION;
+		if (sendQueue)
+		{
+			sendQueue->cancel();
 		}
 
-		freeaddrinfo(info);
+		return result;
 	}
 
-	void BaseTCPServer::receiveConnections(const std::function<void()>& onStartServer, std::exception** outException)
+	SOCKET BaseTCPServer::ClientData::remove(Handle handle, std::shared_ptr<SendQueue>& sendQueue)
 	{
-		try
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		if (handle.index >= connections.size() || !connections[handle.index].used || connections[handle.index].generation != handle.generation)
 		{
-#ifdef __LINUX__
-			socklen_t addrlen = sizeof(sockaddr);
-#else
-			int addrlen = sizeof(sockaddr);
-#endif
-			if (onStartServer)
+			return INVALID_SOCKET;
+		}
+
+		SOCKET result = connections[handle.index].socket;
+
+		sendQueue = this->release(handle.index);
+
+		return result;
+	}
+
+	void BaseTCPServer::ClientData::remove(const std::string& ip, SOCKET socket)
+	{
+		std::shared_ptr<SendQueue> sendQueue;
+
+		{
+			std::lock_guard<std::mutex> lock(dataMutex);
+
+			if (uint32_t index = socketIndex[this->findSocketPosition(socket)]; index && connections[index - 1].ip == ip)
 			{
-				onStartServer();
+				sendQueue = this->release(index - 1);
 			}
+		}
 
-			while (isRunning)
-			{
-				sockaddr address;
-				SOCKET clientSocket = accept(listenSocket, &address, &addrlen);
+		if (sendQueue)
+		{
+			sendQueue->cancel();
+		}
+	}
 
-#ifdef __LINUX__
-				timeval timeoutValue;
+	BaseTCPServer::ClientData::Handle BaseTCPServer::ClientData::find(SOCKET socket) const
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
 
-				timeoutValue.tv_sec = timeout / 1000;
-				timeoutValue.tv_usec = (timeout - timeoutValue.tv_sec * 1000) * 1000;
-#else
-				DWORD timeoutValue = timeout;
-#endif
+		if (uint32_t index = socketIndex[this->findSocketPosition(socket)])
+		{
+			return { index - 1, connections[index - 1].generation };
+		}
 
-				if (isRunning && clientSocket != INVALID_SOCKET)
-				{
-					if (setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeoutValue), sizeof(timeoutValue)) == SOCKET_ERROR)
-					{
-						THROW_WEB_SERVER_EXCEPTION;
+		return { ClientData::invalidIndex, 0 };
+	}
+
+	bool BaseTCPServer::ClientData::get(Handle handle, std::string& ip, SOCKET& socket, sockaddr& address, uint32_t& listener) const
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		if (handle.index >= connections.size() || !connections[handle.index].used || connections[handle.index].generation != handle.generation)
+		{
+			return false;
+		}
+
+		const Connection& connection = connections[handle.index];
+
+		ip = connection.ip;
+		socket = connection.socket;
+		address = connection.address;
+		listener = connection.listener;
+
+		return true;
+	}
+
+	std::vector<SOCKET> BaseTCPServer::ClientData::extract(const std::string& ip)
+	{
+		std::vector<SOCKET> result;
+		std::vector<std::shared_ptr<SendQueue>> sendQueues;
+
+		{
+			std::lock_guard<std::mutex> lock(dataMutex);
+			uint32_t head = ipIndex[this->findIpPosition(ip)];
+
+			for (uint32_t index = head ? head - 1 : ClientData::invalidIndex; index != ClientData::invalidIndex;)
+			{
+				uint32_t next = connections[index].nextSameIp;
+
+				result.push_back(connections[index].socket);
+
+				if (std::shared_ptr<SendQueue> sendQueue = this->release(index))
+				{
+					sendQueues.push_back(std::move(sendQueue));
+				}
+
+				index = next;
+			}
+		}
+
+		for (const std::shared_ptr<SendQueue>& sendQueue : sendQueues)
+		{
+			sendQueue->cancel();
+		}
+
+		return result;
+	}
+
+	std::vector<SOCKET> BaseTCPServer::ClientData::clear()
+	{
+		std::vector<SOCKET> result;
+		std::vector<std::shared_ptr<SendQueue>> sendQueues;
+
+		{
+			std::lock_guard<std::mutex> lock(dataMutex);
+
+			for (uint32_t index = 0; index < connections.size(); index++)
+			{
+				if (!connections[index].used)
+				{
+					continue;
+				}
+
+				result.push_back(connections[index].socket);
+
+				if (std::shared_ptr<SendQueue> sendQueue = this->release(index))
+				{
+					sendQueues.push_back(std::move(sendQueue));
+				}
+			}
+		}
+
+		for (const std::shared_ptr<SendQueue>& sendQueue : sendQueues)
+		{
+			sendQueue->cancel();
+		}
+
+		return result;
+	}
+
+	std::vector<std::pair<std::string, std::vector<SOCKET>>> BaseTCPServer::ClientData::getClients() const
+	{
+		std::vector<std::pair<std::string, std::vector<SOCKET>>> result;
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		result.reserve(numberOfClients);
+
+		for (uint32_t head : ipIndex)
+		{
+			if (!head)
+			{
+				continue;
+			}
+
+			auto& [ip, sockets] = result.emplace_back(connections[head - 1].ip, std::vector<SOCKET>());
+
+			for (uint32_t index = head - 1; index != ClientData::invalidIndex; index = connections[index].nextSameIp)
+			{
+				sockets.push_back(connections[index].socket);
+			}
+		}
+
+		return result;
+	}
+
+	std::shared_ptr<SendQueue> BaseTCPServer::ClientData::attachSendQueue(SOCKET socket, std::shared_ptr<SendQueue>&& queue)
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		if (uint32_t index = socketIndex[this->findSocketPosition(socket)])
+		{
+			std::shared_ptr<SendQueue>& sendQueue = connections[index - 1].sendQueue;
+
+			if (!sendQueue)
+			{
+				sendQueue = std::move(queue);
+			}
+
+			return sendQueue;
+		}
+
+		return queue;
+	}
+
+	void BaseTCPServer::ClientData::getSockets(std::vector<std::pair<SOCKET, std::shared_ptr<SendQueue>>>& sockets) const
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		sockets.clear();
+		sockets.reserve(numberOfConnections);
+
+		for (const Connection& connection : connections)
+		{
+			if (connection.used)
+			{
+				sockets.emplace_back(connection.socket, connection.sendQueue);
+			}
+		}
+	}
+
+	size_t BaseTCPServer::ClientData::getNumberOfClients() const
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		return numberOfClients;
+	}
+
+	size_t BaseTCPServer::ClientData::getNumberOfConnections() const
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		return numberOfConnections;
+	}
+
+	size_t BaseTCPServer::ClientData::getNumberOfConnections(uint32_t priorityClass) const
+	{
+		std::lock_guard<std::mutex> lock(dataMutex);
+
+		return priorityClass < connectionsPerClass.size() ? connectionsPerClass[priorityClass] : 0;
+	}
+
+	SOCKET BaseTCPServer::createUnixListenSocket(std::string_view ip)
+	{
+		std::string_view path = ip.substr(BaseTCPServer::unixSocketPrefix.size());
+		sockaddr_un address = {};
+		SOCKET listenSocket;
+		int addressLength = makeUnixAddress(path, address);
+
+		if (path.front() != '@')
+		{
+#ifdef __LINUX__
+			unlink(address.sun_path);
+#else
+			DeleteFileA(address.sun_path);
+#endif
+		}
+
+		if ((listenSocket = socket(AF_UNIX, SOCK_STREAM, 0)) == INVALID_SOCKET)
+		{
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (bind(listenSocket, reinterpret_cast<const sockaddr*>(&address), addressLength) == SOCKET_ERROR)
+		{
+			closeFailedSocket(listenSocket);
+
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR)
+		{
+			closeFailedSocket(listenSocket);
+
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		try
+		{
+			this->applyListenSocketBlockingMode(listenSocket);
+		}
+		catch (...)
+		{
+			closesocket(listenSocket);
+
+			throw;
+		}
+
+		return listenSocket;
+	}
+
+	void BaseTCPServer::applyListenSocketBlockingMode(SOCKET listenSocket)
+	{
+#ifdef __LINUX__
+		int flags = fcntl(listenSocket, F_GETFL, 0);
+
+		if (flags == -1)
+		{
+			std::cerr << "Can't F_GETFL on listen socket" << std::endl;
+
+			flags = 0;
+		}
+
+		// Listen socket is always non blocking on Linux, blocking mode is emulated in waitConnection so stop can interrupt waiting
+		if (fcntl(listenSocket, F_SETFL, flags | O_NONBLOCK) == SOCKET_ERROR)
+		{
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#else
+		if (ioctlsocket(listenSocket, FIONBIO, &listenSocketBlockingMode) == SOCKET_ERROR)
+		{
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+	}
+
+	bool BaseTCPServer::waitConnection(std::vector<pollfd>& descriptors)
+	{
+#ifdef __LINUX__
+		if (poll(descriptors.data(), descriptors.size(), this->isListenSocketInBlockingMode() ? -1 : 0) == SOCKET_ERROR)
+		{
+			if (errno == EINTR)
+			{
+				return false;
+			}
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		// Wakeup descriptor is last
+		if (descriptors.back().revents)
+		{
+			uint64_t value;
+
+			if (read(wakeupDescriptor, &value, sizeof(value)) == SOCKET_ERROR && errno != EAGAIN)
+			{
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+
+			return false;
+		}
+#else
+		if (descriptors.size() == 1)
+		{
+			// Single listen socket is waited by accept itself
+			descriptors.front().revents = POLLRDNORM;
+
+			return true;
+		}
+
+		// Closed listen sockets don't always interrupt WSAPoll, so stop is checked periodically
+		if (WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), this->isListenSocketInBlockingMode() ? BaseTCPServer::listenersPollTimeout : 0) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+
+		return true;
+	}
+
+	SOCKET BaseTCPServer::openListenSocket(std::string_view ip, std::string_view port)
+	{
+		if (ip.starts_with(BaseTCPServer::unixSocketPrefix))
+		{
+			return this->createUnixListenSocket(ip);
+		}
+
+		std::string host(ip);
+		std::string service(port);
+		addrinfo* info = nullptr;
+		SOCKET listenSocket;
+		addrinfo hints = {};
+
+		hints.ai_family = AF_INET;
+		hints.ai_flags = AI_PASSIVE;
+		hints.ai_protocol = IPPROTO_TCP;
+		hints.ai_socktype = SOCK_STREAM;
+
+		if (getaddrinfo(host.data(), service.data(), &hints, &info))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if ((listenSocket = socket(info->ai_family, info->ai_socktype, info->ai_protocol)) == INVALID_SOCKET)
+		{
+			freeaddrinfo(info);
+
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		int yes = 1;
+
+		if (setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes)) == SOCKET_ERROR)
+		{
+			freeaddrinfo(info);
+
+			closeFailedSocket(listenSocket);
+
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (bind(listenSocket, info->ai_addr, static_cast<int>(info->ai_addrlen)) == SOCKET_ERROR)
+		{
+			freeaddrinfo(info);
+
+			closeFailedSocket(listenSocket);
+
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (listen(listenSocket, SOMAXCONN) == SOCKET_ERROR)
+		{
+			freeaddrinfo(info);
+
+			closeFailedSocket(listenSocket);
+
+			freeDLL = true;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		freeaddrinfo(info);
+
+		try
+		{
+			this->applyListenSocketBlockingMode(listenSocket);
+		}
+		catch (...)
+		{
+			closesocket(listenSocket);
+
+			throw;
+		}
+
+		return listenSocket;
+	}
+
+	void BaseTCPServer::createListenSocket()
+	{
+		listenSocket = this->openListenSocket(ip, port);
+	}
+
+	BaseTCPServer::AcceptBatchOwner::AcceptBatchOwner(BaseTCPServer& server) :
+		server(server)
+	{
+
+	}
+
+	BaseTCPServer::AcceptBatchOwner::~AcceptBatchOwner()
+	{
+		for (ClientData::Registration& connection : server.acceptBatch)
+		{
+			if (connection.socket == INVALID_SOCKET)
+			{
+				continue;
+			}
+
+			try
+			{
+				server.dropAcceptedConnection(connection);
+			}
+			catch (...)
+			{
+				// Registration is already removed, only socket is left
+				if (connection.socket != INVALID_SOCKET)
+				{
+					closesocket(connection.socket);
+
+					connection.socket = INVALID_SOCKET;
+				}
+			}
+		}
+	}
+
+	void BaseTCPServer::acceptConnections(size_t listenerIndex, SOCKET listenSocket, bool unixSocket)
+	{
+		size_t budget = acceptBatchSize;
+
+#ifndef __LINUX__
+		// Blocking accept waits for next connection instead of reporting empty queue
+		if (this->isListenSocketInBlockingMode())
+		{
+			budget = 1;
+		}
+#endif
+
+		acceptBatch.clear();
+
+		// Accepted socket is stored without reallocation, so it's owned by batch right after accept
+		acceptBatch.reserve(budget);
+
+		AcceptBatchOwner owner(*this);
+
+		// Queue is drained first, so backlog is emptied before per socket setup
+		for (size_t i = 0; i < budget && isRunning; i++)
+		{
+			sockaddr address = {};
+#ifdef __LINUX__
+			socklen_t addrlen = sizeof(sockaddr);
+#else
+			int addrlen = sizeof(sockaddr);
+#endif
+			SOCKET clientSocket = accept(listenSocket, &address, &addrlen);
+
+			if (clientSocket == INVALID_SOCKET)
+			{
+#ifdef __LINUX__
+				if (this->isListenSocketInBlockingMode() && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNABORTED))
+				{
+					// Connection was taken by another process sharing listen socket or aborted by peer
+					break;
+				}
+#endif
+
+				// Empty queue after accepted connections isn't reported
+				if (!i || !isWouldBlock())
+				{
+					this->onInvalidConnectionReceive();
+				}
+
+				break;
+			}
+
+			if (!isRunning)
+			{
+				closesocket(clientSocket);
+
+				this->onInvalidConnectionReceive();
+
+				break;
+			}
+
+			ClientData::Registration& connection = acceptBatch.emplace_back(ClientData::Registration{ {}, address, clientSocket, 0, 0, static_cast<uint32_t>(listenerIndex), { ClientData::invalidIndex, 0 } });
+
+			try
+			{
+				ConnectionTracer::record(ConnectionTracer::EventType::accepted, clientSocket, address);
+
+				// Filter is checked before any other work, so denied peers cost only accept and close
+				if (std::shared_ptr<const IpFilter> filter = ipFilter.load(std::memory_order_acquire); filter && address.sa_family == AF_INET)
+				{
+					if (!filter->isAllowed(ntohl(reinterpret_cast<const sockaddr_in&>(address).sin_addr.s_addr)))
+					{
+						filteredConnections.fetch_add(1, std::memory_order_relaxed);
+
+						this->onConnectionRejected(clientSocket, address);
+
+						this->dropAcceptedConnection(connection);
+					}
+				}
+			}
+			catch (const std::exception&)
+			{
+				this->dropAcceptedConnection(connection);
+			}
+		}
+
+		std::erase_if(acceptBatch, [](const ClientData::Registration& connection) { return connection.socket == INVALID_SOCKET; });
+
+		if (acceptBatch.empty())
+		{
+			return;
+		}
+
+		numberOfAcceptBatches.fetch_add(1, std::memory_order_relaxed);
+		numberOfAcceptedConnections.fetch_add(acceptBatch.size(), std::memory_order_relaxed);
+
+		if (acceptBatch.size() > largestAcceptBatch.load(std::memory_order_relaxed))
+		{
+			largestAcceptBatch.store(acceptBatch.size(), std::memory_order_relaxed);
+		}
+
+		for (ClientData::Registration& connection : acceptBatch)
+		{
+			try
+			{
+				this->setupAcceptedConnection(connection, unixSocket);
+			}
+			catch (const std::exception&)
+			{
+				// Peer disconnected before setup finished, other connections of batch are served
+				this->dropAcceptedConnection(connection);
+			}
+		}
+
+		std::erase_if(acceptBatch, [](const ClientData::Registration& connection) { return connection.socket == INVALID_SOCKET; });
+
+		data.add(acceptBatch);
+
+		for (ClientData::Registration& connection : acceptBatch)
+		{
+			SOCKET clientSocket = connection.socket;
+			ClientData::Handle handle = connection.handle;
+
+			if (handle.index == ClientData::invalidIndex)
+			{
+				priorityClassCounters[connection.priorityClass].rejected.fetch_add(1, std::memory_order_relaxed);
+
+				try
+				{
+					this->onConnectionRejected(clientSocket, connection.address);
+				}
+				catch (const std::exception&)
+				{
+
+				}
+
+				this->dropAcceptedConnection(connection);
+
+				continue;
+			}
+
+			if (priorityClassCounters)
+			{
+				priorityClassCounters[connection.priorityClass].accepted.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			ConnectionTracer::record(ConnectionTracer::EventType::dispatched, clientSocket, connection.address);
+
+			if (multiThreading)
+			{
+				try
+				{
+					if (threadPool && pendingConnections)
+					{
+						// Task doesn't own connection, each task serves whichever pending connection is next in weighted order
+						pendingConnections->push(connection.priorityClass, ClientData::Handle(handle));
+
+						try
+						{
+							threadPool->addTask([this]() { this->servePendingConnection(); });
+						}
+						catch (const std::exception&)
+						{
+							// Handle taken by task of other connection is already served, otherwise it's removed so queue keeps one handle per task
+							if (!pendingConnections->remove(connection.priorityClass, handle))
+							{
+								connection.socket = INVALID_SOCKET;
+
+								continue;
+							}
+
+							throw;
+						}
+					}
+					else if (threadPool)
+					{
+						// Capture only handle so task fits into std::function small buffer
+						threadPool->addTask([this, handle]() { this->serveConnection(handle); });
+					}
+					else
+					{
+						std::thread(&BaseTCPServer::dispatch, this, handle, connection.listener, connection.ip, clientSocket, connection.address).detach();
+					}
+
+					connection.socket = INVALID_SOCKET;
+				}
+				catch (const std::exception&)
+				{
+					// Handler wasn't started, so connection is closed here
+					this->dropAcceptedConnection(connection);
+				}
+			}
+			else
+			{
+				connection.socket = INVALID_SOCKET;
+
+				this->dispatch(handle, connection.listener, connection.ip, clientSocket, connection.address);
+			}
+		}
+	}
+
+	void BaseTCPServer::setupAcceptedConnection(ClientData::Registration& connection, bool unixSocket)
+	{
+		SOCKET clientSocket = connection.socket;
+#ifdef __LINUX__
+		timeval timeoutValue;
+
+		timeoutValue.tv_sec = timeout / 1000;
+		timeoutValue.tv_usec = (timeout - timeoutValue.tv_sec * 1000) * 1000;
+#else
+		DWORD timeoutValue = timeout;
+#endif
+
+		if (setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeoutValue), sizeof(timeoutValue)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutValue), sizeof(timeoutValue)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+#ifdef __LINUX__
+		int flags = fcntl(clientSocket, F_GETFL, 0);
+
+		if (flags == -1)
+		{
+			std::cerr << "Can't F_GETFL on socket" << std::endl;
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		flags = this->isAcceptedSocketsInBlockingMode() ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+
+		if (fcntl(clientSocket, F_SETFL, flags) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#else
+		if (ioctlsocket(clientSocket, FIONBIO, &blockingMode) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+
+		if (unixSocket)
+		{
+			char buffer[BaseTCPServer::ipV4Size] = {};
+			int64_t processId = BaseTCPServer::getPeerCredentials(clientSocket).processId;
+
+			connection.ip = BaseTCPServer::unixSocketPrefix;
+			connection.ip.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), processId).ptr);
+		}
+		else
+		{
+			connection.ip = BaseTCPServer::getClientIpV4(connection.address);
+		}
+
+		if (priorityClassCounters)
+		{
+			connection.priorityClass = this->classifyConnection(connection.ip, clientSocket, connection.address);
+
+			if (connection.priorityClass >= priorityClasses.size())
+			{
+				connection.priorityClass = 0;
+			}
+
+			connection.maxConnections = priorityClasses[connection.priorityClass].maxConnections;
+		}
+	}
+
+	void BaseTCPServer::dropAcceptedConnection(ClientData::Registration& connection)
+	{
+		if (connection.handle.index != ClientData::invalidIndex)
+		{
+			// Registered connection may be already kicked and closed
+			if (data.remove(std::exchange(connection.handle, { ClientData::invalidIndex, 0 })) == INVALID_SOCKET)
+			{
+				connection.socket = INVALID_SOCKET;
+
+				return;
+			}
+		}
+
+		ConnectionTracer::record(ConnectionTracer::EventType::closed, connection.socket, connection.address);
+
+		this->closeClientSocket(std::exchange(connection.socket, INVALID_SOCKET));
+	}
+
+	void BaseTCPServer::receiveConnections(const std::function<void()>& onStartServer, std::exception** outException)
+	{
+		try
+		{
+			std::vector<pollfd> descriptors(additionalListeners.size() + 1);
+
+			acceptBatch.reserve(acceptBatchSize);
+
+			std::vector<bool> unixSockets(descriptors.size());
+
+			for (size_t i = 0; i < unixSockets.size(); i++)
+			{
+				descriptors[i].fd = i ? additionalListeners[i - 1].socket : listenSocket;
+				descriptors[i].events = POLLIN;
+				unixSockets[i] = (i ? std::string_view(additionalListeners[i - 1].ip) : std::string_view(ip)).starts_with(BaseTCPServer::unixSocketPrefix);
+			}
+
+#ifdef __LINUX__
+			descriptors.push_back({ wakeupDescriptor, POLLIN, 0 });
+#endif
+
+			if (onStartServer)
+			{
+				onStartServer();
+			}
+
+			while (isRunning)
+			{
+				if (!this->waitConnection(descriptors))
+				{
+					continue;
+				}
+
+				for (size_t i = 0; i < unixSockets.size() && isRunning; i++)
+				{
+					// Non blocking listen sockets are checked by accept itself
+					if (descriptors[i].revents || !this->isListenSocketInBlockingMode())
+					{
+						this->acceptConnections(i, descriptors[i].fd, unixSockets[i]);
+					}
+				}
+			}
+
+			if (!listenSocketHandedOff && this->getNumberOfConnections())
+			{
+				this->kickAll();
+			}
+		}
+		catch (const std::exception& e)
+		{
+			if (outException)
+			{
+				*outException = new std::runtime_error(e.what());
+			}
+			else
+			{
+				std::cerr << __func__ << " throws exception: " << e.what() << std::endl;
+			}
+		}
+	}
+
+	void BaseTCPServer::serveConnection(ClientData::Handle handle)
+	{
+		std::string ip;
+		SOCKET clientSocket;
+		sockaddr address;
+		uint32_t listener;
+
+		if (data.get(handle, ip, clientSocket, address, listener))
+		{
+			this->dispatch(handle, listener, std::move(ip), clientSocket, address);
+		}
+	}
+
+	void BaseTCPServer::dispatch(ClientData::Handle handle, uint32_t listener, std::string ip, SOCKET clientSocket, sockaddr address)
+	{
+		dispatchedConnection = { handle, listener, clientSocket };
+
+		this->serve(std::move(ip), clientSocket, address);
+	}
+
+	void BaseTCPServer::servePendingConnection()
+	{
+		ClientData::Handle handle;
+
+		if (pendingConnections->pop(handle))
+		{
+			this->serveConnection(handle);
+		}
+	}
+
+	void BaseTCPServer::serveRegistered(ClientData::Handle handle, uint32_t listener, std::string ip, SOCKET clientSocket, sockaddr address)
+	{
+		std::function<void()> cleanup;
+
+		if (handle.index == ClientData::invalidIndex)
+		{
+			cleanup = [this, clientSocket]()
+				{
+					if (this->autoCloseSocket())
+					{
+						ConnectionTracer::record(ConnectionTracer::EventType::closed, clientSocket);
+
+						this->closeClientSocket(clientSocket);
+					}
+				};
+		}
+		else
+		{
+			// Socket is closed only if it's still registered, kicked sockets are already closed. Queued data is sent before close
+			cleanup = [this, handle]()
+				{
+					std::shared_ptr<SendQueue> sendQueue;
+					SOCKET clientSocket = data.remove(handle, sendQueue);
+
+					if (clientSocket == INVALID_SOCKET || !this->autoCloseSocket())
+					{
+						return;
+					}
+
+					auto closeSocket = [this, clientSocket]()
+						{
+							ConnectionTracer::record(ConnectionTracer::EventType::closed, clientSocket);
+
+							this->closeClientSocket(clientSocket);
+						};
+
+					if (sendQueue)
+					{
+						sendQueue->closeAfterFlush(closeSocket);
+					}
+					else
+					{
+						closeSocket();
+					}
+				};
+		}
+
+		this->onConnectionReceive(clientSocket, address);
+
+		ConnectionTracer::record(ConnectionTracer::EventType::handlerStart, clientSocket, address);
+
+		this->onListenerConnection(listener, ip, clientSocket, address, cleanup);
+
+		ConnectionTracer::record(ConnectionTracer::EventType::handlerEnd, clientSocket, address);
+
+		if (static_cast<bool>(cleanup))
+		{
+			cleanup();
+		}
+	}
+
+	void BaseTCPServer::serve(std::string ip, SOCKET clientSocket, sockaddr address)
+	{
+		DispatchedConnection connection = std::exchange(dispatchedConnection, { { ClientData::invalidIndex, 0 }, 0, INVALID_SOCKET });
+
+		// Override may call serve for other socket or from other thread, registration is looked up then
+		if (connection.socket != clientSocket)
+		{
+			std::string registeredIp;
+			SOCKET registeredSocket;
+			sockaddr registeredAddress;
+
+			connection.handle = data.find(clientSocket);
+
+			if (!data.get(connection.handle, registeredIp, registeredSocket, registeredAddress, connection.listener) || registeredIp != ip)
+			{
+				connection.handle = { ClientData::invalidIndex, 0 };
+				connection.listener = 0;
+			}
+		}
+
+		this->serveRegistered(connection.handle, connection.listener, std::move(ip), clientSocket, address);
+	}
+
+	bool BaseTCPServer::takeParkedConnection(SOCKET clientSocket, ParkedConnection& connection)
+	{
+		std::lock_guard<std::mutex> lock(parkedConnectionsMutex);
+		auto it = parkedConnections.find(clientSocket);
+
+		if (it == parkedConnections.end())
+		{
+			return false;
+		}
+
+		connection = std::move(it->second);
+
+		parkedConnections.erase(it);
+
+		return true;
+	}
+
+	void BaseTCPServer::onParkedConnectionEvent(SOCKET clientSocket, ConnectionPoller::Event event)
+	{
+		ParkedConnection connection;
+
+		if (!this->takeParkedConnection(clientSocket, connection))
+		{
+			return;
+		}
+
+		if (event == ConnectionPoller::Event::closed)
+		{
+			if (connection.cleanup)
+			{
+				connection.cleanup();
+			}
+
+			return;
+		}
+
+		ConnectionTracer::record(ConnectionTracer::EventType::dispatched, clientSocket, connection.address);
+
+		if (multiThreading)
+		{
+			if (threadPool)
+			{
+				threadPool->addTask
+				(
+					[this, clientSocket, parked = std::make_shared<ParkedConnection>(std::move(connection))]()
+					{
+						this->resume(clientSocket, *parked);
 					}
+				);
+			}
+			else
+			{
+				std::thread([this, clientSocket, parked = std::move(connection)]() mutable { this->resume(clientSocket, parked); }).detach();
+			}
+		}
+		else
+		{
+			this->resume(clientSocket, connection);
+		}
+	}
+
+	void BaseTCPServer::resume(SOCKET clientSocket, ParkedConnection& connection)
+	{
+		ConnectionTracer::record(ConnectionTracer::EventType::resumed, clientSocket, connection.address);
+
+		this->onConnectionResume(connection.ip, clientSocket, connection.address, connection.cleanup, connection.state);
+
+		if (static_cast<bool>(connection.cleanup))
+		{
+			connection.cleanup();
+		}
+	}
+
+	void BaseTCPServer::unpark(SOCKET clientSocket)
+	{
+		ParkedConnection connection;
+
+		// Poller event that already took connection owns it
+		if (!this->takeParkedConnection(clientSocket, connection))
+		{
+			return;
+		}
+
+		if (connectionPoller)
+		{
+			connectionPoller->remove(clientSocket);
+		}
+
+		if (connection.cleanup)
+		{
+			connection.cleanup();
+		}
+	}
+
+	void BaseTCPServer::closeClientSocket(SOCKET clientSocket)
+	{
+		if (socketReaper)
+		{
+			socketReaper->reap(clientSocket);
+		}
+		else
+		{
+			closesocket(clientSocket);
+		}
+	}
+
+	void BaseTCPServer::closeClientSockets(const std::vector<SOCKET>& clientSockets)
+	{
+		if (socketReaper)
+		{
+			socketReaper->reap(clientSockets);
+
+			return;
+		}
+
+		for (SOCKET clientSocket : clientSockets)
+		{
+			closesocket(clientSocket);
+		}
+	}
+
+	void BaseTCPServer::onConnectionResume(const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup, std::any& state)
+	{
+		this->clientConnection(ip, clientSocket, address, cleanup);
+	}
+
+	void BaseTCPServer::onListenerConnection(size_t listenerIndex, const std::string& ip, SOCKET clientSocket, sockaddr address, std::function<void()>& cleanup)
+	{
+		this->clientConnection(ip, clientSocket, address, cleanup);
+	}
+
+	void BaseTCPServer::onConnectionReceive(SOCKET clientSocket, sockaddr address)
+	{
+
+	}
+
+	void BaseTCPServer::onInvalidConnectionReceive()
+	{
+
+	}
+
+	uint32_t BaseTCPServer::classifyConnection(const std::string& ip, SOCKET clientSocket, sockaddr address) const
+	{
+		if (address.sa_family != AF_INET)
+		{
+			return 0;
+		}
+
+		uint32_t clientAddress = ntohl(reinterpret_cast<const sockaddr_in&>(address).sin_addr.s_addr);
+
+		// Rules are sorted by prefix length, so first match is longest
+		for (const PriorityRule& rule : priorityRules)
+		{
+			if ((clientAddress & rule.mask) == rule.network)
+			{
+				return rule.priorityClass;
+			}
+		}
+
+		return 0;
+	}
+
+	void BaseTCPServer::onConnectionRejected(SOCKET clientSocket, sockaddr address)
+	{
+
+	}
+
+	bool BaseTCPServer::autoCloseSocket() const
+	{
+		return true;
+	}
+
+	std::string BaseTCPServer::getClientIpV4(sockaddr address)
+	{
+		char ip[BaseTCPServer::ipV4Size] = {};
+
+		// Fits into small string buffer, so no allocation
+		inet_ntop(AF_INET, reinterpret_cast<const char*>(&reinterpret_cast<const sockaddr_in*>(&address)->sin_addr), ip, BaseTCPServer::ipV4Size);
+
+		return ip;
+	}
+
+	uint16_t BaseTCPServer::getClientPortV4(sockaddr address)
+	{
+		return ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port);
+	}
+
+	BaseTCPServer::PeerCredentials BaseTCPServer::getPeerCredentials(SOCKET clientSocket)
+	{
+		PeerCredentials result = {};
+
+#ifdef __LINUX__
+		ucred credentials = {};
+		socklen_t length = sizeof(credentials);
+
+		if (getsockopt(clientSocket, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		result.processId = credentials.pid;
+		result.userId = credentials.uid;
+		result.groupId = credentials.gid;
+#else
+		ULONG processId = 0;
+		DWORD bytesReturned = 0;
+
+		if (WSAIoctl(clientSocket, SIO_AF_UNIX_GETPEERPID, nullptr, 0, &processId, sizeof(processId), &bytesReturned, nullptr, nullptr) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		result.processId = processId;
+#endif
+
+		return result;
+	}
+
+	SOCKET BaseTCPServer::getActivatedListenSocket(size_t index)
+	{
+#ifdef __LINUX__
+		// sd_listen_fds(3) protocol: descriptors start from 3 and belong to process with LISTEN_PID
+		constexpr int listenDescriptorsStart = 3;
+
+		const char* listenProcessId = getenv("LISTEN_PID");
+		const char* listenDescriptors = getenv("LISTEN_FDS");
+
+		if (!listenProcessId || !listenDescriptors || strtoll(listenProcessId, nullptr, 10) != getpid() || index >= strtoull(listenDescriptors, nullptr, 10))
+		{
+			return INVALID_SOCKET;
+		}
+
+		SOCKET result = listenDescriptorsStart + static_cast<int>(index);
+
+		fcntl(result, F_SETFD, FD_CLOEXEC);
+
+		return result;
+#else
+		return INVALID_SOCKET;
+#endif
+	}
+
+	SOCKET BaseTCPServer::receiveListenSocket(std::string_view unixSocketPath)
+	{
+#ifdef __LINUX__
+		sockaddr_un address = {};
+		int addressLength = makeUnixAddress(unixSocketPath, address);
+
+		if (unixSocketPath.front() != '@')
+		{
+			unlink(address.sun_path);
+		}
+
+		SOCKET channel = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		if (channel == INVALID_SOCKET)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (bind(channel, reinterpret_cast<const sockaddr*>(&address), addressLength) == SOCKET_ERROR || listen(channel, 1) == SOCKET_ERROR)
+		{
+			closesocket(channel);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		SOCKET predecessor = accept(channel, nullptr, nullptr);
+
+		closesocket(channel);
+
+		if (unixSocketPath.front() != '@')
+		{
+			unlink(address.sun_path);
+		}
+
+		if (predecessor == INVALID_SOCKET)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		char payload = 0;
+		iovec buffer = { &payload, sizeof(payload) };
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+		msghdr message = {};
+
+		message.msg_iov = &buffer;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		if (recvmsg(predecessor, &message, MSG_CMSG_CLOEXEC) == SOCKET_ERROR)
+		{
+			closesocket(predecessor);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		closesocket(predecessor);
+
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+		SOCKET result = INVALID_SOCKET;
+
+		if (!header || header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS)
+		{
+			throw std::runtime_error("Predecessor didn't send listen socket");
+		}
+
+		std::memcpy(&result, CMSG_DATA(header), sizeof(int));
+
+		return result;
+#else
+		throw std::runtime_error("Listen socket handoff isn't supported on Windows");
+#endif
+	}
+
+	std::string BaseTCPServer::getVersion()
+	{
+		std::string version = "1.17.1";
+
+		return version;
+	}
+
+	BaseTCPServer::BaseTCPServer(std::string_view port, std::string_view host, DWORD timeout, bool multiThreading, u_long listenSocketBlockingMode, bool freeDLL) :
+		ip(host),
+		port(port),
+		listenSocket(INVALID_SOCKET),
+		timeout(timeout),
+		freeDLL(freeDLL),
+		isRunning(false),
+		multiThreading(multiThreading),
+		adoptedListenSocket(false),
+		listenSocketHandedOff(false),
+		transportSampling(false),
+		filteredConnections(0),
+		acceptBatchSize(1),
+		numberOfAcceptBatches(0),
+		numberOfAcceptedConnections(0),
+		largestAcceptBatch(0),
+		drainMicroseconds(0),
+		blockingMode(0),
+		listenSocketBlockingMode(listenSocketBlockingMode)
+	{
+#ifndef __LINUX__
+		WSADATA wsaData;
+
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#else
+		if ((wakeupDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif // __LINUX__
+	}
+
+	std::string BaseTCPServer::getServerIpV4() const
+	{
+		std::string ip;
+		sockaddr_in serverInfo = {};
+
+#ifdef __LINUX__
+		socklen_t len = sizeof(serverInfo);
+#else
+		int len = sizeof(serverInfo);
+#endif
+
+		ip.resize(BaseTCPServer::ipV4Size);
+
+		getsockname(listenSocket, reinterpret_cast<sockaddr*>(&serverInfo), &len);
+
+		inet_ntop(AF_INET, &serverInfo.sin_addr, ip.data(), BaseTCPServer::ipV4Size);
+
+		while (ip.back() == '\0')
+		{
+			ip.pop_back();
+		}
+
+		return ip;
+	}
+
+	uint16_t BaseTCPServer::getServerPortV4() const
+	{
+		sockaddr_in serverInfo = {};
+
+#ifdef __LINUX__
+		socklen_t len = sizeof(serverInfo);
+#else
+		int len = sizeof(serverInfo);
+#endif
+
+		getsockname(listenSocket, reinterpret_cast<sockaddr*>(&serverInfo), &len);
+
+		return ntohs(serverInfo.sin_port);
+	}
+
+	void BaseTCPServer::start(bool wait, const std::function<void()>& onStartServer, std::exception** outException)
+	{
+		if (!adoptedListenSocket)
+		{
+			this->createListenSocket();
+		}
+
+		for (Listener& listener : additionalListeners)
+		{
+			listener.socket = this->openListenSocket(listener.ip, listener.port);
+		}
+
+		adoptedListenSocket = false;
+		listenSocketHandedOff = false;
+		isRunning = true;
+
+		handle = std::async(std::launch::async, &BaseTCPServer::receiveConnections, this, onStartServer, outException);
+
+		if (wait)
+		{
+			handle.wait();
+		}
+	}
+
+	void BaseTCPServer::stop(bool wait)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		isRunning = false;
+
+#ifdef __LINUX__
+		uint64_t value = 1;
+
+		if (write(wakeupDescriptor, &value, sizeof(value)) == SOCKET_ERROR)
+		{
+			std::cerr << "Can't wake up accepting thread" << std::endl;
+		}
+#endif
+
+		closesocket(listenSocket);
+
+		if (!listenSocketHandedOff)
+		{
+			removeUnixSocketFile(ip, BaseTCPServer::unixSocketPrefix);
+		}
+
+		for (Listener& listener : additionalListeners)
+		{
+			if (listener.socket != INVALID_SOCKET)
+			{
+				closesocket(listener.socket);
+
+				listener.socket = INVALID_SOCKET;
+
+				removeUnixSocketFile(listener.ip, BaseTCPServer::unixSocketPrefix);
+			}
+		}
+
+		if (wait)
+		{
+			handle.wait();
+
+			if (socketReaper)
+			{
+				socketReaper->waitIdle();
+			}
+
+			drainMicroseconds.store(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+		}
+	}
+
+	void BaseTCPServer::adoptListenSocket(SOCKET socket)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't adopt listen socket while server is running");
+		}
+
+		sockaddr_storage address = {};
+#ifdef __LINUX__
+		socklen_t length = sizeof(address);
+#else
+		int length = sizeof(address);
+#endif
+
+		if (getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (address.ss_family == AF_UNIX && !this->isUnixSocket())
+		{
+			const sockaddr_un& unixAddress = reinterpret_cast<const sockaddr_un&>(address);
+			size_t pathLength = length - offsetof(sockaddr_un, sun_path);
+
+			ip = BaseTCPServer::unixSocketPrefix;
+
+			if (pathLength && !unixAddress.sun_path[0])
+			{
+				ip += '@';
+				ip.append(unixAddress.sun_path + 1, pathLength - 1);
+			}
+			else
+			{
+				ip += unixAddress.sun_path;
+			}
+		}
+
+		listenSocket = socket;
+		adoptedListenSocket = true;
+
+		this->applyListenSocketBlockingMode(listenSocket);
+	}
+
+	void BaseTCPServer::handOffListenSocket(std::string_view unixSocketPath)
+	{
+#ifdef __LINUX__
+		sockaddr_un address = {};
+		int addressLength = makeUnixAddress(unixSocketPath, address);
+		SOCKET channel = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+		if (channel == INVALID_SOCKET)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (connect(channel, reinterpret_cast<const sockaddr*>(&address), addressLength) == SOCKET_ERROR)
+		{
+			closesocket(channel);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		char payload = 0;
+		iovec buffer = { &payload, sizeof(payload) };
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+		msghdr message = {};
+
+		message.msg_iov = &buffer;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int));
+
+		std::memcpy(CMSG_DATA(header), &listenSocket, sizeof(int));
+
+		if (sendmsg(channel, &message, MSG_NOSIGNAL) == SOCKET_ERROR)
+		{
+			closesocket(channel);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		closesocket(channel);
+
+		listenSocketHandedOff = true;
+
+		this->stop();
+#else
+		throw std::runtime_error("Listen socket handoff isn't supported on Windows");
+#endif
+	}
+
+	bool BaseTCPServer::drain(std::chrono::milliseconds timeout)
+	{
+		std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + timeout;
+
+		while (this->getNumberOfConnections())
+		{
+			if (std::chrono::steady_clock::now() >= end)
+			{
+				return false;
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+
+		return true;
+	}
+
+	void BaseTCPServer::kick(const std::string& ip)
+	{
+		std::vector<SOCKET> sockets = data.extract(ip);
+
+		for (SOCKET socket : sockets)
+		{
+			ConnectionTracer::record(ConnectionTracer::EventType::kicked, socket);
+
+			this->unpark(socket);
+
+			// Released sockets are closed below, handler cleanups don't record them
+			ConnectionTracer::record(ConnectionTracer::EventType::closed, socket);
+		}
+
+		this->closeClientSockets(sockets);
+	}
+
+	void BaseTCPServer::kickAll()
+	{
+		// Sockets are released before parked cleanups run, so cleanups don't close them again. Closed after release, so descriptor reused by new connection can't be removed with kicked one
+		std::vector<SOCKET> kicked = data.clear();
+
+		for (SOCKET socket : kicked)
+		{
+			ConnectionTracer::record(ConnectionTracer::EventType::kicked, socket);
+
+			this->unpark(socket);
+
+			// Released sockets are closed below, handler cleanups don't record them
+			ConnectionTracer::record(ConnectionTracer::EventType::closed, socket);
+		}
+
+		this->closeClientSockets(kicked);
+	}
+
+	bool BaseTCPServer::isUnixSocket() const
+	{
+		return ip.starts_with(BaseTCPServer::unixSocketPrefix);
+	}
+
+	bool BaseTCPServer::isServerRunning() const
+	{
+		return isRunning;
+	}
+
+	bool BaseTCPServer::isListenSocketInBlockingMode() const
+	{
+		return !static_cast<bool>(listenSocketBlockingMode);
+	}
+
+	bool BaseTCPServer::isAcceptedSocketsInBlockingMode() const
+	{
+		return !static_cast<bool>(blockingMode);
+	}
+
+	void BaseTCPServer::setAcceptedSocketsBlockingMode(bool block)
+	{
+		blockingMode = !block;
+	}
+
+	void BaseTCPServer::setThreadPool(size_t numberOfWorkers)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't change thread pool while server is running");
+		}
+
+		threadPool = std::make_unique<WorkStealingThreadPool>(numberOfWorkers);
+	}
+
+	void BaseTCPServer::setThreadPool(const WorkStealingThreadPool::SizingOptions& options)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't change thread pool while server is running");
+		}
+
+		threadPool = std::make_unique<WorkStealingThreadPool>(options);
+	}
+
+	void BaseTCPServer::serveInMemory(InMemoryTransport& transport, SOCKET serverSocket, const std::string& ip)
+	{
+		Transport::Scope scope(transport);
+		sockaddr address = {};
+		sockaddr_in& addressV4 = reinterpret_cast<sockaddr_in&>(address);
+		std::function<void()> cleanup = [this, &transport, serverSocket]()
+			{
+				if (this->autoCloseSocket())
+				{
+					transport.closeEndpoint(serverSocket);
+				}
+			};
+
+		addressV4.sin_family = AF_INET;
+
+		inet_pton(AF_INET, ip.data(), &addressV4.sin_addr);
+
+		this->onConnectionReceive(serverSocket, address);
+
+		this->clientConnection(ip, serverSocket, address, cleanup);
+
+		if (static_cast<bool>(cleanup))
+		{
+			cleanup();
+		}
+	}
+
+	void BaseTCPServer::setPriorityClasses(const std::vector<PriorityClass>& classes)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't change priority classes while server is running");
+		}
+
+		std::vector<uint32_t> weights;
+
+		priorityClasses = classes;
+
+		if (priorityClasses.empty())
+		{
+			priorityClassCounters.reset();
+			pendingConnections.reset();
+
+			return;
+		}
+
+		priorityClassCounters = std::make_unique<PriorityClassCounters[]>(priorityClasses.size());
+
+		weights.reserve(priorityClasses.size());
+
+		for (const PriorityClass& priorityClass : priorityClasses)
+		{
+			weights.push_back(priorityClass.weight);
+		}
+
+		pendingConnections = std::make_unique<WeightedFairQueue<ClientData::Handle>>(weights);
+	}
 
-					if (setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutValue), sizeof(timeoutValue)) == SOCKET_ERROR)
-					{
-						THROW_WEB_SERVER_EXCEPTION;
-					}
+	void BaseTCPServer::addPriorityRule(std::string_view network, uint32_t priorityClass)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't change priority rules while server is running");
+		}
 
-#ifdef __LINUX__
-					int flags = fcntl(clientSocket, F_GETFL, 0);
+		uint32_t prefix;
+		uint8_t prefixLength;
 
-					if (flags == -1)
-					{
-						std::cerr << "Can't F_GETFL on socket" << std::endl;
+		if (!IpFilter::parseNetwork(network, prefix, prefixLength))
+		{
+			throw std::runtime_error("Wrong network: " + std::string(network));
+		}
 
-						THROW_WEB_SERVER_EXCEPTION;
-					}
+		PriorityRule rule = { prefix, prefixLength ? UINT32_MAX << (32 - prefixLength) : 0, priorityClass };
+
+		priorityRules.insert
+		(
+			std::upper_bound
+			(
+				priorityRules.begin(), priorityRules.end(), rule,
+				[](const PriorityRule& left, const PriorityRule& right) { return left.mask > right.mask; }
+			),
+			rule
+		);
+	}
 
-					flags = this->isAcceptedSocketsInBlockingMode() ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+	void BaseTCPServer::setSocketReaper(std::chrono::milliseconds closeDelay)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't change socket reaper while server is running");
+		}
 
-					if (fcntl(clientSocket, F_SETFL, flags) == SOCKET_ERROR)
-					{
-						THROW_WEB_SERVER_EXCEPTION;
-					}
-#else
-					if (ioctlsocket(clientSocket, FIONBIO, &blockingMode) == SOCKET_ERROR)
-					{
-						THROW_WEB_SERVER_EXCEPTION;
-					}
-#endif
+		socketReaper = std::make_unique<SocketReaper>(closeDelay);
+	}
 
-					std::string ip = BaseTCPServer::getClientIpV4(address);
+	size_t BaseTCPServer::addListener(std::string_view port, std::string_view host)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't add listener while server is running");
+		}
 
-					data.add(ip, clientSocket);
+		additionalListeners.push_back({ std::string(host), std::string(port), INVALID_SOCKET });
 
-					if (multiThreading)
-					{
-						std::thread(&BaseTCPServer::serve, this, ip, clientSocket, address).detach();
-					}
-					else
-					{
-						this->serve(ip, clientSocket, address);
-					}
-				}
-				else
-				{
-					this->onInvalidConnectionReceive();
-				}
-			}
+		return additionalListeners.size();
+	}
 
-			if (this->getNumberOfConnections())
-			{
-				this->kickAll();
-			}
+	void BaseTCPServer::setAcceptBatchSize(size_t batchSize)
+	{
+		if (isRunning)
+		{
+			throw std::runtime_error("Can't change accept batch size while server is running");
 		}
-		catch (const std::exception& e)
+
+		if (!batchSize)
 		{
-			if (outException)
-			{
-				*outException = new std::runtime_error(e.what());
-			}
-			else
-			{
-				std::cerr << __func__ << " throws exception: " << e.what() << std::endl;
-			}
+			throw std::runtime_error("Accept batch size must be greater than 0");
 		}
+
+		acceptBatchSize = batchSize;
 	}
 
-	void BaseTCPServer::serve(std::string ip, SOCKET clientSocket, sockaddr address)
+	size_t BaseTCPServer::getNumberOfListeners() const
 	{
-		std::function<void()> cleanup = [this, clientSocket, ip]()
-			{
-				if (this->autoCloseSocket())
-				{
-					closesocket(clientSocket);
-				}
-
-				data.remove(ip, clientSocket);
-			};
+		return additionalListeners.size() + 1;
+	}
 
-		this->onConnectionReceive(clientSocket, address);
+	uint16_t BaseTCPServer::getListenerPort(size_t listenerIndex) const
+	{
+		if (listenerIndex > additionalListeners.size())
+		{
+			throw std::runtime_error("Wrong listener index");
+		}
 
-		this->clientConnection(ip, clientSocket, address, cleanup);
+		SOCKET socket = listenerIndex ? additionalListeners[listenerIndex - 1].socket : listenSocket;
+		sockaddr_storage address = {};
+#ifdef __LINUX__
+		socklen_t length = sizeof(address);
+#else
+		int length = sizeof(address);
+#endif
 
-		if (static_cast<bool>(cleanup))
+		if (socket == INVALID_SOCKET || getsockname(socket, reinterpret_cast<sockaddr*>(&address), &length) == SOCKET_ERROR || address.ss_family != AF_INET)
 		{
-			cleanup();
+			return 0;
 		}
+
+		return ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port);
 	}
 
-	void BaseTCPServer::onConnectionReceive(SOCKET clientSocket, sockaddr address)
+	void BaseTCPServer::setIpFilter(std::shared_ptr<const IpFilter> filter)
 	{
+		ipFilter.store(std::move(filter), std::memory_order_release);
+	}
 
+	std::shared_ptr<const IpFilter> BaseTCPServer::getIpFilter() const
+	{
+		return ipFilter.load(std::memory_order_acquire);
 	}
 
-	void BaseTCPServer::onInvalidConnectionReceive()
+	uint64_t BaseTCPServer::getNumberOfFilteredConnections() const
 	{
+		return filteredConnections.load(std::memory_order_relaxed);
+	}
 
+	std::chrono::microseconds BaseTCPServer::getLastDrainTime() const
+	{
+		return std::chrono::microseconds(drainMicroseconds.load(std::memory_order_relaxed));
 	}
 
-	bool BaseTCPServer::autoCloseSocket() const
+	uint64_t BaseTCPServer::getNumberOfReapedSockets() const
 	{
-		return true;
+		return socketReaper ? socketReaper->getNumberOfClosedSockets() : 0;
 	}
 
-	std::string BaseTCPServer::getClientIpV4(sockaddr address)
+	BaseTCPServer::AcceptStatistics BaseTCPServer::getAcceptStatistics() const
 	{
-		std::string ip(BaseTCPServer::ipV4Size, '\0');
+		AcceptStatistics result = {};
 
-		inet_ntop(AF_INET, reinterpret_cast<const char*>(&reinterpret_cast<const sockaddr_in*>(&address)->sin_addr), ip.data(), BaseTCPServer::ipV4Size);
+		result.batches = numberOfAcceptBatches.load(std::memory_order_relaxed);
+		result.accepted = numberOfAcceptedConnections.load(std::memory_order_relaxed);
+		result.largestBatch = largestAcceptBatch.load(std::memory_order_relaxed);
 
-		while (ip.back() == '\0')
+#ifdef __LINUX__
+		for (size_t i = 0; i <= additionalListeners.size(); i++)
 		{
-			ip.pop_back();
+			SOCKET socket = i ? additionalListeners[i - 1].socket : listenSocket;
+			tcp_info info = {};
+			socklen_t length = sizeof(info);
+
+			// For listen socket kernel reports accept queue length in tcpi_unacked and backlog in tcpi_sacked
+			if (socket == INVALID_SOCKET || getsockopt(socket, IPPROTO_TCP, TCP_INFO, &info, &length) == SOCKET_ERROR || info.tcpi_state != TCP_LISTEN)
+			{
+				continue;
+			}
+
+			result.listenQueueLength += info.tcpi_unacked;
+			result.listenQueueCapacity += info.tcpi_sacked;
 		}
 
-		return ip;
+		readListenCounters(result.listenOverflows, result.listenDrops);
+#endif
+
+		return result;
 	}
 
-	uint16_t BaseTCPServer::getClientPortV4(sockaddr address)
+	std::vector<BaseTCPServer::PriorityClassStatistics> BaseTCPServer::getPriorityClassesStatistics() const
 	{
-		return ntohs(reinterpret_cast<const sockaddr_in&>(address).sin_port);
+		std::vector<PriorityClassStatistics> result;
+
+		result.reserve(priorityClasses.size());
+
+		for (uint32_t i = 0; i < priorityClasses.size(); i++)
+		{
+			result.push_back
+			(
+				{
+					priorityClasses[i].name,
+					data.getNumberOfConnections(i),
+					pendingConnections->size(i),
+					priorityClassCounters[i].accepted.load(std::memory_order_relaxed),
+					priorityClassCounters[i].rejected.load(std::memory_order_relaxed),
+					pendingConnections->getServed(i)
+				}
+			);
+		}
+
+		return result;
 	}
 
-	std::string BaseTCPServer::getVersion()
+	StreamTransfer::Result BaseTCPServer::sendStream(SOCKET clientSocket, std::span<const std::byte> data, const StreamTransfer::Options& options)
 	{
-		std::string version = "1.17.1";
-
-		return version;
+		return StreamTransfer::send(clientSocket, data, options);
 	}
 
-	BaseTCPServer::BaseTCPServer(std::string_view port, std::string_view host, DWORD timeout, bool multiThreading, u_long listenSocketBlockingMode, bool freeDLL) :
-		ip(host),
-		port(port),
-		listenSocket(INVALID_SOCKET),
-		blockingMode(0),
-		listenSocketBlockingMode(listenSocketBlockingMode),
-		timeout(timeout),
-		freeDLL(freeDLL),
-		isRunning(false),
-		multiThreading(multiThreading)
+	StreamTransfer::Result BaseTCPServer::receiveStream(SOCKET clientSocket, std::span<std::byte> destination, const StreamTransfer::Options& options)
 	{
-#ifndef __LINUX__
-		WSADATA wsaData;
+		StreamTransfer::Result result = StreamTransfer::receive(clientSocket, destination, options);
 
-		if (WSAStartup(MAKEWORD(2, 2), &wsaData))
-		{
-			THROW_WEB_SERVER_EXCEPTION;
-		}
-#endif // __LINUX__
+		ConnectionTracer::record(ConnectionTracer::EventType::received, clientSocket);
+
+		return result;
 	}
 
-	std::string BaseTCPServer::getServerIpV4() const
+	void BaseTCPServer::park(SOCKET clientSocket, std::function<void()>& cleanup, std::any state)
 	{
-		std::string ip;
-		sockaddr_in serverInfo = {};
+		std::call_once
+		(
+			connectionPollerFlag,
+			[this]()
+			{
+				connectionPoller = std::make_unique<ConnectionPoller>([this](SOCKET clientSocket, ConnectionPoller::Event event) { this->onParkedConnectionEvent(clientSocket, event); });
+			}
+		);
 
+		ParkedConnection connection = { {}, {}, std::move(cleanup), std::move(state) };
+		ClientData::Handle handle = data.find(clientSocket);
+		SOCKET registeredSocket;
+		uint32_t listener;
+
+		cleanup = nullptr;
+
+		if (handle.index == ClientData::invalidIndex || !data.get(handle, connection.ip, registeredSocket, connection.address, listener))
+		{
 #ifdef __LINUX__
-		socklen_t len = sizeof(serverInfo);
+			socklen_t length = sizeof(connection.address);
 #else
-		int len = sizeof(serverInfo);
+			int length = sizeof(connection.address);
 #endif
 
-		ip.resize(BaseTCPServer::ipV4Size);
+			getpeername(clientSocket, &connection.address, &length);
 
-		getsockname(listenSocket, reinterpret_cast<sockaddr*>(&serverInfo), &len);
+			connection.ip = BaseTCPServer::getClientIpV4(connection.address);
+		}
 
-		inet_ntop(AF_INET, &serverInfo.sin_addr, ip.data(), BaseTCPServer::ipV4Size);
+		ConnectionTracer::record(ConnectionTracer::EventType::parked, clientSocket, connection.address);
 
-		while (ip.back() == '\0')
+		// Connection is stored before socket is armed, so poller always finds it
 		{
-			ip.pop_back();
+			std::lock_guard<std::mutex> lock(parkedConnectionsMutex);
+
+			parkedConnections.insert_or_assign(clientSocket, std::move(connection));
 		}
 
-		return ip;
+		try
+		{
+			connectionPoller->add(clientSocket);
+		}
+		catch (const std::exception&)
+		{
+			std::lock_guard<std::mutex> lock(parkedConnectionsMutex);
+
+			if (auto it = parkedConnections.find(clientSocket); it != parkedConnections.end())
+			{
+				cleanup = std::move(it->second.cleanup);
+
+				parkedConnections.erase(it);
+			}
+
+			throw;
+		}
 	}
 
-	uint16_t BaseTCPServer::getServerPortV4() const
+	std::shared_ptr<SendQueue> BaseTCPServer::createSendQueue(SOCKET clientSocket, size_t highWatermark, size_t lowWatermark)
 	{
-		sockaddr_in serverInfo = {};
+		std::call_once(sendQueueFlusherFlag, [this]() { sendQueueFlusher = std::make_unique<SendQueueFlusher>(); });
+
+		return data.attachSendQueue(clientSocket, std::make_shared<SendQueue>(clientSocket, sendQueueFlusher.get(), highWatermark, lowWatermark));
+	}
+
+	BaseTCPServer::BroadcastResult BaseTCPServer::broadcast(const SendQueue::Payload& payload, SlowReceiverPolicy policy)
+	{
+		struct BroadcastState
+		{
+			std::vector<std::pair<SOCKET, std::shared_ptr<SendQueue>>> targets;
+			size_t numberOfBatches;
+			std::atomic<size_t> nextBatch;
+			std::atomic<size_t> completedBatches;
+			std::atomic<size_t> sent;
+			std::atomic<size_t> queued;
+			std::atomic<size_t> skipped;
+			std::atomic<size_t> kicked;
+			std::atomic<size_t> failed;
+		};
+
+		if (!payload || payload->empty())
+		{
+			return {};
+		}
 
+		std::shared_ptr<BroadcastState> state = std::make_shared<BroadcastState>();
+
+		data.getSockets(state->targets);
+
+		state->numberOfBatches = (state->targets.size() + broadcastBatchSize - 1) / broadcastBatchSize;
+
+		auto kickClient = [](SOCKET clientSocket)
+			{
 #ifdef __LINUX__
-		socklen_t len = sizeof(serverInfo);
+				shutdown(clientSocket, SHUT_RDWR);
 #else
-		int len = sizeof(serverInfo);
+				shutdown(clientSocket, SD_BOTH);
 #endif
 
-		getsockname(listenSocket, reinterpret_cast<sockaddr*>(&serverInfo), &len);
+				ConnectionTracer::record(ConnectionTracer::EventType::kicked, clientSocket);
+			};
 
-		return ntohs(serverInfo.sin_port);
-	}
+		// Tasks started after all batches are taken only touch shared state, so they may outlive this call
+		auto processBatches = [this, state, payload, policy, kickClient]()
+			{
+				size_t batch;
 
-	void BaseTCPServer::start(bool wait, const std::function<void()>& onStartServer, std::exception** outException)
-	{
-		this->createListenSocket();
+				while ((batch = state->nextBatch.fetch_add(1, std::memory_order_relaxed)) < state->numberOfBatches)
+				{
+					size_t end = std::min(state->targets.size(), (batch + 1) * broadcastBatchSize);
+					BroadcastResult result = {};
 
-		isRunning = true;
+					for (size_t i = batch * broadcastBatchSize; i < end; i++)
+					{
+						auto& [clientSocket, queue] = state->targets[i];
+
+						if (queue && queue->getQueuedBytes())
+						{
+							if (policy == SlowReceiverPolicy::skip)
+							{
+								result.skipped++;
+							}
+							else if (policy == SlowReceiverPolicy::kick)
+							{
+								kickClient(clientSocket);
+
+								result.kicked++;
+							}
+							else if (queue->enqueue(payload) || !queue->isFailed())
+							{
+								result.queued++;
+							}
+							else
+							{
+								result.failed++;
+							}
+
+							continue;
+						}
+
+						int lastSend = sendNonBlocking(clientSocket, payload->data(), static_cast<int>(payload->size()), blockingMode);
+
+						if (lastSend == static_cast<int>(payload->size()))
+						{
+							result.sent++;
+						}
+						else if (lastSend == SOCKET_ERROR && !isWouldBlock())
+						{
+							result.failed++;
+						}
+						else if (policy == SlowReceiverPolicy::kick)
+						{
+							kickClient(clientSocket);
+
+							result.kicked++;
+						}
+						else if (policy == SlowReceiverPolicy::skip && lastSend <= 0)
+						{
+							result.skipped++;
+						}
+						else
+						{
+							this->createSendQueue(clientSocket)->enqueue(payload, std::max(lastSend, 0));
+
+							result.queued++;
+						}
+					}
 
-		handle = std::async(std::launch::async, &BaseTCPServer::receiveConnections, this, onStartServer, outException);
+					state->sent.fetch_add(result.sent, std::memory_order_relaxed);
+					state->queued.fetch_add(result.queued, std::memory_order_relaxed);
+					state->skipped.fetch_add(result.skipped, std::memory_order_relaxed);
+					state->kicked.fetch_add(result.kicked, std::memory_order_relaxed);
+					state->failed.fetch_add(result.failed, std::memory_order_relaxed);
 
-		if (wait)
+					state->completedBatches.fetch_add(1, std::memory_order_release);
+					state->completedBatches.notify_all();
+				}
+			};
+
+		if (threadPool)
 		{
-			handle.wait();
+			size_t numberOfTasks = std::min(threadPool->getNumberOfWorkers(), state->numberOfBatches);
+
+			for (size_t i = 1; i < numberOfTasks; i++)
+			{
+				threadPool->addTask(processBatches);
+			}
 		}
-	}
 
-	void BaseTCPServer::stop(bool wait)
-	{
-		isRunning = false;
+		// Calling thread takes batches too, so broadcast can't deadlock when called from busy pool worker
+		processBatches();
 
-		closesocket(listenSocket);
+		size_t completedBatches;
 
-		if (wait)
+		while ((completedBatches = state->completedBatches.load(std::memory_order_acquire)) != state->numberOfBatches)
 		{
-			handle.wait();
+			state->completedBatches.wait(completedBatches, std::memory_order_acquire);
 		}
+
+		return
+		{
+			state->sent.load(std::memory_order_relaxed),
+			state->queued.load(std::memory_order_relaxed),
+			state->skipped.load(std::memory_order_relaxed),
+			state->kicked.load(std::memory_order_relaxed),
+			state->failed.load(std::memory_order_relaxed)
+		};
 	}
 
-	void BaseTCPServer::kick(const std::string& ip)
+	void BaseTCPServer::reserveConnections(size_t numberOfConnections)
 	{
-		std::vector<SOCKET> sockets = data.extract(ip);
+		data.reserve(numberOfConnections);
+	}
 
-		for (SOCKET socket : sockets)
+	void BaseTCPServer::sampleTransport()
+	{
+		std::vector<TransportStatistics::Sample> samples;
+
+		for (auto& [ip, sockets] : data.getClients())
 		{
-			closesocket(socket);
+			for (SOCKET clientSocket : sockets)
+			{
+				TransportInfo info;
+
+				if (TransportStatistics::sample(clientSocket, info))
+				{
+					samples.push_back({ ip, clientSocket, info });
+				}
+			}
 		}
+
+		transportStatistics.add(samples);
 	}
 
-	void BaseTCPServer::kickAll()
+	void BaseTCPServer::startTransportSampling(std::chrono::milliseconds interval)
 	{
-		for (auto&& [ip, sockets] : data.getClients())
-		{
-			for (SOCKET socket : sockets)
+		this->stopTransportSampling();
+
+		transportSampling = true;
+
+		transportSamplingThread = std::thread([this, interval]()
 			{
-				closesocket(socket);
-			}
+				std::unique_lock<std::mutex> lock(transportSamplingMutex);
+
+				while (!transportSamplingCondition.wait_for(lock, interval, [this]() { return !transportSampling; }))
+				{
+					lock.unlock();
+
+					this->sampleTransport();
+
+					lock.lock();
+				}
+			});
+	}
+
+	void BaseTCPServer::stopTransportSampling()
+	{
+		{
+			std::lock_guard<std::mutex> lock(transportSamplingMutex);
+
+			transportSampling = false;
 		}
 
-		data.clear();
+		transportSamplingCondition.notify_all();
+
+		if (transportSamplingThread.joinable())
+		{
+			transportSamplingThread.join();
+		}
 	}
 
-	bool BaseTCPServer::isServerRunning() const
+	const TransportStatistics& BaseTCPServer::getTransportStatistics() const
 	{
-		return isRunning;
+		return transportStatistics;
 	}
 
-	bool BaseTCPServer::isListenSocketInBlockingMode() const
+	std::vector<WorkStealingThreadPool::WorkerStatistics> BaseTCPServer::getWorkersStatistics() const
 	{
-		return !static_cast<bool>(listenSocketBlockingMode);
+		return threadPool ? threadPool->getWorkersStatistics() : std::vector<WorkStealingThreadPool::WorkerStatistics>();
 	}
 
-	bool BaseTCPServer::isAcceptedSocketsInBlockingMode() const
+	WorkStealingThreadPool::SizingStatistics BaseTCPServer::getThreadPoolSizingStatistics() const
 	{
-		return !static_cast<bool>(blockingMode);
+		return threadPool ? threadPool->getSizingStatistics() : WorkStealingThreadPool::SizingStatistics();
 	}
 
-	void BaseTCPServer::setAcceptedSocketsBlockingMode(bool block)
+	size_t BaseTCPServer::getNumberOfParkedConnections()
 	{
-		blockingMode = !block;
+		std::lock_guard<std::mutex> lock(parkedConnectionsMutex);
+
+		return parkedConnections.size();
 	}
 
 	size_t BaseTCPServer::getNumberOfClients() const
@@ -500,6 +2635,37 @@ namespace web
 			this->stop();
 		}
 
+		if (handle.valid())
+		{
+			handle.wait();
+		}
+
+		this->stopTransportSampling();
+
+		// Poller dispatches into thread pool, so it's stopped first
+		connectionPoller.reset();
+
+		threadPool.reset();
+
+		for (auto& [clientSocket, connection] : parkedConnections)
+		{
+			if (connection.cleanup)
+			{
+				connection.cleanup();
+			}
+		}
+
+		parkedConnections.clear();
+
+		sendQueueFlusher.reset();
+
+		// Cleanups above may hand sockets to reaper, so it's destroyed last and closes them
+		socketReaper.reset();
+
+#ifdef __LINUX__
+		close(wakeupDescriptor);
+#endif
+
 #ifndef __LINUX__
 		if (freeDLL)
 		{
@@ -0,0 +1,216 @@
+#include "ConnectionPoller.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "WebServerException.h"
+
+#ifdef __LINUX__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/**
+ * @brief Maximum number of events handled by one epoll_wait
+ */
+static constexpr int maxEvents = 256;
+
+/**
+ * @brief Peer's last data is still readable after FIN
+ */
+static bool hasPendingBytes(SOCKET clientSocket)
+{
+#ifdef __LINUX__
+	int available = 0;
+
+	return ioctl(clientSocket, FIONREAD, &available) != SOCKET_ERROR && available > 0;
+#else
+	u_long available = 0;
+
+	return ioctlsocket(clientSocket, FIONREAD, &available) != SOCKET_ERROR && available > 0;
+#endif
+}
+
+namespace web
+{
+	void ConnectionPoller::pollThread()
+	{
+#ifdef __LINUX__
+		epoll_event events[maxEvents];
+
+		while (isRunning.load(std::memory_order_acquire))
+		{
+			int count = epoll_wait(epollDescriptor, events, maxEvents, -1);
+
+			for (int i = 0; i < count; i++)
+			{
+				if (events[i].data.fd == wakeupDescriptor)
+				{
+					continue;
+				}
+
+				uint32_t flags = events[i].events;
+				Event event = (flags & EPOLLIN) && !(flags & EPOLLERR) ? Event::readable : Event::closed;
+
+				// Data with FIN is still dispatched, so handler can read last request
+				if (event == Event::readable && (flags & (EPOLLRDHUP | EPOLLHUP)) && !hasPendingBytes(events[i].data.fd))
+				{
+					event = Event::closed;
+				}
+
+				callback(events[i].data.fd, event);
+			}
+		}
+#else
+		std::vector<WSAPOLLFD> descriptors;
+
+		while (isRunning.load(std::memory_order_acquire))
+		{
+			{
+				std::lock_guard<std::mutex> lock(socketsMutex);
+
+				descriptors.resize(sockets.size());
+
+				for (size_t i = 0; i < sockets.size(); i++)
+				{
+					descriptors[i] = { sockets[i], POLLRDNORM, 0 };
+				}
+			}
+
+			// WSAPoll can't wait for event, so newly added sockets are picked up by timeout
+			if (descriptors.empty())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				continue;
+			}
+
+			if (WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), 10) <= 0)
+			{
+				continue;
+			}
+
+			for (const WSAPOLLFD& descriptor : descriptors)
+			{
+				if (!descriptor.revents)
+				{
+					continue;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(socketsMutex);
+
+					auto it = std::find(sockets.begin(), sockets.end(), descriptor.fd);
+
+					if (it == sockets.end())
+					{
+						continue;
+					}
+
+					sockets.erase(it);
+				}
+
+				Event event = (descriptor.revents & POLLRDNORM) && !(descriptor.revents & POLLERR) ? Event::readable : Event::closed;
+
+				// Data with FIN is still dispatched, so handler can read last request
+				if (event == Event::readable && (descriptor.revents & POLLHUP) && !hasPendingBytes(descriptor.fd))
+				{
+					event = Event::closed;
+				}
+
+				callback(descriptor.fd, event);
+			}
+		}
+#endif
+	}
+
+	ConnectionPoller::ConnectionPoller(Callback&& callback) :
+		callback(std::move(callback)),
+		isRunning(true)
+	{
+#ifdef __LINUX__
+		if ((epollDescriptor = epoll_create1(EPOLL_CLOEXEC)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if ((wakeupDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == SOCKET_ERROR)
+		{
+			close(epollDescriptor);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		epoll_event event = {};
+
+		event.events = EPOLLIN;
+		event.data.fd = wakeupDescriptor;
+
+		if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeupDescriptor, &event) == SOCKET_ERROR)
+		{
+			close(wakeupDescriptor);
+			close(epollDescriptor);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+
+		thread = std::thread(&ConnectionPoller::pollThread, this);
+	}
+
+	void ConnectionPoller::add(SOCKET clientSocket)
+	{
+#ifdef __LINUX__
+		epoll_event event = {};
+
+		event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+		event.data.fd = clientSocket;
+
+		// Socket reported before stays in epoll set disarmed, so it's rearmed with EPOLL_CTL_MOD
+		if (epoll_ctl(epollDescriptor, EPOLL_CTL_MOD, clientSocket, &event) == SOCKET_ERROR)
+		{
+			if (errno != ENOENT || epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, clientSocket, &event) == SOCKET_ERROR)
+			{
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+		}
+#else
+		std::lock_guard<std::mutex> lock(socketsMutex);
+
+		sockets.push_back(clientSocket);
+#endif
+	}
+
+	void ConnectionPoller::remove(SOCKET clientSocket)
+	{
+#ifdef __LINUX__
+		epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, clientSocket, nullptr);
+#else
+		std::lock_guard<std::mutex> lock(socketsMutex);
+
+		std::erase(sockets, clientSocket);
+#endif
+	}
+
+	ConnectionPoller::~ConnectionPoller()
+	{
+		isRunning.store(false, std::memory_order_release);
+
+#ifdef __LINUX__
+		eventfd_write(wakeupDescriptor, 1);
+#endif
+
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+
+#ifdef __LINUX__
+		close(wakeupDescriptor);
+		close(epollDescriptor);
+#endif
+	}
+}
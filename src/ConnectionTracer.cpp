@@ -0,0 +1,212 @@
+#include "ConnectionTracer.h"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <mutex>
+
+#ifdef __LINUX__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#else
+#include <WS2tcpip.h>
+#endif
+
+namespace web
+{
+	std::mutex ConnectionTracer::buffersMutex;
+	std::vector<std::unique_ptr<ConnectionTracer::ThreadBuffer>> ConnectionTracer::buffers;
+	size_t ConnectionTracer::eventsPerThread = 4096;
+
+	ConnectionTracer::ThreadBuffer::ThreadBuffer(size_t capacity, uint32_t index) :
+		events(std::make_unique<Event[]>(capacity)),
+		mask(capacity - 1),
+		writeIndex(0),
+		used(true),
+		index(index)
+	{
+
+	}
+
+	ConnectionTracer::ThreadBuffer& ConnectionTracer::getThreadBuffer()
+	{
+		// Buffer is returned to the pool when thread exits, so thread per connection mode doesn't grow number of buffers
+		struct Holder
+		{
+			ThreadBuffer* buffer = nullptr;
+
+			~Holder()
+			{
+				if (buffer)
+				{
+					buffer->used.store(false, std::memory_order_release);
+				}
+			}
+		};
+
+		static thread_local Holder holder;
+
+		if (holder.buffer)
+		{
+			return *holder.buffer;
+		}
+
+		std::lock_guard<std::mutex> lock(buffersMutex);
+
+		for (std::unique_ptr<ThreadBuffer>& buffer : buffers)
+		{
+			if (!buffer->used.load(std::memory_order_acquire) && buffer->mask + 1 == eventsPerThread)
+			{
+				buffer->used.store(true, std::memory_order_relaxed);
+
+				holder.buffer = buffer.get();
+
+				return *holder.buffer;
+			}
+		}
+
+		buffers.push_back(std::make_unique<ThreadBuffer>(eventsPerThread, static_cast<uint32_t>(buffers.size())));
+
+		holder.buffer = buffers.back().get();
+
+		return *holder.buffer;
+	}
+
+	void ConnectionTracer::write(EventType type, SOCKET socket, const sockaddr* address)
+	{
+		ThreadBuffer& buffer = ConnectionTracer::getThreadBuffer();
+		uint64_t index = buffer.writeIndex.load(std::memory_order_relaxed);
+		Event& event = buffer.events[index & buffer.mask];
+
+		event.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		event.socket = static_cast<uint64_t>(socket);
+		event.type = type;
+		event.thread = buffer.index;
+
+		if (address && address->sa_family == AF_INET)
+		{
+			const sockaddr_in* addressV4 = reinterpret_cast<const sockaddr_in*>(address);
+
+			event.peerAddress = addressV4->sin_addr.s_addr;
+			event.peerPort = ntohs(addressV4->sin_port);
+		}
+		else
+		{
+			event.peerAddress = 0;
+			event.peerPort = 0;
+		}
+
+		buffer.writeIndex.store(index + 1, std::memory_order_release);
+	}
+
+	void ConnectionTracer::enable(size_t eventsPerThread)
+	{
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+
+			ConnectionTracer::eventsPerThread = std::bit_ceil(std::max<size_t>(eventsPerThread, 2));
+		}
+
+		enabled.store(true, std::memory_order_relaxed);
+	}
+
+	void ConnectionTracer::disable()
+	{
+		enabled.store(false, std::memory_order_relaxed);
+	}
+
+	bool ConnectionTracer::isEnabled()
+	{
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	void ConnectionTracer::clear()
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+
+		for (std::unique_ptr<ThreadBuffer>& buffer : buffers)
+		{
+			buffer->writeIndex.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	std::vector<ConnectionTracer::Event> ConnectionTracer::getEvents()
+	{
+		std::vector<Event> result;
+
+		{
+			std::lock_guard<std::mutex> lock(buffersMutex);
+
+			for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+			{
+				uint64_t end = buffer->writeIndex.load(std::memory_order_acquire);
+				uint64_t start = end > buffer->mask + 1 ? end - buffer->mask - 1 : 0;
+
+				for (uint64_t i = start; i < end; i++)
+				{
+					result.push_back(buffer->events[i & buffer->mask]);
+				}
+			}
+		}
+
+		std::stable_sort(result.begin(), result.end(), [](const Event& left, const Event& right) { return left.timestamp < right.timestamp; });
+
+		return result;
+	}
+
+	void ConnectionTracer::dump(std::ostream& stream)
+	{
+		stream << "timestamp,thread,event,socket,ip,port" << '\n';
+
+		for (const Event& event : ConnectionTracer::getEvents())
+		{
+			char ip[INET_ADDRSTRLEN] = {};
+
+			inet_ntop(AF_INET, &event.peerAddress, ip, sizeof(ip));
+
+			stream << event.timestamp << ','
+				<< event.thread << ','
+				<< ConnectionTracer::getEventName(event.type) << ','
+				<< event.socket << ','
+				<< (event.peerAddress ? ip : "") << ','
+				<< event.peerPort << '\n';
+		}
+
+		stream.flush();
+	}
+
+	const char* ConnectionTracer::getEventName(EventType type)
+	{
+		switch (type)
+		{
+		case EventType::accepted:
+			return "accepted";
+
+		case EventType::dispatched:
+			return "dispatched";
+
+		case EventType::handlerStart:
+			return "handlerStart";
+
+		case EventType::handlerEnd:
+			return "handlerEnd";
+
+		case EventType::received:
+			return "received";
+
+		case EventType::closed:
+			return "closed";
+
+		case EventType::kicked:
+			return "kicked";
+
+		case EventType::parked:
+			return "parked";
+
+		case EventType::resumed:
+			return "resumed";
+		}
+
+		return "unknown";
+	}
+}
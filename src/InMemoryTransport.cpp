@@ -0,0 +1,179 @@
+#include "InMemoryTransport.h"
+
+#include <algorithm>
+
+#include "WebServerException.h"
+
+/**
+ * @brief Unread bytes are moved to buffer start when reader lags behind by this many received bytes
+ */
+static constexpr size_t compactionThreshold = 64 * 1024;
+
+#ifdef __LINUX__
+#include <cerrno>
+#endif
+
+static void setError(bool unknownSocket)
+{
+#ifdef __LINUX__
+	errno = unknownSocket ? EBADF : EPIPE;
+#else
+	WSASetLastError(unknownSocket ? WSAENOTSOCK : WSAECONNRESET);
+#endif
+}
+
+namespace web
+{
+	InMemoryTransport::Stream& InMemoryTransport::getStream(SOCKET socket, bool outgoing) const
+	{
+		size_t offset = static_cast<size_t>(socket) - static_cast<size_t>(InMemoryTransport::firstSocket);
+
+		if (socket < InMemoryTransport::firstSocket || offset / 2 >= connections.size())
+		{
+			setError(true);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		// Client sends into first stream, server sends into second
+		bool client = !(offset % 2);
+
+		return connections[offset / 2]->streams[client == outgoing ? 0 : 1];
+	}
+
+	InMemoryTransport::Endpoints InMemoryTransport::createConnection()
+	{
+		std::lock_guard<std::mutex> lock(transportMutex);
+		size_t index;
+
+		if (freeConnections.empty())
+		{
+			index = connections.size();
+
+			connections.push_back(std::make_unique<Connection>());
+		}
+		else
+		{
+			index = freeConnections.back();
+
+			freeConnections.pop_back();
+		}
+
+		Connection& connection = *connections[index];
+		SOCKET client = static_cast<SOCKET>(InMemoryTransport::firstSocket + index * 2);
+
+		for (Stream& stream : connection.streams)
+		{
+			stream.data.clear();
+			stream.offset = 0;
+			stream.finished = false;
+			stream.receiverClosed = false;
+		}
+
+		connection.closed[0] = connection.closed[1] = false;
+
+		return { client, client + 1 };
+	}
+
+	void InMemoryTransport::finishSending(SOCKET socket)
+	{
+		std::lock_guard<std::mutex> lock(transportMutex);
+		Stream& stream = this->getStream(socket, true);
+
+		stream.finished = true;
+
+		stream.condition.notify_all();
+	}
+
+	void InMemoryTransport::closeEndpoint(SOCKET socket)
+	{
+		std::lock_guard<std::mutex> lock(transportMutex);
+		Stream& outgoing = this->getStream(socket, true);
+		Stream& incoming = this->getStream(socket, false);
+		size_t offset = static_cast<size_t>(socket) - static_cast<size_t>(InMemoryTransport::firstSocket);
+		Connection& connection = *connections[offset / 2];
+
+		if (connection.closed[offset % 2])
+		{
+			return;
+		}
+
+		connection.closed[offset % 2] = true;
+
+		outgoing.finished = true;
+		incoming.receiverClosed = true;
+
+		incoming.data.clear();
+		incoming.offset = 0;
+
+		outgoing.condition.notify_all();
+		incoming.condition.notify_all();
+
+		if (connection.closed[0] && connection.closed[1])
+		{
+			freeConnections.push_back(offset / 2);
+		}
+	}
+
+	size_t InMemoryTransport::getNumberOfPendingBytes(SOCKET socket) const
+	{
+		std::lock_guard<std::mutex> lock(transportMutex);
+		const Stream& stream = this->getStream(socket, false);
+
+		return stream.data.size() - stream.offset;
+	}
+
+	int InMemoryTransport::sendBytes(SOCKET socket, const char* data, int size)
+	{
+		std::lock_guard<std::mutex> lock(transportMutex);
+		Stream& stream = this->getStream(socket, true);
+
+		if (stream.finished || stream.receiverClosed)
+		{
+			setError(false);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		stream.data.append(data, size);
+
+		stream.condition.notify_all();
+
+		return size;
+	}
+
+	int InMemoryTransport::receiveBytes(SOCKET socket, char* data, int size)
+	{
+		std::unique_lock<std::mutex> lock(transportMutex);
+		Stream& stream = this->getStream(socket, false);
+
+		stream.condition.wait(lock, [&stream]() { return stream.offset != stream.data.size() || stream.finished || stream.receiverClosed; });
+
+		if (stream.receiverClosed)
+		{
+			setError(true);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		size_t count = std::min(static_cast<size_t>(size), stream.data.size() - stream.offset);
+
+		std::copy_n(stream.data.data() + stream.offset, count, data);
+
+		stream.offset += count;
+
+		// Buffer is reused without moving unread bytes until reader catches up or received prefix gets large
+		if (stream.offset == stream.data.size())
+		{
+			stream.data.clear();
+			stream.offset = 0;
+		}
+		else if (stream.offset >= compactionThreshold && stream.offset * 2 >= stream.data.size())
+		{
+			stream.data.erase(0, stream.offset);
+			stream.offset = 0;
+		}
+
+		return static_cast<int>(count);
+	}
+}
@@ -0,0 +1,222 @@
+#include "IpFilter.h"
+
+#include <charconv>
+#include <stdexcept>
+
+namespace web
+{
+	bool IpFilter::parseNetwork(std::string_view network, uint32_t& prefix, uint8_t& prefixLength)
+	{
+		size_t separator = network.find('/');
+		std::string_view address = network.substr(0, separator);
+		const char* current = address.data();
+		const char* end = address.data() + address.size();
+		uint32_t length = 32;
+
+		prefix = 0;
+
+		for (size_t i = 0; i < 4; i++)
+		{
+			uint32_t octet = 0;
+
+			if (i && (current == end || *current++ != '.'))
+			{
+				return false;
+			}
+
+			auto [next, error] = std::from_chars(current, end, octet);
+
+			if (error != std::errc() || octet > 255)
+			{
+				return false;
+			}
+
+			prefix = (prefix << 8) | octet;
+			current = next;
+		}
+
+		if (current != end)
+		{
+			return false;
+		}
+
+		if (separator != std::string_view::npos)
+		{
+			std::string_view suffix = network.substr(separator + 1);
+
+			if (auto [next, error] = std::from_chars(suffix.data(), suffix.data() + suffix.size(), length); error != std::errc() || next != suffix.data() + suffix.size() || length > 32)
+			{
+				return false;
+			}
+		}
+
+		prefixLength = static_cast<uint8_t>(length);
+		prefix &= length ? UINT32_MAX << (32 - length) : 0;
+
+		return true;
+	}
+
+	IpFilter::IpFilter(const std::vector<std::string>& allowed, const std::vector<std::string>& denied) :
+		numberOfRules(allowed.size() + denied.size()),
+		defaultAllow(allowed.empty())
+	{
+		/// @brief Uncompressed trie node, one per prefix bit
+		struct BuildNode
+		{
+			uint32_t children[2];
+			Action action;
+		};
+
+		/// @brief Compressed node waiting for its position in nodes
+		struct PendingNode
+		{
+			uint32_t source;
+			uint32_t prefix;
+			uint8_t prefixLength;
+			uint32_t parent;
+			uint8_t bit;
+		};
+
+		std::vector<BuildNode> source = { { { noChild, noChild }, Action::none } };
+
+		auto addRules = [&source](const std::vector<std::string>& networks, Action action)
+			{
+				for (const std::string& network : networks)
+				{
+					uint32_t prefix;
+					uint8_t prefixLength;
+					uint32_t index = 0;
+
+					if (!IpFilter::parseNetwork(network, prefix, prefixLength))
+					{
+						throw std::runtime_error("Wrong network: " + network);
+					}
+
+					for (uint8_t i = 0; i < prefixLength; i++)
+					{
+						uint8_t bit = (prefix >> (31 - i)) & 1;
+
+						if (source[index].children[bit] == noChild)
+						{
+							source[index].children[bit] = static_cast<uint32_t>(source.size());
+
+							source.push_back({ { noChild, noChild }, Action::none });
+						}
+
+						index = source[index].children[bit];
+					}
+
+					if (source[index].action != Action::deny)
+					{
+						source[index].action = action;
+					}
+				}
+			};
+
+		addRules(allowed, Action::allow);
+		addRules(denied, Action::deny);
+
+		std::vector<PendingNode> pending = { { 0, 0, 0, noChild, 0 } };
+
+		while (pending.size())
+		{
+			PendingNode current = pending.back();
+
+			pending.pop_back();
+
+			// Node without rule and with one child adds nothing to lookup
+			while (current.prefixLength < 32 && source[current.source].action == Action::none)
+			{
+				const BuildNode& node = source[current.source];
+
+				if ((node.children[0] == noChild) == (node.children[1] == noChild))
+				{
+					break;
+				}
+
+				uint8_t bit = node.children[1] != noChild;
+
+				current.source = node.children[bit];
+				current.prefix |= static_cast<uint32_t>(bit) << (31 - current.prefixLength);
+				current.prefixLength++;
+			}
+
+			uint32_t index = static_cast<uint32_t>(nodes.size());
+
+			nodes.push_back({ current.prefix, { noChild, noChild }, current.prefixLength, source[current.source].action });
+
+			if (index)
+			{
+				nodes[current.parent].children[current.bit] = index;
+			}
+
+			// Zero child is pushed last, so nodes are stored in preorder
+			for (int bit = 1; bit >= 0; bit--)
+			{
+				if (uint32_t child = source[current.source].children[bit]; child != noChild)
+				{
+					pending.push_back({ child, current.prefix | (static_cast<uint32_t>(bit) << (31 - current.prefixLength)), static_cast<uint8_t>(current.prefixLength + 1), index, static_cast<uint8_t>(bit) });
+				}
+			}
+		}
+
+		nodes.shrink_to_fit();
+	}
+
+	bool IpFilter::isAllowed(uint32_t address) const
+	{
+		switch (this->find(address))
+		{
+		case Action::allow:
+			return true;
+
+		case Action::deny:
+			return false;
+
+		default:
+			return defaultAllow;
+		}
+	}
+
+	IpFilter::Action IpFilter::find(uint32_t address) const
+	{
+		Action result = Action::none;
+		uint32_t index = 0;
+
+		do
+		{
+			const Node& node = nodes[index];
+			uint32_t mask = node.prefixLength ? UINT32_MAX << (32 - node.prefixLength) : 0;
+
+			if ((address & mask) != node.prefix)
+			{
+				break;
+			}
+
+			if (node.action != Action::none)
+			{
+				result = node.action;
+			}
+
+			if (node.prefixLength == 32)
+			{
+				break;
+			}
+
+			index = node.children[(address >> (31 - node.prefixLength)) & 1];
+		}
+		while (index != noChild);
+
+		return result;
+	}
+
+	size_t IpFilter::getNumberOfRules() const
+	{
+		return numberOfRules;
+	}
+
+	size_t IpFilter::getNumberOfNodes() const
+	{
+		return nodes.size();
+	}
+}
@@ -0,0 +1,214 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#include "WebServerException.h"
+
+#ifdef __LINUX__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <Windows.h>
+#endif
+
+namespace web
+{
+	void MappedFile::unmap()
+	{
+#ifdef __LINUX__
+		if (data)
+		{
+			munmap(data, size);
+		}
+
+		if (file != -1)
+		{
+			close(file);
+		}
+
+		file = -1;
+#else
+		if (data)
+		{
+			UnmapViewOfFile(data);
+		}
+
+		if (mapping)
+		{
+			CloseHandle(mapping);
+		}
+
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file);
+		}
+
+		file = INVALID_HANDLE_VALUE;
+		mapping = nullptr;
+#endif
+
+		data = nullptr;
+		size = 0;
+	}
+
+	MappedFile::MappedFile(const std::filesystem::path& path, Mode mode, uint64_t size) :
+		data(nullptr),
+		size(0)
+	{
+		bool writable = mode == Mode::readWrite;
+
+#ifdef __LINUX__
+		if ((file = open(path.c_str(), writable ? O_RDWR | O_CREAT | O_CLOEXEC : O_RDONLY | O_CLOEXEC, 0644)) == -1)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		struct stat information = {};
+
+		if (writable ? ftruncate(file, size) == -1 : fstat(file, &information) == -1)
+		{
+			this->unmap();
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		this->size = writable ? size : information.st_size;
+
+		// Empty file can't be mapped
+		if (!this->size)
+		{
+			return;
+		}
+
+		void* result = mmap(nullptr, this->size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, file, 0);
+
+		if (result == MAP_FAILED)
+		{
+			this->unmap();
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		data = static_cast<std::byte*>(result);
+
+		madvise(data, this->size, MADV_SEQUENTIAL);
+#else
+		mapping = nullptr;
+		file = CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, nullptr, writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		LARGE_INTEGER fileSize = {};
+
+		if (writable)
+		{
+			fileSize.QuadPart = size;
+
+			if (!SetFilePointerEx(file, fileSize, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+			{
+				this->unmap();
+
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+		}
+		else if (!GetFileSizeEx(file, &fileSize))
+		{
+			this->unmap();
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		this->size = fileSize.QuadPart;
+
+		if (!this->size)
+		{
+			return;
+		}
+
+		if (!(mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr)) ||
+			!(data = static_cast<std::byte*>(MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0))))
+		{
+			this->unmap();
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept :
+		data(std::exchange(other.data, nullptr)),
+		size(std::exchange(other.size, 0)),
+#ifdef __LINUX__
+		file(std::exchange(other.file, -1))
+#else
+		file(std::exchange(other.file, INVALID_HANDLE_VALUE)),
+		mapping(std::exchange(other.mapping, nullptr))
+#endif
+	{
+
+	}
+
+	MappedFile& MappedFile::operator = (MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			this->unmap();
+
+			data = std::exchange(other.data, nullptr);
+			size = std::exchange(other.size, 0);
+#ifdef __LINUX__
+			file = std::exchange(other.file, -1);
+#else
+			file = std::exchange(other.file, INVALID_HANDLE_VALUE);
+			mapping = std::exchange(other.mapping, nullptr);
+#endif
+		}
+
+		return *this;
+	}
+
+	void MappedFile::flush()
+	{
+		if (!data)
+		{
+			return;
+		}
+
+#ifdef __LINUX__
+		if (msync(data, size, MS_SYNC) == -1)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#else
+		if (!FlushViewOfFile(data, 0) || !FlushFileBuffers(file))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+	}
+
+	std::span<std::byte> MappedFile::getData()
+	{
+		return { data, static_cast<size_t>(size) };
+	}
+
+	std::span<const std::byte> MappedFile::getData() const
+	{
+		return { data, static_cast<size_t>(size) };
+	}
+
+	uint64_t MappedFile::getSize() const
+	{
+		return size;
+	}
+
+	MappedFile::~MappedFile()
+	{
+		this->unmap();
+	}
+}
@@ -0,0 +1,161 @@
+#include "OutputBuffer.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "WebServerException.h"
+#include "Transport.h"
+
+#ifdef __LINUX__
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#endif
+
+#ifdef MSG_MORE
+static constexpr int sendMoreFlag = MSG_MORE;
+#else
+static constexpr int sendMoreFlag = 0;
+#endif
+
+#ifdef MSG_NOSIGNAL
+static constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int sendFlags = 0;
+#endif
+
+namespace web
+{
+	void OutputBuffer::setCork(SOCKET clientSocket, bool cork)
+	{
+#ifdef TCP_CORK
+		int value = cork;
+
+		if (setsockopt(clientSocket, IPPROTO_TCP, TCP_CORK, reinterpret_cast<const char*>(&value), sizeof(value)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+	}
+
+	OutputBuffer::OutputBuffer(SOCKET clientSocket, size_t initialCapacity, size_t highWatermark) :
+		clientSocket(clientSocket),
+		highWatermark(highWatermark),
+		corked(false)
+	{
+		buffer.reserve(initialCapacity);
+	}
+
+	void OutputBuffer::write(std::string_view data)
+	{
+		buffer.append(data);
+
+		// Client that keeps pipelining never lets read batch end, so buffer is bounded here
+		if (buffer.size() >= highWatermark)
+		{
+			this->flush(true);
+		}
+	}
+
+	int OutputBuffer::flush(bool more)
+	{
+		int flags = sendFlags | (more ? sendMoreFlag : 0);
+		size_t size = buffer.size();
+		size_t totalSent = 0;
+		Transport* transport = Transport::getCurrent();
+
+		while (totalSent < size)
+		{
+			// Each call takes at most INT_MAX bytes
+			int chunkSize = static_cast<int>(std::min<size_t>(size - totalSent, INT_MAX));
+			int lastSend = transport ?
+				transport->sendBytes(clientSocket, buffer.data() + totalSent, chunkSize) :
+				send(clientSocket, buffer.data() + totalSent, chunkSize, flags);
+
+			if (lastSend == SOCKET_ERROR)
+			{
+				buffer.erase(0, totalSent);
+
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+			else if (!lastSend)
+			{
+				break;
+			}
+
+			totalSent += lastSend;
+		}
+
+		buffer.erase(0, totalSent);
+
+		return static_cast<int>(std::min<size_t>(totalSent, INT_MAX));
+	}
+
+	int OutputBuffer::flushReadBatch()
+	{
+		if (buffer.empty())
+		{
+			return 0;
+		}
+
+		if (!Transport::getCurrent() && buffer.size() < highWatermark)
+		{
+#ifdef __LINUX__
+			int available = 0;
+
+			if (ioctl(clientSocket, FIONREAD, &available) != SOCKET_ERROR && available > 0)
+#else
+			u_long available = 0;
+
+			if (ioctlsocket(clientSocket, FIONREAD, &available) != SOCKET_ERROR && available > 0)
+#endif
+			{
+				return 0;
+			}
+		}
+
+		return this->flush();
+	}
+
+	void OutputBuffer::cork()
+	{
+		if (!corked)
+		{
+			OutputBuffer::setCork(clientSocket, true);
+
+			corked = true;
+		}
+	}
+
+	void OutputBuffer::uncork()
+	{
+		this->flush();
+
+		if (corked)
+		{
+			OutputBuffer::setCork(clientSocket, false);
+
+			corked = false;
+		}
+	}
+
+	bool OutputBuffer::isCorked() const
+	{
+		return corked;
+	}
+
+	size_t OutputBuffer::size() const
+	{
+		return buffer.size();
+	}
+
+	bool OutputBuffer::empty() const
+	{
+		return buffer.empty();
+	}
+
+	void OutputBuffer::clear()
+	{
+		buffer.clear();
+	}
+}
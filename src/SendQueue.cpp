@@ -0,0 +1,540 @@
+#include "SendQueue.h"
+
+#include <algorithm>
+
+#include "WebServerException.h"
+
+#ifdef __LINUX__
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#ifdef MSG_NOSIGNAL
+static constexpr int sendFlags = MSG_NOSIGNAL | MSG_DONTWAIT;
+#elif defined(MSG_DONTWAIT)
+static constexpr int sendFlags = MSG_DONTWAIT;
+#else
+static constexpr int sendFlags = 0;
+#endif
+
+/**
+ * @brief Maximum number of chunks sent with one call
+ */
+static constexpr size_t maxBuffersPerSend = 64;
+
+/**
+ * @brief Copied data is appended to previous copied chunk while it's smaller than this size
+ */
+static constexpr size_t coalesceLimit = 64 * 1024;
+
+static bool isWouldBlock()
+{
+#ifdef __LINUX__
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
+
+namespace web
+{
+	std::string_view SendQueue::Chunk::view() const
+	{
+		std::string_view result = payload ? std::string_view(*payload) : std::string_view(data);
+
+		return result.substr(offset);
+	}
+
+	void SendQueue::sendQueued()
+	{
+		while (queuedBytes && !failed)
+		{
+			size_t count = std::min(chunks.size(), maxBuffersPerSend);
+#ifdef __LINUX__
+			iovec buffers[maxBuffersPerSend];
+
+			for (size_t i = 0; i < count; i++)
+			{
+				std::string_view data = chunks[i].view();
+
+				buffers[i].iov_base = const_cast<char*>(data.data());
+				buffers[i].iov_len = data.size();
+			}
+
+			msghdr message = {};
+
+			message.msg_iov = buffers;
+			message.msg_iovlen = count;
+
+			ssize_t sent = sendmsg(clientSocket, &message, sendFlags);
+
+			if (sent == SOCKET_ERROR && errno == EINTR)
+			{
+				continue;
+			}
+#else
+			WSABUF buffers[maxBuffersPerSend];
+
+			for (size_t i = 0; i < count; i++)
+			{
+				std::string_view data = chunks[i].view();
+
+				buffers[i].buf = const_cast<char*>(data.data());
+				buffers[i].len = static_cast<ULONG>(data.size());
+			}
+
+			DWORD sent = 0;
+
+			if (WSASend(clientSocket, buffers, static_cast<DWORD>(count), &sent, 0, nullptr, nullptr) == SOCKET_ERROR)
+			{
+				sent = static_cast<DWORD>(SOCKET_ERROR);
+			}
+#endif
+
+			if (sent == static_cast<decltype(sent)>(SOCKET_ERROR))
+			{
+				if (!isWouldBlock())
+				{
+					failed = true;
+					queuedBytes = 0;
+
+					chunks.clear();
+				}
+
+				return;
+			}
+
+			size_t remaining = static_cast<size_t>(sent);
+
+			queuedBytes -= remaining;
+
+			while (remaining)
+			{
+				Chunk& chunk = chunks.front();
+				size_t size = chunk.view().size();
+
+				if (remaining < size)
+				{
+					chunk.offset += remaining;
+
+					break;
+				}
+
+				remaining -= size;
+
+				chunks.pop_front();
+			}
+
+			while (chunks.size() && chunks.front().view().empty())
+			{
+				chunks.pop_front();
+			}
+		}
+	}
+
+	std::vector<std::function<void()>> SendQueue::afterSend()
+	{
+		std::vector<std::function<void()>> callbacks;
+
+		if (!aboveHighWatermark && queuedBytes >= highWatermark)
+		{
+			aboveHighWatermark = true;
+
+			if (onHighWatermark)
+			{
+				callbacks.push_back(onHighWatermark);
+			}
+		}
+		else if (aboveHighWatermark && (queuedBytes < lowWatermark || failed))
+		{
+			aboveHighWatermark = false;
+
+			if (onLowWatermark && !failed)
+			{
+				callbacks.push_back(onLowWatermark);
+			}
+
+			queueCondition.notify_all();
+		}
+
+		if (!queuedBytes)
+		{
+			if (onDrained)
+			{
+				callbacks.push_back(std::move(onDrained));
+
+				onDrained = nullptr;
+			}
+
+			queueCondition.notify_all();
+		}
+		else if (!scheduled && flusher)
+		{
+			scheduled = true;
+
+			callbacks.push_back([this, self = this->shared_from_this()]() mutable { flusher->schedule(std::move(self)); });
+		}
+
+		return callbacks;
+	}
+
+	bool SendQueue::enqueue(Chunk&& chunk)
+	{
+		std::vector<std::function<void()>> callbacks;
+		bool result;
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+
+			if (failed)
+			{
+				return false;
+			}
+
+			size_t size = chunk.view().size();
+
+			if (!size)
+			{
+				return !aboveHighWatermark;
+			}
+
+			if (!chunk.payload && chunks.size() && !chunks.back().payload && chunks.back().data.size() < coalesceLimit)
+			{
+				chunks.back().data.append(chunk.data);
+			}
+			else
+			{
+				chunks.push_back(std::move(chunk));
+			}
+
+			queuedBytes += size;
+
+			this->sendQueued();
+
+			callbacks = this->afterSend();
+
+			result = !aboveHighWatermark && !failed;
+		}
+
+		for (const std::function<void()>& callback : callbacks)
+		{
+			callback();
+		}
+
+		return result;
+	}
+
+	SendQueue::SendQueue(SOCKET clientSocket, SendQueueFlusher* flusher, size_t highWatermark, size_t lowWatermark) :
+		clientSocket(clientSocket),
+		flusher(flusher),
+		queuedBytes(0),
+		highWatermark(std::max<size_t>(highWatermark, 1)),
+		lowWatermark(std::min(lowWatermark, std::max<size_t>(highWatermark, 1))),
+		scheduled(false),
+		aboveHighWatermark(false),
+		failed(false)
+	{
+
+	}
+
+	bool SendQueue::enqueue(std::string_view data)
+	{
+		return this->enqueue(Chunk{ std::string(data), nullptr, 0 });
+	}
+
+	bool SendQueue::enqueue(const Payload& payload, size_t offset)
+	{
+		if (!payload || offset >= payload->size())
+		{
+			return !this->isAboveHighWatermark();
+		}
+
+		return this->enqueue(Chunk{ std::string(), payload, offset });
+	}
+
+	bool SendQueue::flush()
+	{
+		std::vector<std::function<void()>> callbacks;
+		bool result;
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+
+			this->sendQueued();
+
+			result = !queuedBytes || failed;
+
+			if (result)
+			{
+				scheduled = false;
+			}
+
+			callbacks = this->afterSend();
+		}
+
+		for (const std::function<void()>& callback : callbacks)
+		{
+			callback();
+		}
+
+		return result;
+	}
+
+	bool SendQueue::waitLowWatermark(std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+
+		return queueCondition.wait_for(lock, timeout, [this]() { return !aboveHighWatermark || failed; }) && !failed;
+	}
+
+	bool SendQueue::waitDrained(std::chrono::milliseconds timeout)
+	{
+		std::unique_lock<std::mutex> lock(queueMutex);
+
+		return queueCondition.wait_for(lock, timeout, [this]() { return !queuedBytes || failed; }) && !failed;
+	}
+
+	void SendQueue::setOnHighWatermark(const std::function<void()>& callback)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		onHighWatermark = callback;
+	}
+
+	void SendQueue::setOnLowWatermark(const std::function<void()>& callback)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		onLowWatermark = callback;
+	}
+
+	void SendQueue::closeAfterFlush(std::function<void()>&& cleanup)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+
+			if (queuedBytes)
+			{
+				onDrained = std::move(cleanup);
+
+				return;
+			}
+		}
+
+		if (cleanup)
+		{
+			cleanup();
+		}
+	}
+
+	void SendQueue::cancel()
+	{
+		std::function<void()> cleanup;
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+
+			failed = true;
+			queuedBytes = 0;
+			aboveHighWatermark = false;
+			scheduled = false;
+			cleanup = std::move(onDrained);
+			onDrained = nullptr;
+
+			chunks.clear();
+
+			queueCondition.notify_all();
+		}
+
+		if (flusher)
+		{
+			flusher->unschedule(this);
+		}
+
+		if (cleanup)
+		{
+			cleanup();
+		}
+	}
+
+	size_t SendQueue::getQueuedBytes() const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		return queuedBytes;
+	}
+
+	bool SendQueue::isAboveHighWatermark() const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		return aboveHighWatermark;
+	}
+
+	bool SendQueue::isFailed() const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		return failed;
+	}
+
+	SOCKET SendQueue::getSocket() const
+	{
+		return clientSocket;
+	}
+
+	void SendQueueFlusher::flushThread()
+	{
+#ifdef __LINUX__
+		std::vector<pollfd> descriptors;
+		constexpr size_t first = 1;
+#else
+		std::vector<WSAPOLLFD> descriptors;
+		constexpr size_t first = 0;
+#endif
+
+		while (isRunning.load(std::memory_order_acquire))
+		{
+			{
+				std::lock_guard<std::mutex> lock(scheduleMutex);
+
+				std::move(scheduledQueues.begin(), scheduledQueues.end(), std::back_inserter(queues));
+
+				scheduledQueues.clear();
+
+				// Cancelled queue is failed before unschedule, so it never writes into socket even if it's still here
+				if (hasCancelledQueues)
+				{
+					std::erase_if(queues, [](const std::shared_ptr<SendQueue>& queue) { return queue->isFailed(); });
+
+					hasCancelledQueues = false;
+				}
+			}
+
+			descriptors.resize(queues.size() + first);
+
+#ifdef __LINUX__
+			descriptors[0].fd = wakeupDescriptor;
+			descriptors[0].events = POLLIN;
+			descriptors[0].revents = 0;
+#endif
+
+			for (size_t i = 0; i < queues.size(); i++)
+			{
+				descriptors[i + first].fd = queues[i]->getSocket();
+				descriptors[i + first].events = POLLOUT;
+				descriptors[i + first].revents = 0;
+			}
+
+#ifdef __LINUX__
+			if (poll(descriptors.data(), descriptors.size(), -1) == SOCKET_ERROR)
+			{
+				continue;
+			}
+
+			if (descriptors[0].revents & POLLIN)
+			{
+				eventfd_t value;
+
+				eventfd_read(wakeupDescriptor, &value);
+			}
+#else
+			// WSAPoll can't wait for event, so newly scheduled queues are picked up by timeout
+			if (descriptors.empty())
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+				continue;
+			}
+
+			if (WSAPoll(descriptors.data(), static_cast<ULONG>(descriptors.size()), 10) == SOCKET_ERROR)
+			{
+				continue;
+			}
+#endif
+
+			for (size_t i = queues.size(); i-- > 0;)
+			{
+				if (descriptors[i + first].revents && queues[i]->flush())
+				{
+					std::swap(queues[i], queues.back());
+
+					queues.pop_back();
+				}
+			}
+		}
+	}
+
+	SendQueueFlusher::SendQueueFlusher() :
+		hasCancelledQueues(false),
+		isRunning(true)
+	{
+#ifdef __LINUX__
+		if ((wakeupDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+
+		thread = std::thread(&SendQueueFlusher::flushThread, this);
+	}
+
+	void SendQueueFlusher::schedule(std::shared_ptr<SendQueue>&& queue)
+	{
+		{
+			std::lock_guard<std::mutex> lock(scheduleMutex);
+
+			scheduledQueues.push_back(std::move(queue));
+		}
+
+#ifdef __LINUX__
+		eventfd_write(wakeupDescriptor, 1);
+#endif
+	}
+
+	void SendQueueFlusher::unschedule(const SendQueue* queue)
+	{
+		{
+			std::lock_guard<std::mutex> lock(scheduleMutex);
+
+			std::erase_if(scheduledQueues, [queue](const std::shared_ptr<SendQueue>& scheduled) { return scheduled.get() == queue; });
+
+			hasCancelledQueues = true;
+		}
+
+#ifdef __LINUX__
+		eventfd_write(wakeupDescriptor, 1);
+#endif
+	}
+
+	SendQueueFlusher::~SendQueueFlusher()
+	{
+		isRunning.store(false, std::memory_order_release);
+
+#ifdef __LINUX__
+		eventfd_write(wakeupDescriptor, 1);
+#endif
+
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+
+		std::move(scheduledQueues.begin(), scheduledQueues.end(), std::back_inserter(queues));
+
+		scheduledQueues.clear();
+
+		for (const std::shared_ptr<SendQueue>& queue : queues)
+		{
+			queue->cancel();
+		}
+
+		queues.clear();
+
+#ifdef __LINUX__
+		close(wakeupDescriptor);
+#endif
+	}
+}
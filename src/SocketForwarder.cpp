@@ -0,0 +1,351 @@
+#include "SocketForwarder.h"
+
+#include <memory>
+
+#ifdef __LINUX__
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/// @brief State of one forwarding direction
+struct Direction
+{
+	SOCKET source;
+	SOCKET destination;
+
+	/**
+	 * @brief Kernel pipe used by splice, -1 in user space copy mode
+	 */
+	int pipe[2];
+
+	std::unique_ptr<char[]> buffer;
+	size_t offset;
+
+	/**
+	 * @brief Bytes read from source and not yet written to destination
+	 */
+	size_t pending;
+
+	size_t capacity;
+	uint64_t total;
+	bool endOfStream;
+	bool shutdownSent;
+};
+
+enum class Progress
+{
+	none,
+	moved,
+	failed
+};
+
+static bool isTemporaryError()
+{
+#ifdef __LINUX__
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#else
+	return WSAGetLastError() == WSAEWOULDBLOCK || WSAGetLastError() == WSAEINTR;
+#endif
+}
+
+static void useCopyMode(Direction& direction)
+{
+#ifdef __LINUX__
+	if (direction.pipe[0] != -1)
+	{
+		close(direction.pipe[0]);
+		close(direction.pipe[1]);
+	}
+#endif
+
+	direction.pipe[0] = direction.pipe[1] = -1;
+	direction.buffer = std::make_unique<char[]>(direction.capacity);
+	direction.offset = 0;
+}
+
+static Progress fill(Direction& direction)
+{
+#ifdef __LINUX__
+	if (direction.pipe[0] != -1)
+	{
+		ssize_t size = splice(direction.source, nullptr, direction.pipe[1], nullptr, direction.capacity - direction.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+		if (size > 0)
+		{
+			direction.pending += size;
+
+			return Progress::moved;
+		}
+		else if (!size)
+		{
+			direction.endOfStream = true;
+
+			return Progress::moved;
+		}
+		else if (errno == EINVAL && !direction.pending && !direction.total)
+		{
+			// Socket type without splice support
+			useCopyMode(direction);
+		}
+		else
+		{
+			return isTemporaryError() ? Progress::none : Progress::failed;
+		}
+	}
+#endif
+
+	if (direction.pending)
+	{
+		return Progress::none;
+	}
+
+	int size = recv(direction.source, direction.buffer.get(), static_cast<int>(direction.capacity), 0);
+
+	if (size > 0)
+	{
+		direction.offset = 0;
+		direction.pending = size;
+
+		return Progress::moved;
+	}
+	else if (!size)
+	{
+		direction.endOfStream = true;
+
+		return Progress::moved;
+	}
+
+	return isTemporaryError() ? Progress::none : Progress::failed;
+}
+
+static Progress drain(Direction& direction)
+{
+#ifdef __LINUX__
+	ssize_t size = direction.pipe[0] != -1 ?
+		splice(direction.pipe[0], nullptr, direction.destination, nullptr, direction.pending, SPLICE_F_MOVE | SPLICE_F_NONBLOCK) :
+		send(direction.destination, direction.buffer.get() + direction.offset, direction.pending, MSG_NOSIGNAL);
+#else
+	int size = send(direction.destination, direction.buffer.get() + direction.offset, static_cast<int>(direction.pending), 0);
+#endif
+
+	if (size > 0)
+	{
+		direction.offset += size;
+		direction.pending -= size;
+		direction.total += size;
+
+		return Progress::moved;
+	}
+
+	return isTemporaryError() ? Progress::none : Progress::failed;
+}
+
+static void setNonBlocking(SOCKET socket, int& previousFlags)
+{
+#ifdef __LINUX__
+	previousFlags = fcntl(socket, F_GETFL);
+
+	fcntl(socket, F_SETFL, previousFlags | O_NONBLOCK);
+#else
+	u_long mode = 1;
+
+	ioctlsocket(socket, FIONBIO, &mode);
+#endif
+}
+
+static void restoreBlockingMode(SOCKET socket, int previousFlags)
+{
+#ifdef __LINUX__
+	fcntl(socket, F_SETFL, previousFlags);
+#else
+	u_long mode = 0;
+
+	ioctlsocket(socket, FIONBIO, &mode);
+#endif
+}
+
+namespace web
+{
+	SocketForwarder::Result SocketForwarder::forward(SOCKET first, SOCKET second, std::chrono::milliseconds idleTimeout, size_t bufferSize)
+	{
+		Result result = {};
+		Direction directions[2] = {};
+		int previousFlags[2] = {};
+
+		directions[0].source = directions[1].destination = first;
+		directions[0].destination = directions[1].source = second;
+
+		for (Direction& direction : directions)
+		{
+			direction.capacity = bufferSize ? bufferSize : 64 * 1024;
+			direction.pipe[0] = direction.pipe[1] = -1;
+
+#ifdef __LINUX__
+			if (pipe2(direction.pipe, O_NONBLOCK | O_CLOEXEC) == SOCKET_ERROR)
+			{
+				useCopyMode(direction);
+			}
+			else if (int size = fcntl(direction.pipe[1], F_SETPIPE_SZ, static_cast<int>(direction.capacity)); size > 0)
+			{
+				direction.capacity = size;
+			}
+			else if ((size = fcntl(direction.pipe[1], F_GETPIPE_SZ)) > 0)
+			{
+				direction.capacity = size;
+			}
+#else
+			useCopyMode(direction);
+#endif
+		}
+
+		setNonBlocking(first, previousFlags[0]);
+		setNonBlocking(second, previousFlags[1]);
+
+#ifdef __LINUX__
+		// splice into socket doesn't accept MSG_NOSIGNAL, so SIGPIPE of reset connection is blocked and discarded
+		sigset_t pipeSignal;
+		sigset_t previousSignals;
+
+		sigemptyset(&pipeSignal);
+		sigaddset(&pipeSignal, SIGPIPE);
+
+		pthread_sigmask(SIG_BLOCK, &pipeSignal, &previousSignals);
+#endif
+
+		std::chrono::steady_clock::time_point lastActivity = std::chrono::steady_clock::now();
+
+		while (!directions[0].shutdownSent || !directions[1].shutdownSent)
+		{
+			bool progress = false;
+
+			for (Direction& direction : directions)
+			{
+				if (!direction.endOfStream && direction.pending < direction.capacity)
+				{
+					Progress state = fill(direction);
+
+					result.failed |= state == Progress::failed;
+					progress |= state == Progress::moved;
+				}
+
+				if (direction.pending)
+				{
+					Progress state = drain(direction);
+
+					result.failed |= state == Progress::failed;
+					progress |= state == Progress::moved;
+				}
+
+				if (direction.endOfStream && !direction.pending && !direction.shutdownSent)
+				{
+#ifdef __LINUX__
+					shutdown(direction.destination, SHUT_WR);
+#else
+					shutdown(direction.destination, SD_SEND);
+#endif
+
+					direction.shutdownSent = true;
+					progress = true;
+				}
+			}
+
+			if (result.failed)
+			{
+				break;
+			}
+
+			if (progress)
+			{
+				lastActivity = std::chrono::steady_clock::now();
+
+				continue;
+			}
+
+			int timeout = -1;
+
+			if (idleTimeout.count())
+			{
+				int64_t remaining = std::chrono::duration_cast<std::chrono::milliseconds>(lastActivity + idleTimeout - std::chrono::steady_clock::now()).count();
+
+				if (remaining <= 0)
+				{
+					result.timedOut = true;
+
+					break;
+				}
+
+				timeout = static_cast<int>(remaining);
+			}
+
+#ifdef __LINUX__
+			pollfd descriptors[2] = {};
+#else
+			WSAPOLLFD descriptors[2] = {};
+#endif
+			short events[2] = {};
+			unsigned long numberOfDescriptors = 0;
+
+			for (size_t i = 0; i < 2; i++)
+			{
+				if (!directions[i].endOfStream && directions[i].pending < directions[i].capacity)
+				{
+					events[i] |= POLLIN;
+				}
+
+				if (directions[i].pending)
+				{
+					events[1 - i] |= POLLOUT;
+				}
+			}
+
+			// Sockets without requested events are excluded, otherwise POLLHUP of finished side wakes poll forever
+			for (size_t i = 0; i < 2; i++)
+			{
+				if (events[i])
+				{
+					descriptors[numberOfDescriptors].fd = i ? second : first;
+					descriptors[numberOfDescriptors].events = events[i];
+
+					numberOfDescriptors++;
+				}
+			}
+
+#ifdef __LINUX__
+			poll(descriptors, numberOfDescriptors, timeout);
+#else
+			WSAPoll(descriptors, numberOfDescriptors, timeout);
+#endif
+		}
+
+#ifdef __LINUX__
+		timespec noWait = {};
+
+		while (sigtimedwait(&pipeSignal, nullptr, &noWait) > 0);
+
+		pthread_sigmask(SIG_SETMASK, &previousSignals, nullptr);
+#endif
+
+		restoreBlockingMode(first, previousFlags[0]);
+		restoreBlockingMode(second, previousFlags[1]);
+
+		result.firstToSecondBytes = directions[0].total;
+		result.secondToFirstBytes = directions[1].total;
+		result.zeroCopy = directions[0].pipe[0] != -1 && directions[1].pipe[0] != -1;
+
+#ifdef __LINUX__
+		for (Direction& direction : directions)
+		{
+			if (direction.pipe[0] != -1)
+			{
+				close(direction.pipe[0]);
+				close(direction.pipe[1]);
+			}
+		}
+#endif
+
+		return result;
+	}
+}
@@ -0,0 +1,133 @@
+#include "SocketReaper.h"
+
+#ifdef __LINUX__
+#include <unistd.h>
+#endif
+
+namespace web
+{
+	void SocketReaper::shutdownSocket(SOCKET socket)
+	{
+#ifdef __LINUX__
+		shutdown(socket, SHUT_RDWR);
+#else
+		shutdown(socket, SD_BOTH);
+#endif
+	}
+
+	void SocketReaper::reaperThread()
+	{
+		std::vector<SOCKET> batch;
+		std::unique_lock<std::mutex> lock(reaperMutex);
+
+		while (true)
+		{
+			reaperCondition.wait(lock, [this]() { return pendingSockets.size() || !isRunning; });
+
+			if (pendingSockets.empty())
+			{
+				break;
+			}
+
+			// More sockets are collected into batch during delay, stop closes without delay
+			reaperCondition.wait_for(lock, closeDelay, [this]() { return !isRunning; });
+
+			batch.swap(pendingSockets);
+
+			closing = true;
+
+			lock.unlock();
+
+			for (SOCKET socket : batch)
+			{
+				closesocket(socket);
+			}
+
+			closedSockets.fetch_add(batch.size(), std::memory_order_relaxed);
+
+			batch.clear();
+
+			lock.lock();
+
+			closing = false;
+
+			if (pendingSockets.empty())
+			{
+				idleCondition.notify_all();
+			}
+		}
+	}
+
+	SocketReaper::SocketReaper(std::chrono::milliseconds closeDelay) :
+		closeDelay(closeDelay),
+		closedSockets(0),
+		isRunning(true),
+		closing(false)
+	{
+		thread = std::thread(&SocketReaper::reaperThread, this);
+	}
+
+	void SocketReaper::reap(SOCKET socket)
+	{
+		SocketReaper::shutdownSocket(socket);
+
+		{
+			std::lock_guard<std::mutex> lock(reaperMutex);
+
+			pendingSockets.push_back(socket);
+		}
+
+		reaperCondition.notify_one();
+	}
+
+	void SocketReaper::reap(const std::vector<SOCKET>& sockets)
+	{
+		for (SOCKET socket : sockets)
+		{
+			SocketReaper::shutdownSocket(socket);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(reaperMutex);
+
+			pendingSockets.insert(pendingSockets.end(), sockets.begin(), sockets.end());
+		}
+
+		reaperCondition.notify_one();
+	}
+
+	void SocketReaper::waitIdle()
+	{
+		std::unique_lock<std::mutex> lock(reaperMutex);
+
+		idleCondition.wait(lock, [this]() { return pendingSockets.empty() && !closing; });
+	}
+
+	size_t SocketReaper::getNumberOfPendingSockets() const
+	{
+		std::lock_guard<std::mutex> lock(reaperMutex);
+
+		return pendingSockets.size();
+	}
+
+	uint64_t SocketReaper::getNumberOfClosedSockets() const
+	{
+		return closedSockets.load(std::memory_order_relaxed);
+	}
+
+	SocketReaper::~SocketReaper()
+	{
+		{
+			std::lock_guard<std::mutex> lock(reaperMutex);
+
+			isRunning = false;
+		}
+
+		reaperCondition.notify_all();
+
+		if (thread.joinable())
+		{
+			thread.join();
+		}
+	}
+}
@@ -0,0 +1,126 @@
+#include "StaticTCPServer.h"
+
+#ifdef __LINUX__
+#include <sys/time.h>
+#endif
+
+namespace web::policies
+{
+	ThreadPool::ThreadPool(size_t numberOfWorkers) :
+		threadPool(numberOfWorkers)
+	{
+
+	}
+
+	const WorkStealingThreadPool& ThreadPool::getThreadPool() const
+	{
+		return threadPool;
+	}
+
+	void SocketIO::initialize()
+	{
+#ifndef __LINUX__
+		WSADATA wsaData;
+
+		if (WSAStartup(MAKEWORD(2, 2), &wsaData))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+#endif
+	}
+
+	void SocketIO::cleanup()
+	{
+#ifndef __LINUX__
+		WSACleanup();
+#endif
+	}
+
+	SOCKET SocketIO::createListenSocket(std::string_view ip, std::string_view port)
+	{
+		addrinfo* info = nullptr;
+		addrinfo hints = {};
+		SOCKET result = INVALID_SOCKET;
+		int yes = 1;
+
+		hints.ai_family = AF_INET;
+		hints.ai_flags = AI_PASSIVE;
+		hints.ai_protocol = IPPROTO_TCP;
+		hints.ai_socktype = SOCK_STREAM;
+
+		if (getaddrinfo(std::string(ip).data(), std::string(port).data(), &hints, &info))
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if ((result = socket(info->ai_family, info->ai_socktype, info->ai_protocol)) == INVALID_SOCKET)
+		{
+			freeaddrinfo(info);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		if (setsockopt(result, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes)) == SOCKET_ERROR ||
+			bind(result, info->ai_addr, static_cast<int>(info->ai_addrlen)) == SOCKET_ERROR ||
+			listen(result, SOMAXCONN) == SOCKET_ERROR)
+		{
+			freeaddrinfo(info);
+
+			closesocket(result);
+
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		freeaddrinfo(info);
+
+		return result;
+	}
+
+	SOCKET SocketIO::accept(SOCKET listenSocket, sockaddr& address)
+	{
+#ifdef __LINUX__
+		socklen_t addrlen = sizeof(sockaddr);
+#else
+		int addrlen = sizeof(sockaddr);
+#endif
+
+		return ::accept(listenSocket, &address, &addrlen);
+	}
+
+	void SocketIO::configure(SOCKET clientSocket, DWORD timeout)
+	{
+		if (!timeout)
+		{
+			return;
+		}
+
+#ifdef __LINUX__
+		timeval timeoutValue;
+
+		timeoutValue.tv_sec = timeout / 1000;
+		timeoutValue.tv_usec = (timeout - timeoutValue.tv_sec * 1000) * 1000;
+#else
+		DWORD timeoutValue = timeout;
+#endif
+
+		if (setsockopt(clientSocket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&timeoutValue), sizeof(timeoutValue)) == SOCKET_ERROR ||
+			setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&timeoutValue), sizeof(timeoutValue)) == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+	}
+
+	void SocketIO::closeListenSocket(SOCKET listenSocket)
+	{
+#ifdef __LINUX__
+		shutdown(listenSocket, SHUT_RDWR);
+#endif
+
+		closesocket(listenSocket);
+	}
+
+	void SocketIO::closeSocket(SOCKET clientSocket)
+	{
+		closesocket(clientSocket);
+	}
+}
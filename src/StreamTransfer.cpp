@@ -0,0 +1,238 @@
+#include "StreamTransfer.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "Transport.h"
+#include "WebServerException.h"
+
+#ifdef __LINUX__
+#include <fcntl.h>
+#include <poll.h>
+#include <cerrno>
+#endif
+
+static constexpr size_t minChunkSize = 64 * 1024;
+static constexpr size_t maxChunkSize = 16 * 1024 * 1024;
+
+static bool isWouldBlock()
+{
+#ifdef __LINUX__
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#else
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#endif
+}
+
+static bool isInterrupted()
+{
+#ifdef __LINUX__
+	return errno == EINTR;
+#else
+	return WSAGetLastError() == WSAEINTR;
+#endif
+}
+
+/**
+ * @brief On Linux EAGAIN of blocking socket means SO_RCVTIMEO or SO_SNDTIMEO expired, only non blocking sockets are waited. Windows reports timeout with WSAETIMEDOUT
+ */
+static bool isNonBlocking(SOCKET socket)
+{
+#ifdef __LINUX__
+	int flags = fcntl(socket, F_GETFL, 0);
+
+	return flags != -1 && (flags & O_NONBLOCK);
+#else
+	return true;
+#endif
+}
+
+static void waitSocket(SOCKET socket, bool write)
+{
+#ifdef __LINUX__
+	pollfd descriptor = { socket, static_cast<short>(write ? POLLOUT : POLLIN), 0 };
+
+	poll(&descriptor, 1, -1);
+#else
+	WSAPOLLFD descriptor = { socket, static_cast<short>(write ? POLLWRNORM : POLLRDNORM), 0 };
+
+	WSAPoll(&descriptor, 1, -1);
+#endif
+}
+
+static void shutdownSocket(SOCKET socket)
+{
+#ifdef __LINUX__
+	shutdown(socket, SHUT_RDWR);
+#else
+	shutdown(socket, SD_BOTH);
+#endif
+}
+
+/**
+ * @brief Call operation until total bytes are transferred
+ * @param transport Transport of current thread, socket may be not kernel socket then
+ * @param operation Transfers up to size bytes starting from offset, returns send or recv result
+ */
+template<typename OperationT>
+static web::StreamTransfer::Result transfer(SOCKET socket, web::Transport* transport, uint64_t total, size_t chunkSize, const web::StreamTransfer::Options& options, bool write, OperationT&& operation)
+{
+	web::StreamTransfer::Result result = {};
+	bool nonBlocking = !transport && isNonBlocking(socket);
+	auto shutdownOnStop = [socket]() { shutdownSocket(socket); };
+	std::optional<std::stop_callback<decltype(shutdownOnStop)>> cancel;
+
+	// Transport's socket may not be kernel socket, so stop request is only checked between chunks
+	if (!transport)
+	{
+		cancel.emplace(options.stopToken, shutdownOnStop);
+	}
+
+	while (result.transferred < total)
+	{
+		if (options.stopToken.stop_requested())
+		{
+			result.cancelled = true;
+
+			break;
+		}
+
+		size_t size = static_cast<size_t>(std::min<uint64_t>(chunkSize, total - result.transferred));
+		int64_t count = operation(result.transferred, size);
+
+		if (count > 0)
+		{
+			result.transferred += count;
+
+			if (options.onProgress)
+			{
+				options.onProgress(result.transferred, total);
+			}
+
+			continue;
+		}
+
+		// Shutdown by stop request looks like EOF or broken pipe
+		if (options.stopToken.stop_requested())
+		{
+			result.cancelled = true;
+
+			break;
+		}
+
+		if (!count)
+		{
+			result.endOfStream = true;
+
+			break;
+		}
+
+		if (isInterrupted())
+		{
+			continue;
+		}
+
+		if (nonBlocking && isWouldBlock())
+		{
+			waitSocket(socket, write);
+
+			continue;
+		}
+
+		THROW_WEB_SERVER_EXCEPTION;
+	}
+
+	result.completed = result.transferred == total;
+
+	return result;
+}
+
+namespace web
+{
+	size_t StreamTransfer::getChunkSize(SOCKET socket, int bufferOption, const Options& options)
+	{
+		if (options.chunkSize)
+		{
+			return std::min(options.chunkSize, maxChunkSize);
+		}
+
+		if (Transport::getCurrent())
+		{
+			return minChunkSize;
+		}
+
+		int bufferSize = 0;
+#ifdef __LINUX__
+		socklen_t length = sizeof(bufferSize);
+#else
+		int length = sizeof(bufferSize);
+#endif
+
+		if (getsockopt(socket, SOL_SOCKET, bufferOption, reinterpret_cast<char*>(&bufferSize), &length) == SOCKET_ERROR || bufferSize <= 0)
+		{
+			return minChunkSize;
+		}
+
+		return std::clamp(static_cast<size_t>(bufferSize), minChunkSize, maxChunkSize);
+	}
+
+	StreamTransfer::Result StreamTransfer::send(SOCKET socket, std::span<const std::byte> data, const Options& options)
+	{
+		const char* source = reinterpret_cast<const char*>(data.data());
+		Transport* transport = Transport::getCurrent();
+
+		return transfer
+		(
+			socket, transport, data.size(), StreamTransfer::getChunkSize(socket, SO_SNDBUF, options), options, true,
+			[socket, source, transport](uint64_t offset, size_t size) -> int64_t
+			{
+				if (transport)
+				{
+					return transport->sendBytes(socket, source + offset, static_cast<int>(size));
+				}
+
+#ifdef __LINUX__
+				return ::send(socket, source + offset, size, MSG_NOSIGNAL);
+#else
+				return ::send(socket, source + offset, static_cast<int>(size), 0);
+#endif
+			}
+		);
+	}
+
+	StreamTransfer::Result StreamTransfer::send(SOCKET socket, std::span<const std::byte> data)
+	{
+		return StreamTransfer::send(socket, data, Options());
+	}
+
+	StreamTransfer::Result StreamTransfer::receive(SOCKET socket, std::span<std::byte> destination, const Options& options)
+	{
+		char* target = reinterpret_cast<char*>(destination.data());
+		Transport* transport = Transport::getCurrent();
+
+		return transfer
+		(
+			socket, transport, destination.size(), StreamTransfer::getChunkSize(socket, SO_RCVBUF, options), options, false,
+			[socket, target, transport](uint64_t offset, size_t size) -> int64_t
+			{
+				if (transport)
+				{
+					return transport->receiveBytes(socket, target + offset, static_cast<int>(size));
+				}
+
+#ifdef __LINUX__
+				// Whole chunk per call for blocking sockets, partial chunk is returned on EOF, timeout or shutdown
+				return recv(socket, target + offset, size, MSG_WAITALL);
+#else
+				// MSG_WAITALL fails on non blocking sockets and blocking mode can't be queried
+				return recv(socket, target + offset, static_cast<int>(size), 0);
+#endif
+			}
+		);
+	}
+
+	StreamTransfer::Result StreamTransfer::receive(SOCKET socket, std::span<std::byte> destination)
+	{
+		return StreamTransfer::receive(socket, destination, Options());
+	}
+}
@@ -0,0 +1,367 @@
+#include "TlsConnection.h"
+
+#include <format>
+#include <stdexcept>
+#include <cstring>
+
+#include <openssl/err.h>
+
+#ifdef __LINUX__
+#include <poll.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
+#include "WebServerException.h"
+
+#ifdef MSG_NOSIGNAL
+static constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+static constexpr int sendFlags = 0;
+#endif
+
+static constexpr size_t sendFileChunkSize = 16 * 1024;
+
+static std::string getOpenSSLError()
+{
+	std::string result(256, '\0');
+
+	ERR_error_string_n(ERR_get_error(), result.data(), result.size());
+
+	result.resize(strlen(result.data()));
+
+	return result;
+}
+
+namespace web
+{
+	TlsContext::TlsContext(std::string_view certificatePath, std::string_view privateKeyPath, bool kernelTls) :
+		context(SSL_CTX_new(TLS_server_method()))
+	{
+		if (!context)
+		{
+			throw std::runtime_error(std::format("Can't create TLS context: {}", getOpenSSLError()));
+		}
+
+		if (kernelTls)
+		{
+			SSL_CTX_set_options(context, SSL_OP_ENABLE_KTLS);
+		}
+
+		if (SSL_CTX_use_certificate_chain_file(context, std::string(certificatePath).data()) != 1 ||
+			SSL_CTX_use_PrivateKey_file(context, std::string(privateKeyPath).data(), SSL_FILETYPE_PEM) != 1 ||
+			SSL_CTX_check_private_key(context) != 1)
+		{
+			std::string error = getOpenSSLError();
+
+			SSL_CTX_free(context);
+
+			throw std::runtime_error(std::format("Can't load certificate or private key: {}", error));
+		}
+	}
+
+	SSL_CTX* TlsContext::getContext() const
+	{
+		return context;
+	}
+
+	TlsContext::~TlsContext()
+	{
+		SSL_CTX_free(context);
+	}
+
+	void TlsConnection::waitSocket(SOCKET clientSocket, int error)
+	{
+		pollfd descriptor = {};
+
+		descriptor.fd = clientSocket;
+		descriptor.events = error == SSL_ERROR_WANT_READ ? POLLIN : POLLOUT;
+
+#ifdef __LINUX__
+		if (poll(&descriptor, 1, -1) == SOCKET_ERROR)
+#else
+		if (WSAPoll(&descriptor, 1, -1) == SOCKET_ERROR)
+#endif
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+	}
+
+	void TlsConnection::throwTlsError(int error)
+	{
+		if (error == SSL_ERROR_SYSCALL)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		throw std::runtime_error(std::format("TLS error '{}' with description '{}'", error, getOpenSSLError()));
+	}
+
+	int TlsConnection::send(const char* data, int size)
+	{
+		int totalSent = 0;
+
+#ifdef __LINUX__
+		if (kernelSend)
+		{
+			while (totalSent < size)
+			{
+				int lastSend = static_cast<int>(::send(clientSocket, data + totalSent, size - totalSent, sendFlags));
+
+				if (lastSend == SOCKET_ERROR)
+				{
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+					{
+						TlsConnection::waitSocket(clientSocket, SSL_ERROR_WANT_WRITE);
+
+						continue;
+					}
+
+					THROW_WEB_SERVER_EXCEPTION;
+				}
+				else if (!lastSend)
+				{
+					break;
+				}
+
+				totalSent += lastSend;
+			}
+
+			return totalSent;
+		}
+#endif
+
+		while (totalSent < size)
+		{
+			size_t written = 0;
+
+			if (SSL_write_ex(ssl.get(), data + totalSent, size - totalSent, &written))
+			{
+				totalSent += static_cast<int>(written);
+
+				continue;
+			}
+
+			int error = SSL_get_error(ssl.get(), 0);
+
+			if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+			{
+				TlsConnection::waitSocket(clientSocket, error);
+			}
+			else if (error == SSL_ERROR_ZERO_RETURN)
+			{
+				break;
+			}
+			else
+			{
+				TlsConnection::throwTlsError(error);
+			}
+		}
+
+		return totalSent;
+	}
+
+	int TlsConnection::receive(char* data, int size)
+	{
+		while (true)
+		{
+			size_t read = 0;
+
+			if (SSL_read_ex(ssl.get(), data, size, &read))
+			{
+				return static_cast<int>(read);
+			}
+
+			int error = SSL_get_error(ssl.get(), 0);
+
+			if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+			{
+				TlsConnection::waitSocket(clientSocket, error);
+			}
+			else if (error == SSL_ERROR_ZERO_RETURN || (error == SSL_ERROR_SYSCALL && !errno))
+			{
+				return 0;
+			}
+			else
+			{
+				TlsConnection::throwTlsError(error);
+			}
+		}
+	}
+
+	TlsConnection::TlsConnection(const TlsContext& context, SOCKET clientSocket) :
+		ssl(SSL_new(context.getContext()), &SSL_free),
+		clientSocket(clientSocket),
+		kernelSend(false),
+		kernelReceive(false)
+	{
+		if (!ssl)
+		{
+			TlsConnection::throwTlsError(SSL_ERROR_SSL);
+		}
+
+		SSL_set_fd(ssl.get(), static_cast<int>(clientSocket));
+
+		while (true)
+		{
+			int result = SSL_accept(ssl.get());
+
+			if (result == 1)
+			{
+				break;
+			}
+
+			int error = SSL_get_error(ssl.get(), result);
+
+			if (error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE)
+			{
+				TlsConnection::waitSocket(clientSocket, error);
+
+				continue;
+			}
+
+			TlsConnection::throwTlsError(error);
+		}
+
+		kernelSend = BIO_get_ktls_send(SSL_get_wbio(ssl.get()));
+		kernelReceive = BIO_get_ktls_recv(SSL_get_rbio(ssl.get()));
+	}
+
+	int64_t TlsConnection::sendFile(int fileDescriptor, int64_t offset, size_t size)
+	{
+		int64_t totalSent = 0;
+
+		if (kernelSend)
+		{
+			while (static_cast<size_t>(totalSent) < size)
+			{
+				ossl_ssize_t lastSend = SSL_sendfile(ssl.get(), fileDescriptor, offset + totalSent, size - totalSent, 0);
+
+				if (lastSend < 0)
+				{
+					int error = SSL_get_error(ssl.get(), static_cast<int>(lastSend));
+
+					if (error == SSL_ERROR_WANT_WRITE)
+					{
+						TlsConnection::waitSocket(clientSocket, error);
+
+						continue;
+					}
+
+					TlsConnection::throwTlsError(error);
+				}
+				else if (!lastSend)
+				{
+					break;
+				}
+
+				totalSent += lastSend;
+			}
+
+			return totalSent;
+		}
+
+		std::string buffer(sendFileChunkSize, '\0');
+
+		while (static_cast<size_t>(totalSent) < size)
+		{
+			int chunkSize = static_cast<int>(std::min(sendFileChunkSize, size - static_cast<size_t>(totalSent)));
+#ifdef __LINUX__
+			int lastRead = static_cast<int>(pread(fileDescriptor, buffer.data(), chunkSize, offset + totalSent));
+#else
+			int lastRead = _lseeki64(fileDescriptor, offset + totalSent, SEEK_SET) == -1 ? -1 : _read(fileDescriptor, buffer.data(), chunkSize);
+#endif
+
+			if (lastRead == -1)
+			{
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+			else if (!lastRead)
+			{
+				break;
+			}
+
+			int lastSend = this->send(buffer.data(), lastRead);
+
+			totalSent += lastSend;
+
+			if (lastSend != lastRead)
+			{
+				break;
+			}
+		}
+
+		return totalSent;
+	}
+
+	bool TlsConnection::isKernelTlsSend() const
+	{
+		return kernelSend;
+	}
+
+	bool TlsConnection::isKernelTlsReceive() const
+	{
+		return kernelReceive;
+	}
+
+	int TlsConnection::sendBytes(SOCKET socket, const char* data, int size)
+	{
+		if (socket == clientSocket)
+		{
+			return this->send(data, size);
+		}
+
+		int totalSent = 0;
+
+		while (totalSent < size)
+		{
+			int lastSend = static_cast<int>(::send(socket, data + totalSent, size - totalSent, sendFlags));
+
+			if (lastSend == SOCKET_ERROR)
+			{
+				THROW_WEB_SERVER_EXCEPTION;
+			}
+			else if (!lastSend)
+			{
+				break;
+			}
+
+			totalSent += lastSend;
+		}
+
+		return totalSent;
+	}
+
+	int TlsConnection::receiveBytes(SOCKET socket, char* data, int size)
+	{
+		if (socket == clientSocket)
+		{
+			return this->receive(data, size);
+		}
+
+		int lastReceive = static_cast<int>(recv(socket, data, size, 0));
+
+		if (lastReceive == SOCKET_ERROR)
+		{
+			THROW_WEB_SERVER_EXCEPTION;
+		}
+
+		return lastReceive;
+	}
+
+	SSL* TlsConnection::getSSL() const
+	{
+		return ssl.get();
+	}
+
+	SOCKET TlsConnection::getSocket() const
+	{
+		return clientSocket;
+	}
+
+	TlsConnection::~TlsConnection()
+	{
+		SSL_shutdown(ssl.get());
+	}
+}
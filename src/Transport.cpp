@@ -0,0 +1,17 @@
+#include "Transport.h"
+
+namespace web
+{
+	thread_local Transport* Transport::current = nullptr;
+
+	Transport::Scope::Scope(Transport& transport) :
+		previous(Transport::current)
+	{
+		Transport::current = &transport;
+	}
+
+	Transport::Scope::~Scope()
+	{
+		Transport::current = previous;
+	}
+}
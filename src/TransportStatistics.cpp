@@ -0,0 +1,212 @@
+#include "TransportStatistics.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
+
+#ifdef __LINUX__
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <linux/sockios.h>
+#include <linux/tcp.h>
+#else
+#include <mstcpip.h>
+#endif
+
+#ifdef __LINUX__
+/**
+ * @brief Kernel fills only fields it knows and returns filled length, so fields added by newer kernels are checked separately
+ * @param length Length returned by getsockopt
+ * @param offset Field offset in tcp_info
+ * @param size Field size
+ */
+static bool isTcpInfoFieldFilled(socklen_t length, size_t offset, size_t size)
+{
+	return length >= offset + size;
+}
+#endif
+
+namespace web
+{
+	double TransportStatistics::ClientStatistics::getAverageRttMicroseconds() const
+	{
+		return samples ? static_cast<double>(rttSumMicroseconds) / samples : 0.0;
+	}
+
+	double TransportStatistics::ClientStatistics::getRetransmitRate() const
+	{
+		return sentSegments ? static_cast<double>(retransmittedSegments) / sentSegments : 0.0;
+	}
+
+	bool TransportStatistics::sample(SOCKET clientSocket, TransportInfo& info)
+	{
+		info = {};
+
+#ifdef __LINUX__
+		tcp_info tcpInfo = {};
+		socklen_t length = sizeof(tcpInfo);
+
+		if (getsockopt(clientSocket, IPPROTO_TCP, TCP_INFO, &tcpInfo, &length) == SOCKET_ERROR || !isTcpInfoFieldFilled(length, offsetof(tcp_info, tcpi_total_retrans), sizeof(tcpInfo.tcpi_total_retrans)))
+		{
+			return false;
+		}
+
+		info.rttMicroseconds = tcpInfo.tcpi_rtt;
+		info.rttVarianceMicroseconds = tcpInfo.tcpi_rttvar;
+		info.congestionWindowBytes = tcpInfo.tcpi_snd_cwnd * tcpInfo.tcpi_snd_mss;
+		info.retransmittedSegments = tcpInfo.tcpi_total_retrans;
+
+		if (isTcpInfoFieldFilled(length, offsetof(tcp_info, tcpi_segs_out), sizeof(tcpInfo.tcpi_segs_out)))
+		{
+			info.sentSegments = tcpInfo.tcpi_segs_out;
+		}
+
+		info.minRttMicroseconds = isTcpInfoFieldFilled(length, offsetof(tcp_info, tcpi_min_rtt), sizeof(tcpInfo.tcpi_min_rtt)) ? tcpInfo.tcpi_min_rtt : tcpInfo.tcpi_rtt;
+
+		int sendQueueBytes = 0;
+
+		if (ioctl(clientSocket, SIOCOUTQ, &sendQueueBytes) != SOCKET_ERROR)
+		{
+			info.sendQueueBytes = static_cast<uint32_t>(sendQueueBytes);
+		}
+#else
+		DWORD version = 0;
+		TCP_INFO_v0 tcpInfo = {};
+		DWORD bytesReturned = 0;
+
+		if (WSAIoctl(clientSocket, SIO_TCP_INFO, &version, sizeof(version), &tcpInfo, sizeof(tcpInfo), &bytesReturned, nullptr, nullptr) == SOCKET_ERROR)
+		{
+			return false;
+		}
+
+		ULONG mss = std::max<ULONG>(tcpInfo.Mss, 1);
+
+		info.rttMicroseconds = tcpInfo.RttUs;
+		info.minRttMicroseconds = tcpInfo.MinRttUs;
+		info.congestionWindowBytes = tcpInfo.Cwnd;
+		info.retransmittedSegments = tcpInfo.BytesRetrans / mss;
+		info.sentSegments = tcpInfo.BytesOut / mss;
+		info.sendQueueBytes = tcpInfo.BytesInFlight;
+#endif
+
+		return true;
+	}
+
+	TransportStatistics::TransportStatistics(size_t maxClients, uint64_t idleRounds) :
+		rttHistogram(),
+		maxClients(maxClients),
+		idleRounds(std::max<uint64_t>(idleRounds, 1)),
+		round(0)
+	{
+
+	}
+
+	void TransportStatistics::add(const std::vector<Sample>& samples)
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+
+		round++;
+
+		for (auto& [ip, statistics] : clients)
+		{
+			statistics.sendQueueBytes = 0;
+		}
+
+		for (const Sample& sample : samples)
+		{
+			const TransportInfo& info = sample.info;
+			auto it = clients.find(sample.ip);
+
+			if (it == clients.end())
+			{
+				std::string other(TransportStatistics::otherClients);
+
+				it = clients.size() - clients.count(other) < maxClients ? clients.try_emplace(sample.ip).first : clients.try_emplace(std::move(other)).first;
+			}
+
+			ClientStatistics& client = it->second;
+			ConnectionState& connection = connections.try_emplace(sample.clientSocket, ConnectionState{ 0, 0, round }).first->second;
+
+			// Smaller counters mean that socket descriptor was reused by new connection
+			if (connection.round + 1 < round || info.sentSegments < connection.sentSegments || info.retransmittedSegments < connection.retransmittedSegments)
+			{
+				connection = { 0, 0, round };
+			}
+
+			client.samples++;
+			client.rttSumMicroseconds += info.rttMicroseconds;
+			client.maxRttMicroseconds = std::max(client.maxRttMicroseconds, info.rttMicroseconds);
+			client.retransmittedSegments += info.retransmittedSegments - connection.retransmittedSegments;
+			client.sentSegments += info.sentSegments - connection.sentSegments;
+			client.sendQueueBytes += info.sendQueueBytes;
+			client.lastRound = round;
+
+			connection.retransmittedSegments = info.retransmittedSegments;
+			connection.sentSegments = info.sentSegments;
+			connection.round = round;
+
+			rttHistogram[std::min<size_t>(std::bit_width(info.rttMicroseconds), numberOfRttBuckets - 1)]++;
+		}
+
+		std::erase_if(connections, [this](const auto& connection) { return connection.second.round != round; });
+		std::erase_if(clients, [this](const auto& client) { return client.second.lastRound + idleRounds <= round; });
+	}
+
+	std::array<uint64_t, TransportStatistics::numberOfRttBuckets> TransportStatistics::getRttHistogram() const
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+
+		return rttHistogram;
+	}
+
+	uint32_t TransportStatistics::getRttPercentile(double percentile) const
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+		uint64_t total = std::accumulate(rttHistogram.begin(), rttHistogram.end(), uint64_t(0));
+
+		if (!total)
+		{
+			return 0;
+		}
+
+		uint64_t rank = static_cast<uint64_t>(std::clamp(percentile, 0.0, 100.0) / 100.0 * total);
+		uint64_t count = 0;
+
+		for (size_t i = 0; i < numberOfRttBuckets; i++)
+		{
+			count += rttHistogram[i];
+
+			if (count > rank || count == total)
+			{
+				return i ? static_cast<uint32_t>((uint64_t(1) << i) - 1) : 0;
+			}
+		}
+
+		return UINT32_MAX;
+	}
+
+	std::unordered_map<std::string, TransportStatistics::ClientStatistics> TransportStatistics::getClients() const
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+
+		return clients;
+	}
+
+	uint64_t TransportStatistics::getNumberOfSamples() const
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+
+		return std::accumulate(rttHistogram.begin(), rttHistogram.end(), uint64_t(0));
+	}
+
+	void TransportStatistics::clear()
+	{
+		std::lock_guard<std::mutex> lock(statisticsMutex);
+
+		rttHistogram.fill(0);
+		clients.clear();
+		connections.clear();
+	}
+}
@@ -0,0 +1,472 @@
+#include "WorkStealingThreadPool.h"
+
+#include <stdexcept>
+
+#ifdef __LINUX__
+#include <time.h>
+#else
+#include <Windows.h>
+#endif
+
+static constexpr size_t initialQueueCapacity = 64;
+
+/**
+ * @brief Worker utilization above which long handlers mean that pool is blocked
+ */
+static constexpr double busyUtilization = 0.9;
+
+/**
+ * @brief Worker utilization below which pool without queued tasks is idle
+ */
+static constexpr double idleUtilization = 0.5;
+
+static thread_local const web::WorkStealingThreadPool* currentPool = nullptr;
+static thread_local size_t currentWorkerIndex = 0;
+
+static std::chrono::nanoseconds getProcessCpuTime()
+{
+#ifdef __LINUX__
+	timespec time = {};
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+
+	return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+#else
+	FILETIME creationTime;
+	FILETIME exitTime;
+	FILETIME kernelTime;
+	FILETIME userTime;
+
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		return std::chrono::nanoseconds(0);
+	}
+
+	uint64_t kernel = (static_cast<uint64_t>(kernelTime.dwHighDateTime) << 32) | kernelTime.dwLowDateTime;
+	uint64_t user = (static_cast<uint64_t>(userTime.dwHighDateTime) << 32) | userTime.dwLowDateTime;
+
+	// FILETIME is in 100 nanoseconds units
+	return std::chrono::nanoseconds((kernel + user) * 100);
+#endif
+}
+
+static web::WorkStealingThreadPool::SizingOptions makeFixedSize(size_t numberOfWorkers)
+{
+	web::WorkStealingThreadPool::SizingOptions result;
+
+	if (!numberOfWorkers)
+	{
+		numberOfWorkers = std::max(std::thread::hardware_concurrency(), 1U);
+	}
+
+	result.minWorkers = numberOfWorkers;
+	result.maxWorkers = numberOfWorkers;
+
+	return result;
+}
+
+namespace web
+{
+	void WorkStealingThreadPool::TaskQueue::grow()
+	{
+		std::vector<Task> temp(tasks.size() * 2);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			temp[i] = std::move(tasks[(head + i) % tasks.size()]);
+		}
+
+		tasks = std::move(temp);
+		head = 0;
+	}
+
+	WorkStealingThreadPool::TaskQueue::TaskQueue() :
+		tasks(initialQueueCapacity),
+		head(0),
+		count(0)
+	{
+
+	}
+
+	void WorkStealingThreadPool::TaskQueue::push(Task&& task)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		if (count == tasks.size())
+		{
+			this->grow();
+		}
+
+		tasks[(head + count) % tasks.size()] = std::move(task);
+
+		count++;
+	}
+
+	bool WorkStealingThreadPool::TaskQueue::pop(Task& task)
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		if (!count)
+		{
+			return false;
+		}
+
+		task = std::move(tasks[head]);
+		tasks[head] = nullptr;
+
+		head = (head + 1) % tasks.size();
+		count--;
+
+		return true;
+	}
+
+	bool WorkStealingThreadPool::TaskQueue::steal(Task& task)
+	{
+		// Oldest task is stolen too, so connections queued behind long handler wait no longer than newer ones
+		return this->pop(task);
+	}
+
+	size_t WorkStealingThreadPool::TaskQueue::size() const
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+
+		return count;
+	}
+
+	WorkStealingThreadPool::Worker::Worker() :
+		executedTasks(0),
+		stolenTasks(0),
+		running(false)
+	{
+
+	}
+
+	void WorkStealingThreadPool::workerThread(size_t index)
+	{
+		Worker& worker = *workers[index];
+		Task task;
+
+		currentPool = this;
+		currentWorkerIndex = index;
+
+		while (true)
+		{
+			uint32_t currentEpoch = epoch.load(std::memory_order_acquire);
+
+			if (this->findTask(index, task))
+			{
+				if (adaptive)
+				{
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+					busyWorkers.fetch_add(1, std::memory_order_relaxed);
+
+					task();
+
+					busyWorkers.fetch_sub(1, std::memory_order_relaxed);
+					taskNanoseconds.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+				}
+				else
+				{
+					task();
+				}
+
+				task = nullptr;
+
+				worker.executedTasks.fetch_add(1, std::memory_order_relaxed);
+
+				continue;
+			}
+
+			if (!isRunning.load(std::memory_order_acquire))
+			{
+				break;
+			}
+
+			if (index >= numberOfWorkers.load())
+			{
+				worker.running.store(false);
+
+				// Pool could grow again before running was cleared, then either this thread continues or startWorker joins it and starts new one
+				if (index >= numberOfWorkers.load() || worker.running.exchange(true))
+				{
+					break;
+				}
+
+				continue;
+			}
+
+			epoch.wait(currentEpoch, std::memory_order_acquire);
+		}
+
+		currentPool = nullptr;
+	}
+
+	bool WorkStealingThreadPool::findTask(size_t index, Task& task)
+	{
+		if (workers[index]->queue.pop(task))
+		{
+			return true;
+		}
+
+		size_t numberOfSlots = numberOfUsedSlots.load(std::memory_order_acquire);
+
+		for (size_t i = 1; i < numberOfSlots; i++)
+		{
+			if (workers[(index + i) % numberOfSlots]->queue.steal(task))
+			{
+				workers[index]->stolenTasks.fetch_add(1, std::memory_order_relaxed);
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void WorkStealingThreadPool::startWorker(size_t index)
+	{
+		Worker& worker = *workers[index];
+
+		// Retiring thread that saw new size keeps working
+		if (worker.running.exchange(true))
+		{
+			return;
+		}
+
+		if (worker.thread.joinable())
+		{
+			worker.thread.join();
+		}
+
+		worker.thread = std::thread(&WorkStealingThreadPool::workerThread, this, index);
+	}
+
+	void WorkStealingThreadPool::resize(size_t size)
+	{
+		size_t current = numberOfWorkers.load();
+
+		if (size > current)
+		{
+			if (size > numberOfUsedSlots.load())
+			{
+				numberOfUsedSlots.store(size, std::memory_order_release);
+			}
+
+			numberOfWorkers.store(size);
+
+			for (size_t i = current; i < size; i++)
+			{
+				this->startWorker(i);
+			}
+		}
+		else if (size < current)
+		{
+			numberOfWorkers.store(size);
+
+			epoch.fetch_add(1, std::memory_order_release);
+			epoch.notify_all();
+		}
+	}
+
+	void WorkStealingThreadPool::sizingLoop()
+	{
+		std::unique_lock<std::mutex> lock(sizingMutex);
+		double numberOfCores = std::max(std::thread::hardware_concurrency(), 1U);
+		std::chrono::steady_clock::time_point previousTime = std::chrono::steady_clock::now();
+		std::chrono::nanoseconds previousCpuTime = getProcessCpuTime();
+		uint64_t previousTaskNanoseconds = taskNanoseconds.load(std::memory_order_relaxed);
+		uint64_t previousExecutedTasks = 0;
+		size_t overloadedSamples = 0;
+		size_t idleSamples = 0;
+
+		while (!sizingCondition.wait_for(lock, sizingOptions.interval, [this]() { return !isRunning.load(std::memory_order_acquire); }))
+		{
+			std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+			std::chrono::nanoseconds cpuTime = getProcessCpuTime();
+			uint64_t currentTaskNanoseconds = taskNanoseconds.load(std::memory_order_relaxed);
+			uint64_t executedTasks = 0;
+			size_t current = numberOfWorkers.load();
+			size_t pendingTasks = this->getNumberOfPendingTasks();
+			size_t busy = busyWorkers.load(std::memory_order_relaxed);
+			double wallNanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(time - previousTime).count());
+
+			for (size_t i = 0; i < numberOfUsedSlots.load(std::memory_order_acquire); i++)
+			{
+				executedTasks += workers[i]->executedTasks.load(std::memory_order_relaxed);
+			}
+
+			uint64_t finishedTasks = executedTasks - previousExecutedTasks;
+
+			// Handlers that run longer than interval don't finish, so busy pool without finished tasks has at least interval latency
+			double latency = finishedTasks ?
+				static_cast<double>(currentTaskNanoseconds - previousTaskNanoseconds) / finishedTasks :
+				(busy ? wallNanoseconds : 0.0);
+
+			sizingStatistics.cpuUtilization = (cpuTime - previousCpuTime).count() / (wallNanoseconds * numberOfCores);
+			sizingStatistics.workerUtilization = static_cast<double>(busy) / current;
+			sizingStatistics.averageTaskLatency = std::chrono::microseconds(static_cast<int64_t>(latency / 1000));
+
+			bool blocked = sizingStatistics.workerUtilization >= busyUtilization && sizingStatistics.averageTaskLatency >= sizingOptions.latencyThreshold;
+			bool overloaded = (pendingTasks > current || blocked) && sizingStatistics.cpuUtilization < sizingOptions.maxCpuUtilization;
+			bool idle = !pendingTasks && sizingStatistics.workerUtilization < idleUtilization;
+
+			overloadedSamples = overloaded ? overloadedSamples + 1 : 0;
+			idleSamples = idle ? idleSamples + 1 : 0;
+
+			// Grow fast for peaks, shrink by one worker after long idle period
+			if (overloadedSamples >= sizingOptions.growSamples && current < sizingOptions.maxWorkers)
+			{
+				this->resize(std::min(sizingOptions.maxWorkers, current + std::max<size_t>(1, current / 4)));
+
+				sizingStatistics.grows++;
+				overloadedSamples = 0;
+				idleSamples = 0;
+			}
+			else if (idleSamples >= sizingOptions.shrinkSamples && current > sizingOptions.minWorkers)
+			{
+				this->resize(current - 1);
+
+				sizingStatistics.shrinks++;
+				idleSamples = 0;
+			}
+
+			previousTime = time;
+			previousCpuTime = cpuTime;
+			previousTaskNanoseconds = currentTaskNanoseconds;
+			previousExecutedTasks = executedTasks;
+		}
+	}
+
+	WorkStealingThreadPool::WorkStealingThreadPool(size_t numberOfWorkers) :
+		WorkStealingThreadPool(makeFixedSize(numberOfWorkers))
+	{
+
+	}
+
+	WorkStealingThreadPool::WorkStealingThreadPool(const SizingOptions& options) :
+		numberOfWorkers(0),
+		numberOfUsedSlots(0),
+		nextWorker(0),
+		epoch(0),
+		isRunning(true),
+		sizingOptions(options),
+		adaptive(options.minWorkers != options.maxWorkers),
+		busyWorkers(0),
+		taskNanoseconds(0),
+		sizingStatistics()
+	{
+		if (!sizingOptions.minWorkers || sizingOptions.minWorkers > sizingOptions.maxWorkers)
+		{
+			throw std::runtime_error("Wrong number of workers");
+		}
+
+		workers.reserve(sizingOptions.maxWorkers);
+
+		for (size_t i = 0; i < sizingOptions.maxWorkers; i++)
+		{
+			workers.push_back(std::make_unique<Worker>());
+		}
+
+		sizingStatistics.minWorkers = sizingOptions.minWorkers;
+		sizingStatistics.maxWorkers = sizingOptions.maxWorkers;
+
+		this->resize(sizingOptions.minWorkers);
+
+		if (adaptive)
+		{
+			sizingThread = std::thread(&WorkStealingThreadPool::sizingLoop, this);
+		}
+	}
+
+	void WorkStealingThreadPool::addTask(Task&& task)
+	{
+		size_t index = currentPool == this ?
+			currentWorkerIndex :
+			nextWorker.fetch_add(1, std::memory_order_relaxed) % numberOfWorkers.load(std::memory_order_relaxed);
+
+		workers[index]->queue.push(std::move(task));
+
+		epoch.fetch_add(1, std::memory_order_release);
+		epoch.notify_one();
+	}
+
+	size_t WorkStealingThreadPool::getNumberOfWorkers() const
+	{
+		return numberOfWorkers.load();
+	}
+
+	size_t WorkStealingThreadPool::getNumberOfPendingTasks() const
+	{
+		size_t result = 0;
+		size_t numberOfSlots = numberOfUsedSlots.load(std::memory_order_acquire);
+
+		for (size_t i = 0; i < numberOfSlots; i++)
+		{
+			result += workers[i]->queue.size();
+		}
+
+		return result;
+	}
+
+	std::vector<WorkStealingThreadPool::WorkerStatistics> WorkStealingThreadPool::getWorkersStatistics() const
+	{
+		std::vector<WorkerStatistics> result;
+		size_t size = numberOfWorkers.load();
+
+		result.reserve(size);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			const std::unique_ptr<Worker>& worker = workers[i];
+
+			result.push_back
+			(
+				{
+					worker->queue.size(),
+					worker->executedTasks.load(std::memory_order_relaxed),
+					worker->stolenTasks.load(std::memory_order_relaxed)
+				}
+			);
+		}
+
+		return result;
+	}
+
+	WorkStealingThreadPool::SizingStatistics WorkStealingThreadPool::getSizingStatistics() const
+	{
+		std::lock_guard<std::mutex> lock(sizingMutex);
+		SizingStatistics result = sizingStatistics;
+
+		result.numberOfWorkers = numberOfWorkers.load();
+
+		return result;
+	}
+
+	WorkStealingThreadPool::~WorkStealingThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sizingMutex);
+
+			isRunning.store(false, std::memory_order_release);
+		}
+
+		sizingCondition.notify_all();
+
+		if (sizingThread.joinable())
+		{
+			sizingThread.join();
+		}
+
+		epoch.fetch_add(1, std::memory_order_release);
+		epoch.notify_all();
+
+		for (std::unique_ptr<Worker>& worker : workers)
+		{
+			if (worker->thread.joinable())
+			{
+				worker->thread.join();
+			}
+		}
+	}
+}